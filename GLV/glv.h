@@ -26,6 +26,9 @@
 #include "glv_behavior.h"
 #include "glv_font.h"
 #include "glv_layout.h"
+#include "glv_profiler.h"
+#include "glv_rasterizer.h"
+#include "glv_replay.h"
 
 // widgets:
 #include "glv_buttons.h"
@@ -128,6 +128,43 @@ struct HSV{
 
 
 
+/// Color represented by 8-bit red, green, blue, and alpha components
+
+/// This takes a quarter of the memory of Color and can be given directly to
+/// OpenGL as vertex colors or texels.
+struct Color8{
+	unsigned char r, g, b, a;
+
+	Color8(){}
+
+	/// \param[in] r		red component
+	/// \param[in] g		green component
+	/// \param[in] b		blue component
+	/// \param[in] a		alpha component
+	Color8(unsigned char r, unsigned char g, unsigned char b, unsigned char a=255)
+	:	r(r), g(g), b(b), a(a){}
+
+	/// Convert from color, clamping components into [0, 1]
+	Color8(const Color& c)
+	:	r(component(c.r)), g(component(c.g)), b(component(c.b)), a(component(c.a)){}
+
+	/// Convert to color
+	Color toColor() const { return Color(r/255.f, g/255.f, b/255.f, a/255.f); }
+
+	/// Convert component in [0, 1] to nearest byte; NaN converts to 0
+	static unsigned char component(float v){
+		v = v*255.f + 0.5f;
+		return (unsigned char)(v > 0.f ? (v < 255.f ? v : 255.f) : 0.f);
+	}
+};
+
+/// Convert colors to 8-bit colors
+void toColor8(Color8 * dst, const Color * src, int n);
+
+/// Convert 8-bit colors to colors
+void toColor(Color * dst, const Color8 * src, int n);
+
+
 // Implementation ______________________________________________________________
 
 inline Color::Color(float r, float g, float b, float a)
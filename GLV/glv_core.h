@@ -7,6 +7,7 @@
 #include <map>
 #include <string>
 #include <list>
+#include <unordered_map>
 #include <vector>
 #include "glv_rect.h"
 #include "glv_notification.h"
@@ -14,10 +15,12 @@
 #include "glv_draw.h"
 #include "glv_font.h"
 #include "glv_model.h"
+#include "glv_texture.h"
 #include "glv_util.h"
 
 namespace glv {
 
+class FrameProfiler;
 class GLV;
 class View;
 
@@ -162,6 +165,11 @@ namespace Event{
 
 	/// Returns a string of event type.
 	const char * toString(const Event::t e);
+
+	/// Returns bit of event type in a mask of types
+
+	/// Runtime event types from 31 up share the highest bit.
+	inline unsigned bit(Event::t e){ return 1u << (unsigned(e) < 31 ? unsigned(e) : 31); }
 }
 
 
@@ -317,6 +325,38 @@ protected:
 
 
 
+/// Input event from the window system
+struct InputEvent{
+
+	/// \param[in] type	event type
+	InputEvent(Event::t type_=Event::Null)
+	:	type(type_), x(0), y(0), button(0), clicks(0), key(0), wheel(0), hasModifiers(false)
+	{
+		for(bool& m : modifiers) m = false;
+	}
+
+	Event::t type;		///< Event type
+	int x, y;			///< Mouse position in window, in pixels
+	int button;			///< Mouse button
+	int clicks;			///< Number of sequential clicks of mouse button
+	int key;			///< Key code
+	int wheel;			///< Mouse wheel delta
+	bool modifiers[5];	///< Modifier key states (shift, alt, ctrl, caps, meta)
+	bool hasModifiers;	///< Whether modifier key states are known
+};
+
+
+
+/// Observer of input events posted to a GLV
+struct InputObserver{
+	virtual ~InputObserver(){}
+
+	/// Called for each event posted, before it is queued or dispatched
+	virtual void onInput(const InputEvent& e) = 0;
+};
+
+
+
 /// Color style for View appearance.
 class StyleColor{
 public:
@@ -351,6 +391,7 @@ public:
 	Style(bool deletable=false);
 	
 	StyleColor color;	///< Color style
+	bool atlasFont;		///< Whether Views draw text with an AtlasFont rather than strokes
 
 	/// Get reference to standard style
 	static Style& standard(){
@@ -361,6 +402,61 @@ public:
 
 
 
+/// Spatial index of the children of a View for hit testing
+
+/// Children are binned into a uniform grid with cells the size of an average
+/// child. Finding the topmost child under a point only tests the children
+/// overlapping the cell containing the point, so the cost does not depend on
+/// the total number of children. Children much larger than a cell are kept in
+/// a separate list that is always tested. The index is maintained by its View
+/// as children are added, removed, moved and resized.
+class SpatialIndex{
+public:
+	SpatialIndex();
+
+	/// Rebuild index from all children of a View
+	void build(View& parent);
+
+	/// Add child above all others
+	void insert(View& v);
+
+	/// Remove child
+	void remove(View& v);
+
+	/// Update child after its geometry has changed
+	void update(View& v);
+
+	/// Get topmost visible child containing point or 0 if none
+	View * find(space_t x, space_t y) const;
+
+	/// Get number of indexed children
+	int size() const { return mEntries.size(); }
+
+protected:
+	struct Entry{
+		unsigned order;		// stacking order; higher is above
+		int x0,y0, x1,y1;	// range of cells covered, x1<x0 if in large list
+	};
+	typedef std::vector<std::pair<unsigned, View *>> Bin;
+
+	std::unordered_map<View *, Entry> mEntries;
+	std::unordered_map<unsigned long long, Bin> mCells;
+	Bin mLarge;
+	View * mParent;
+	space_t mCellW, mCellH;
+	unsigned mOrder;
+	int mBuiltSize;
+
+	bool cellRange(const View& v, Entry& e) const;
+	void bin(View& v, Entry& e);
+	void unbin(View& v, const Entry& e);
+	static unsigned long long key(int x, int y){
+		return ((unsigned long long)(unsigned)x << 32) | (unsigned)y;
+	}
+};
+
+
+
 /// The base class of all GUI elements
 
 ///
@@ -491,9 +587,22 @@ public:
 	/// Returns number of registered event handlers
 	int numEventHandlers(Event::t e) const;
 
+	/// Set whether broadcasts of an event type call the virtual onEvent()
+
+	/// All event types except Quit and the window events are broadcast to
+	/// onEvent() by default. A View handling those in onEvent() must listen to
+	/// them. Turning off the types a View does not handle in onEvent() lets
+	/// broadcasts skip over subtrees that have neither listeners nor handlers
+	/// for them.
+	View& listen(Event::t e, bool v);
+
+	/// Returns whether broadcasts of an event type call the virtual onEvent()
+	bool listening(Event::t e) const { return mListenMask & Event::bit(e); }
+
 	
 	bool absToRel(View * target, space_t& x, space_t& y) const;
 	StyleColor& colors() const;					///< Get style colors
+	bool damaged() const { return mDamaged; }	///< Returns whether View needs to be redrawn
 	const std::string& descriptor() const;		///< Get descriptor
 	int enabled(Property::t v) const;			///< Returns whether a property is set
 	int disabled(Property::t v) const;			///< Returns whether a property is not set
@@ -523,6 +632,14 @@ public:
 	View& property(Property::t p, bool v);		///< Set property flag(s) to a specfic value	
 	View& toggle(Property::t p);				///< Toggle property flag(s)
 
+	/// Set whether View needs to be redrawn
+
+	/// Damage is raised automatically by value notifications, input events, focus
+	/// and style changes, and resizing. Views whose appearance changes by other
+	/// means, e.g., in onAnimate, must call this for the change to be shown
+	/// when the GLV only redraws damaged regions.
+	View& damage(bool v=true){ mDamaged=v; return *this; }
+
 	View& bringToFront();						///< Brings to front of parent View
 	View& cloneStyle();							///< Creates own copy of current style
 	void constrainWithinParent();				///< Force to remain in parent	
@@ -534,6 +651,19 @@ public:
 	///
 	View * findTarget(space_t& x, space_t& y);
 
+	/// Set whether to keep a spatial index of children for finding targets
+
+	/// This speeds up findTarget for Views with many children. The index is
+	/// kept up to date as children are added, removed, moved and resized
+	/// through the Rect member functions. If children are moved by assigning
+	/// to their l or t members directly, call this again to rebuild the index.
+	View& spatialIndex(bool v);
+
+	/// Get spatial index of children or 0 if not enabled
+	const SpatialIndex * spatialIndex() const {
+		return mSpatialIndex.created() ? &mSpatialIndex() : 0;
+	}
+
 	/// Fit geometry so all children are visible
 
 	/// This uses the geometric union of all the children to resize the extent
@@ -572,6 +702,7 @@ public:
 	void addModels(ModelManager& m);
 
 
+
 	/// Should return a message if an error/warning, otherwise, empty string
 	virtual std::string onDebug() const { return ""; }
 
@@ -580,27 +711,43 @@ public:
 
 protected:
 	friend class GLV;
-	typedef std::map<Event::t, EventHandlers> EventHandlersMap;
+	struct EventHandlerEntry{ Event::t type; EventHandler * handler; };
 	
 	DrawHandlers mDrawHandlers;
-	Lazy<EventHandlersMap> mEventHandlersMap;
+	std::vector<EventHandlerEntry> mEventHandlers;	// handlers of all types in order added
+	unsigned mEventHandlerMask;		// event types with handlers
+	unsigned mListenMask;			// event types broadcast to onEvent()
+	unsigned mSubtreeEventMask;		// event types of interest to self or descendents
 	Property::t mFlags;				// Property flags
 	Style * mStyle;					// Visual appearance
 	space_t mAnchorX, mAnchorY;		// Position anchoring factors when parent is resized
 	space_t mStretchX, mStretchY;	// Stretch factors when parent is resized				
 	std::string mName;				// Settable name identifier
 	std::string mDescriptor;		// String describing view
+	bool mDamaged;					// Whether view needs to be redrawn
 
 	void doDraw(GLV& g);
 //	bool doEventHandlers(View& v, Event::t e);
 	bool hasName() const { return ""!=mName; }
 	void reanchor(space_t dx, space_t dy);	// Reanchor when parent resizes
 	void focused(bool b);					// Set whether I'm focused
+	void onNotify(void * sender, Update::t type, void * data) override;	// Value updates damage
+
+	// Increment tree revision of each GLV above me, including myself
+	void treeModified();
+
+	// Increment event revision of each GLV above me, including myself
+	void eventsModified();
+
+	// Recompute event types of interest to self and all descendents
+	unsigned updateSubtreeEventMask();
 
 private:
 	Lazy<Rect> mRestoreRect;		// Restoration geometry
 	Lazy<Font> mFont;
+	Lazy<SpatialIndex> mSpatialIndex;	// Index of children for hit testing
 	void onResizeRect(space_t dx, space_t dy) override;
+	void onMoveRect(space_t dx, space_t dy) override;
 };
 
 
@@ -621,6 +768,18 @@ private:
 class GLV : public View{
 public:
 
+	/// Entry in the retained draw list
+	struct DrawItem{
+		View * view;			///< View to draw
+		Rect rect;				///< Relative geometry of view when list was built
+		Rect abs;				///< Absolute geometry of view
+		Rect crop;				///< Absolute crop region of view
+		int depth;				///< Depth in tree; root children have depth 1
+		Property::t flags;		///< Geometry related flags when list was built
+	};
+
+	typedef std::vector<DrawItem> DrawList;
+
 	/// Constructor
 
 	/// \param[in] width		width, in pixels
@@ -644,11 +803,30 @@ public:
 	View * focusedView() const { return mFocusedView; }
 
 	/// Get reference to temporary graphics data for rendering
+
+	/// The buffers draw their memory from the frame arena and are reserved at
+	/// the start of each frame to the largest capacities they have needed.
 	GraphicsData& graphicsData(int i=0){ return mGraphicsData[i]; }
 
+	/// Get arena for memory needed only until the end of the current frame
+
+	/// The arena is reset at the end of drawWidgets().
+	FrameArena& frameArena(){ return mFrameArena; }
+	const FrameArena& frameArena() const { return mFrameArena; }
+
 
 	/// Sends an event to everyone in tree (including self)
+
+	/// Only the subscribers of the event type are visited, in tree order.
 	void broadcastEvent(Event::t e);
+
+	/// Get Views subscribed to broadcasts of an event type, in tree order
+
+	/// A View is subscribed if it has handlers for the event type or is
+	/// listening to it. Runtime event types from 31 up share one list. The
+	/// lists are kept up to date with changes to the tree and to handlers
+	/// and are only rebuilt after changes within this GLV.
+	const std::vector<View *>& subscribers(Event::t e);
 	
 	/// Draw all Views in the GLV
 
@@ -663,6 +841,87 @@ public:
 	/// \param[in] contextHeight	height of context, in pixels
 	/// \param[in] dsec				change in seconds from last call to this method
 	void drawWidgets(unsigned contextWidth, unsigned contextHeight, double dsec);
+
+	/// Get retained draw list of all descendent Views in drawing order
+	const DrawList& drawList() const { return mDrawList; }
+
+	/// Force the draw list to be rebuilt on the next frame
+	GLV& invalidateDrawList(){ mDrawListValid=false; return *this; }
+
+	/// Bring the draw list up to date, syncing and rectifying all listed Views
+
+	/// The draw list is only rebuilt if the tree structure, the context size,
+	/// or the geometry or visibility of a listed View has changed. Each View
+	/// is synced and rectified once, even when a change is found part way
+	/// through the list.
+	/// \returns whether the draw list was rebuilt
+	bool updateDrawList(unsigned contextWidth, unsigned contextHeight);
+
+	/// Get id of graphics context drawn into, see draw::context()
+	int graphicsContext() const { return mContext; }
+
+	/// Get whether only damaged regions are redrawn
+	bool partialRedraw() const { return mPartialRedraw; }
+
+	/// Set whether only damaged regions are redrawn
+
+	/// When enabled, the previous frame is retained in a texture, or by a
+	/// software backend's framebuffer, and only the union of the rects of
+	/// damaged Views is redrawn on top of it. Any change to the draw list
+	/// causes a full redraw.
+	GLV& partialRedraw(bool v){ mPartialRedraw=v; mBackBufferValid=false; return *this; }
+
+	/// Get whether 2D primitives are batched across Views
+	bool batchDraws() const { return mBatchDraws; }
+
+	/// Set whether 2D primitives are batched across Views
+
+	/// Views that issue GL drawing commands directly must call 
+	/// draw::flushBatch() beforehand when batching is enabled.
+	GLV& batchDraws(bool v){ mBatchDraws=v; return *this; }
+
+	/// Get counts of draw calls and vertices of the last frame
+	const draw::DrawStats& drawStats() const { return mDrawStats; }
+
+	/// Counts of input events over one frame
+	struct InputStats{
+		InputStats(): received(0), dispatched(0){}
+		unsigned received;		///< Number of events posted
+		unsigned dispatched;	///< Number of events propagated after coalescing
+	};
+
+	/// Get whether input events are queued until the next frame
+	bool queueInput() const { return mQueueInput; }
+
+	/// Set whether input events are queued until the next frame
+
+	/// When on, posted input events are dispatched at the start of 
+	/// drawWidgets(), before Views are animated. Consecutive mouse move events,
+	/// consecutive mouse drag events and consecutive mouse wheel events are
+	/// coalesced into one event each. Turning queueing off dispatches any
+	/// pending events.
+	GLV& queueInput(bool v);
+
+	/// Post input event, dispatching it immediately unless input is queued
+	void postInput(const InputEvent& e);
+
+	/// Dispatch queued input events
+	void dispatchInput();
+
+	/// Get counts of input events of the last frame
+	const InputStats& inputStats() const { return mInputStats; }
+
+	/// Get observer of posted input events
+	InputObserver * inputObserver() const { return mInputObserver; }
+
+	/// Set observer of posted input events or 0 for none
+	GLV& inputObserver(InputObserver * v){ mInputObserver=v; return *this; }
+
+	/// Get profiler timing the Views of each frame
+	FrameProfiler * profiler() const { return mProfiler; }
+
+	/// Set profiler timing the Views of each frame or 0 for none
+	GLV& profiler(FrameProfiler * v){ mProfiler=v; return *this; }
 	
 	/// Set event type to propagate
 	void eventType(Event::t e){ mEventType = e; }
@@ -734,16 +993,59 @@ public:
 	const char * className() const override { return "GLV"; }
 
 protected:
+	friend class View;
 	Keyboard mKeyboard;
 	Mouse mMouse;
 
 	View * mFocusedView;	// current focused widget
 	Event::t mEventType;	// current event type
 	ModelManager mMM;
+	FrameArena mFrameArena;
 	GraphicsData mGraphicsData[2];
-
-	// Returns whether the event should be bubbled to parent
-	bool doEventCallbacks(View& target, Event::t e);
+	int mFrameCapacities[2][GraphicsData::numBuffers]; // largest capacities of graphics data
+	DrawList mDrawList;
+	Rect mDrawListRoot;				// root geometry when draw list was built
+	unsigned mTreeRevision;			// incremented when a View is linked into or out of the tree
+	unsigned mEventRevision;		// incremented when a View in the tree changes its handled or listened events
+	unsigned mDrawListRevision;		// tree revision when draw list was built
+	unsigned mDrawListW, mDrawListH;// context size when draw list was built
+	bool mDrawListValid;
+	Texture2 mBackBuffer;			// copy of last frame for partial redraws
+	draw::Backend * mBackBufferBackend;	// backend that drew the retained frame
+	unsigned mBackBufferW, mBackBufferH;	// size of the retained frame
+	bool mBackBufferValid;
+	bool mPartialRedraw;
+	draw::Batch mBatch;
+	draw::DrawStats mDrawStats;
+	bool mBatchDraws;
+	unsigned mEventMaskTreeRevision;	// tree revision when subtree event masks were updated
+	unsigned mEventMaskRevision;		// event revision when subtree event masks were updated
+	bool mEventMasksValid;
+
+	struct Subscribers{
+		Subscribers(): treeRevision(0), eventRevision(0), valid(false){}
+		std::vector<View *> views;
+		unsigned treeRevision, eventRevision;
+		bool valid;
+	};
+	Subscribers mSubscribers[32];	// subscribers to each event type bit
+	std::vector<InputEvent> mInputQueue, mInputDispatch;
+	InputStats mInputStats;			// counts of last frame
+	InputStats mInputCounts;		// counts of current frame
+	InputObserver * mInputObserver;
+	FrameProfiler * mProfiler;
+	bool mQueueInput;
+	int mContext;					// graphics context drawn into
+
+	// Views in sorted list synced have already been synced and rectified
+	void rebuildDrawList(unsigned contextWidth, unsigned contextHeight, const std::vector<View *>& synced);
+	void resetFrameArena();
+	void updateEventMasks();
+	void dispatchInput(const InputEvent& e);
+
+	// Returns whether the event should be bubbled to parent. Broadcasts skip
+	// onEvent() of Views not listening to the event.
+	bool doEventCallbacks(View& target, Event::t e, bool broadcast=false);
 	
 	void doFocusCallback(bool get); // Call get or lose focus callback of focused view
 
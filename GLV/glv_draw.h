@@ -5,6 +5,7 @@
 	See COPYRIGHT file for authors and license information */
 
 #include <cmath>
+#include <memory>
 #include <stdio.h>
 #include "glv_conf.h"
 #include "glv_color.h"
@@ -49,11 +50,34 @@ struct Point3{
 };
 
 
-/// Buffers of vertices, colors, and indices
+/// Two-dimensional point with 8-bit color, interleaved
+struct ColorPoint2{
+	ColorPoint2(){}
+	ColorPoint2(float x_, float y_, const Color8& c): x(x_), y(y_), color(c){}
+	float x, y;
+	Color8 color;
+};
+
+
+/// Buffers of vertices, colors, texture coordinates, and indices
+
+/// Vertices are taken from the first non-empty buffer of 3D vertices, 2D
+/// vertices and 2D vertices interleaved with 8-bit colors. Colors are taken
+/// from interleaved vertices, else from the color buffer if it is not empty,
+/// else from the 8-bit color buffer.
 class GraphicsData{
 public:
+	struct Cache;
 
-	GraphicsData(): mColors(1){}
+	GraphicsData();
+
+	/// Copy buffers; the copy has caching on if the source does, but caches its own data
+	GraphicsData(const GraphicsData& v);
+	GraphicsData(GraphicsData&& v);
+	~GraphicsData();
+
+	GraphicsData& operator= (const GraphicsData& v);
+	GraphicsData& operator= (GraphicsData&& v);
 
 	/// Get color buffer
 	const Buffer<Color>& colors() const { return mColors; }
@@ -67,10 +91,64 @@ public:
 	/// Get 3D vertex buffer
 	const Buffer<Point3>& vertices3() const { return mVertices3; }
 
+	/// Get 2D texture coordinate buffer
+	const Buffer<Point2>& texCoords2() const { return mTexCoords2; }
+
+	/// Get 8-bit color buffer
+	const Buffer<Color8>& colors8() const { return mColors8; }
+
+	/// Get buffer of 2D vertices interleaved with 8-bit colors
+	const Buffer<ColorPoint2>& colorVertices2() const { return mColorVertices2; }
+
+	/// Set whether to keep a copy of the data for drawing across paints
+
+	/// While on, paints send the data to the GPU only when it differs from
+	/// what was last sent and otherwise draw from a buffer object. Software
+	/// backends are given a copy kept in memory instead. The data is compared
+	/// by its version stamp if it has one, or else by a hash of its content.
+	/// The data is also sent again when painted in a graphics context other
+	/// than the one holding the buffer object, see draw::context().
+	/// Paints deferred by a draw Batch do not use the cache.
+	GraphicsData& cache(bool v);
+
+	/// Get whether a copy of the data is kept for drawing across paints
+	bool cache() const { return bool(mCache); }
+
+	/// Get cached copy of the data or 0 if caching is off
+	Cache * cached() const { return mCache.get(); }
+
+	/// Set version stamp of content
+
+	/// A cached copy is refreshed only when the stamp changes. A stamp of 0
+	/// means the content is hashed on each paint instead.
+	GraphicsData& stamp(unsigned v){ mStamp=v; return *this; }
+
+	/// Get version stamp of content
+	unsigned stamp() const { return mStamp; }
+
+	/// Number of buffers
+	static const int numBuffers = 7;
+
+	/// Set arena to draw memory of all buffers from or 0 to use the heap
+
+	/// The buffers are emptied and their memory freed. Memory drawn from an
+	/// arena must be released before the arena is reset.
+	GraphicsData& arena(FrameArena * a);
+
+	/// Empty all buffers and free their memory
+	void release();
+
+	/// Get capacities of buffers, in elements, into an array of numBuffers
+	void capacities(int * caps) const;
+
+	/// Ensure capacities of buffers, in elements, from an array of numBuffers
+	void reserve(const int * caps);
+
 	/// Reset all buffers
 	void reset(){
 		mVertices2.reset(); mVertices3.reset();
-		mColors.reset(); mIndices.reset();
+		mColors.reset(); mIndices.reset(); mTexCoords2.reset();
+		mColors8.reset(); mColorVertices2.reset();
 	}
 
 	/// Append color
@@ -93,6 +171,9 @@ public:
 	void addColor(const Color& c1, const Color& c2, const Color& c3, const Color& c4){
 		addColor(c1,c2,c3); addColor(c4); }
 
+	/// Append 8-bit color
+	void addColor8(const Color8& c){ colors8().append(c); }
+
 	/// Append index
 	void addIndex(index_t i){
 		indices().append(i); }
@@ -142,6 +223,12 @@ public:
 	template <class VEC3>
 	void addVertex3(const VEC3& v){ addVertex3(v[0], v[1], v[2]); }
 
+	/// Append 2D texture coordinate
+	void addTexCoord2(float x, float y){ texCoords2().append(Point2(x,y)); }
+
+	/// Append 2D vertex with 8-bit color
+	void addColorVertex2(float x, float y, const Color8& c){ colorVertices2().append(ColorPoint2(x,y,c)); }
+
 	/// Get mutable color buffer
 	Buffer<Color>& colors(){ return mColors; }
 
@@ -154,11 +241,107 @@ public:
 	/// Get mutable 3D vertex buffer
 	Buffer<Point3>& vertices3(){ return mVertices3; }
 
+	/// Get mutable 2D texture coordinate buffer
+	Buffer<Point2>& texCoords2(){ return mTexCoords2; }
+
+	/// Get mutable 8-bit color buffer
+	Buffer<Color8>& colors8(){ return mColors8; }
+
+	/// Get mutable buffer of 2D vertices interleaved with 8-bit colors
+	Buffer<ColorPoint2>& colorVertices2(){ return mColorVertices2; }
+
 protected:
 	Buffer<Point2> mVertices2;
 	Buffer<Point3> mVertices3;
 	Buffer<Color> mColors;
 	Buffer<index_t> mIndices;
+	Buffer<Point2> mTexCoords2;
+	Buffer<Color8> mColors8;
+	Buffer<ColorPoint2> mColorVertices2;
+	std::unique_ptr<Cache> mCache;
+	unsigned mStamp;
+};
+
+
+
+/// Graphics data produced on one thread and drawn on another
+
+/// A producer thread fills the back buffer and publishes it. The drawing
+/// thread swaps in the latest published buffer and draws it. Neither thread
+/// blocks nor copies the data; a third buffer holds the latest published one
+/// between the two. Buffers published faster than they are drawn are reused
+/// without being drawn.
+///
+/// Generation numbers tell whether the drawn data is up to date. Whoever
+/// changes the source of the graphics calls request(). The producer passes
+/// the requested generation it started from to publish(), so the drawn buffer
+/// is stale while its generation is older than the one requested.
+///
+/// Example:
+/// \code
+///	// producer thread
+///	unsigned gen = frames.requested();
+///	auto& gd = frames.back();
+///	gd.reset();
+///	makeGeometry(gd);
+///	frames.publish(gen);
+///
+///	// drawing thread
+///	frames.swap();
+///	draw::paint(draw::Triangles, frames.front());
+/// \endcode
+class GraphicsFrames{
+public:
+
+	GraphicsFrames(): mRequested(0), mMiddle(1), mFront(0), mBack(2){
+		mGenerations[0] = mGenerations[1] = mGenerations[2] = 0;
+	}
+
+	/// Mark graphics as out of date and return the new requested generation
+	unsigned request(){ return ++mRequested; }
+
+	/// Get latest requested generation
+	unsigned requested() const { return mRequested; }
+
+
+	/// Get back buffer to fill; producer thread only
+	GraphicsData& back(){ return mFrames[mBack]; }
+
+	/// Make back buffer the latest complete one; producer thread only
+
+	/// \param[in] generation	requested generation the data was produced for
+	void publish(unsigned generation){
+		mGenerations[mBack] = generation;
+		mBack = mMiddle.exchange(mBack | Fresh) & ~Fresh;
+	}
+
+
+	/// Swap in latest complete buffer, if any; drawing thread only
+
+	/// \returns whether a newly published buffer was swapped in
+	///
+	bool swap(){
+		if(!(mMiddle.load() & Fresh)) return false;
+		mFront = mMiddle.exchange(mFront) & ~Fresh;
+		return true;
+	}
+
+	/// Get front buffer to draw; drawing thread only
+	const GraphicsData& front() const { return mFrames[mFront]; }
+
+	/// Get generation of front buffer; drawing thread only
+	unsigned generation() const { return mGenerations[mFront]; }
+
+	/// Get whether front buffer is older than the requested generation; drawing thread only
+	bool stale() const { return int(requested() - generation()) > 0; }
+
+private:
+	enum{ Fresh = 4 };
+	GraphicsData mFrames[3];
+	unsigned mGenerations[3];
+	std::atomic<unsigned> mRequested;
+	std::atomic<unsigned> mMiddle;	// index of middle buffer | Fresh if published
+	unsigned mFront, mBack;
 };
 
 
@@ -237,7 +420,337 @@ protected:
 };
 
 
+/// Rendering backend replacing OpenGL for draw:: commands
+
+/// While a backend is current, all draw:: state, transform and paint commands
+/// are forwarded to it rather than to OpenGL, e.g., to render without a GPU.
+/// The base class keeps track of the fixed-function state (matrix stacks, 
+/// color, blending, scissor, etc.) so that subclasses only need to implement
+/// paint() and clear(). Overriders of the state setters should call the base
+/// class method.
+///
+/// Textures are not rasterized by backends. While one is current, textured
+/// paints draw nothing and Texture2 makes no GL calls.
+class Backend{
+public:
+
+	Backend();
+	virtual ~Backend(){}
+
+	/// Render primitives using the current state
+
+	/// \param[in] prim		primitive type
+	/// \param[in] verts		vertex components
+	/// \param[in] dim		number of components per vertex, 2 or 3
+	/// \param[in] cols		per vertex colors or 0 to use current color
+	/// \param[in] indices	vertex indices or 0 to use vertices in order
+	/// \param[in] num		number of indices, if given, otherwise vertices
+	virtual void paint(int prim, const float * verts, int dim, const Color * cols, const index_t * indices, int num) = 0;
+
+	/// Clear buffers specified by mask
+	virtual void clear(int mask){}
+
+	/// Get whether the framebuffer keeps its contents from one frame to the next
+
+	/// A GLV only redrawing damaged regions draws on top of the retained frame.
+	///
+	virtual bool retainsFrame() const { return false; }
+
+	virtual void blendEquation(int v){ mBlendEq=v; }
+	virtual void blendFunc(int s, int d){ mBlendSrc=s; mBlendDst=d; }
+	virtual void clearColor(const Color& v){ mClearColor=v; }
+	virtual void color(const Color& v){ mColor=v; }
+	virtual void enable(int cap, bool v);
+	virtual void lineWidth(float v){ mLineWidth=v; }
+	virtual void pointSize(float v){ mPointSize=v; }
+	virtual void scissor(int x, int y, int w, int h);
+	virtual void viewport(int x, int y, int w, int h);
+
+	void identity();
+	void matrixMode(int mode);
+	void multMatrix(const float * m);
+	void pop();
+	void push();
+	void rotate(float deg, float x, float y, float z);
+	void scale(float x, float y, float z);
+	void translate(float x, float y, float z);
+
+	int blendEquation() const { return mBlendEq; }
+	int blendSrc() const { return mBlendSrc; }
+	int blendDst() const { return mBlendDst; }
+	const Color& clearColor() const { return mClearColor; }
+	const Color& color() const { return mColor; }
+	bool enabled(int cap) const;
+	float lineWidth() const { return mLineWidth; }
+	float pointSize() const { return mPointSize; }
+	const int * scissor() const { return mScissor; }
+	const int * viewport() const { return mViewport; }
+
+	/// Transform vertex into window coordinates, origin at bottom-left
+	void toWindow(const float * v, int dim, float& x, float& y) const;
+
+	/// Get current backend or 0 if rendering with OpenGL
+	static Backend *& current(){
+		static Backend * v = 0;
+		return v;
+	}
+
+protected:
+	struct Mat4{ float m[16]; };
+
+	std::vector<Mat4> mStacks[2];	// modelview and projection
+	std::vector<int> mCaps;			// enabled capabilities
+	Color mColor, mClearColor;
+	int mMatrixMode;
+	int mBlendEq, mBlendSrc, mBlendDst;
+	float mLineWidth, mPointSize;
+	int mScissor[4];
+	int mViewport[4];
+
+	Mat4& top(){ return mStacks[ModelView == mMatrixMode ? 0:1].back(); }
+	const Mat4& top(int i) const { return mStacks[i].back(); }
+};
+
+/// Get id for a new graphics context
+
+/// GL objects are only valid in the context that created them. Each GLV
+/// draws into its own context, identified by an id.
+int newContext();
+
+/// Make graphics context current
+
+/// GL objects released in the context since it was last current are deleted
+/// now, so the context must also be current in GL. GLV calls this before
+/// drawing.
+void context(int id);
+
+/// Get current graphics context or -1 if none has been made current
+int context();
+
+/// Mark graphics context as lost
+
+/// GL objects created in the context are forgotten without being deleted and
+/// are created again when next used. GLV calls this when broadcasting
+/// WindowCreate or WindowDestroy.
+void contextLost(int id);
+
+/// Get number of GL objects released in a context and not yet deleted
+int releasedObjects(int id);
+
+/// Names of GL objects created in one graphics context
+
+/// Before the names are used, claim() checks them against the current
+/// context. Names of another context are released to be deleted when that
+/// context is next current, and names of a lost context are forgotten.
+class ContextObjects{
+public:
+
+	/// Kind of GL objects
+	enum Kind{ Buffers, Textures };
+
+	/// \param[in] kind		kind of objects
+	/// \param[in] num		number of names, at most 2
+	ContextObjects(Kind kind, int num=1);
+
+	/// Releases the names
+	~ContextObjects(){ release(); }
+
+	/// Make names belong to the current context
+
+	/// \returns whether the names are valid, otherwise they are 0 and new
+	/// objects must be generated into names()
+	bool claim();
+
+	/// Release names to be deleted in their context
+	void release();
+
+	/// Get name
+	GLuint name(int i=0) const { return mNames[i]; }
+
+	/// Get names to generate into
+	GLuint * names(){ return mNames; }
+
+private:
+	GLuint mNames[2];
+	Kind mKind;
+	int mNum;
+	int mContext;		// context names were created in
+	unsigned mRevision;	// revision of context names were created in
+
+	ContextObjects(const ContextObjects&);
+	ContextObjects& operator=(const ContextObjects&);
+};
+
+
+/// Convert primitives into independent points, lines or triangles
+
+/// \param[in]  prim		primitive type
+/// \param[in]  indices	vertex indices or 0 to use vertices in order
+/// \param[in]  num		number of indices, if given, otherwise vertices
+/// \param[out] out		indices of independent primitives
+/// \returns independent primitive type or -1 if not supported
+int independent(int prim, const index_t * indices, int num, std::vector<index_t>& out);
+
+/// Counters of geometry submitted to the renderer
+struct DrawStats{
+	DrawStats(){ reset(); }
+	void reset(){ calls = vertices = painted = bytes = 0; }
+
+	unsigned calls;		///< Number of draw calls
+	unsigned vertices;	///< Number of vertices drawn
+	unsigned painted;	///< Number of vertices painted, counted before batching
+	unsigned bytes;		///< Number of bytes of geometry sent, including refreshed caches
+};
+
+/// Get global counters of geometry submitted to the renderer
+inline DrawStats& stats(){ static DrawStats v; return v; }
+
+
+/// Accumulates 2D primitives across paint calls to minimize draw calls
+
+/// While a batch is current, 2D paints are transformed into window space and
+/// appended to a bucket keyed by primitive type, line width or point size,
+/// blending and scissor region. Strips, loops and fans are converted into 
+/// independent primitives. Paints lying entirely within the scissor region 
+/// do not depend on it and so may share buckets across Views. A paint only
+/// joins an earlier bucket if it does not overlap any later bucket, so that
+/// painting order is preserved where it matters.
+///
+/// Textured paints are batched when they are given with their texture, so that
+/// the texture is part of the bucket key. Other paints that cannot be batched,
+/// such as 3D vertices or geometry drawn with texturing or stippling enabled,
+/// first flush the batch. Code that issues GL drawing commands directly must
+/// call flushBatch() beforehand.
+class Batch{
+public:
+
+	/// Render state that primitives are bucketed by
+	struct Key{
+		Key(int prim_=Triangles)
+		:	prim(prim_), size(0), blend(0), blendSrc(0), blendDst(0), blendEq(0),
+			smooth(0), scissor(0), texture(0)
+		{	for(int& v : box) v = 0; }
+
+		int prim;			///< Primitive type
+		float size;			///< Line width or point size
+		int blend, blendSrc, blendDst, blendEq;	///< Blending enable, function and equation
+		int smooth;			///< Whether line or point smoothing is enabled
+		int scissor;		///< Whether scissor test is enabled
+		int box[4];			///< Scissor box
+		unsigned texture;	///< Name of 2D texture or 0 if untextured
+		bool operator==(const Key& k) const;
+	};
+
+	Batch();
+
+	/// Make current and start deferring paints
+
+	/// The render state is read back from GL once and then tracked through
+	/// the draw functions while the batch is current, so it must not be
+	/// changed by direct GL calls until end().
+	void begin();
+
+	/// Make current and start deferring paints from a known render state
+	void begin(const Backend& state);
+
+	/// Flush and stop deferring paints
+	void end();
+
+	/// Draw all deferred primitives
+	void flush();
+
+	/// Add primitives to batch using the tracked render state
+
+	/// \param[in] prim		primitive type
+	/// \param[in] verts		vertices
+	/// \param[in] cols		per vertex colors or 0 to use current color
+	/// \param[in] indices	vertex indices or 0 to use vertices in order
+	/// \param[in] num		number of indices, if given, otherwise vertices
+	/// \param[in] texcs		per vertex texture coordinates or 0 if untextured
+	/// \param[in] texture	name of 2D texture used with texture coordinates
+	/// \returns false if the primitives must be drawn immediately
+	bool add(int prim, const Point2 * verts, const Color * cols, const index_t * indices, int num,
+		const Point2 * texcs=0, unsigned texture=0);
+
+	/// Add primitives with the given render state rather than the current GL state
+
+	/// \param[in] state	render state, including the primitive type
+	/// \param[in] mv		column-major modelview matrix, which must be planar
+	/// \param[in] color	color used when no per vertex colors are given
+	/// \returns false if the primitive type cannot be batched
+	bool add(const Key& state, const float * mv, const Color& color,
+		const Point2 * verts, const Color * cols, const index_t * indices, int num,
+		const Point2 * texcs=0);
+
+	/// Get number of buckets waiting to be drawn
+	unsigned size() const { return mNumBuckets; }
+
+	/// Get render state of a bucket waiting to be drawn
+	const Key& key(unsigned i) const { return mBuckets[i].key; }
+
+	/// Get window space vertices of a bucket waiting to be drawn
+	const std::vector<Point2>& vertices(unsigned i) const { return mBuckets[i].verts; }
+
+	/// Get vertex colors of a bucket waiting to be drawn
+	const std::vector<Color>& colors(unsigned i) const { return mBuckets[i].cols; }
+
+	/// Set maximum number of buckets searched back for a matching bucket
+	Batch& searchDepth(unsigned v){ mSearchDepth=v; return *this; }
+
+	/// Get render state tracked while current
+	Backend& state(){ return mState; }
+
+	/// Get current batch or 0 if none
+	static Batch *& current(){
+		static Batch * v = 0;
+		return v;
+	}
+
+private:
+	struct State : public Backend{
+		void paint(int, const float *, int, const Color *, const index_t *, int) override {}
+		void capture();		// read back current GL state
+		int mode() const { return mMatrixMode; }
+		const float * modelView() const { return top(0).m; }
+		const float * projection() const { return top(1).m; }
+	};
+
+	struct Bucket{
+		Key key;
+		float l,t,r,b;	// bounds in window space, y down
+		std::vector<Point2> verts;
+		std::vector<Color> cols;
+		std::vector<Point2> texcs;
+	};
+
+	std::vector<Bucket> mBuckets;
+	std::vector<index_t> mSeq;
+	unsigned mNumBuckets;
+	unsigned mSearchDepth;
+	State mState;
+	float mProj[16];
+	int mViewport[4];
+
+	void applyKey(const Key& k);
+};
+
+/// Draw primitives deferred by current batch, if any
+inline void flushBatch(){ if(Batch::current()) Batch::current()->flush(); }
+
+// Add primitives to current batch, if any. Returns whether they were batched.
+inline bool batched(int prim, const Point2 * verts, const Color * cols, const index_t * indices, int num,
+	const Point2 * texcs=0, unsigned texture=0
+){
+	Batch * b = Batch::current();
+	if(!b) return false;
+	if(b->add(prim, verts, cols, indices, num, texcs, texture)) return true;
+	b->flush();
+	return false;
+}
+
+
 // Basic rendering commands
+void blendEquation(int eq);							///< Set blending equation
 void blendFunc(int sfactor, int dfactor);			///< Set blending function
 void blendTrans();									///< Set blending function to transparent
 void blendAdd();									///< Set blending function to additive
@@ -256,9 +769,11 @@ void lineStipple(char factor, short pattern);		///< Specify line stipple pattern
 void lineStippling(bool v);							///< Enable/disable line stippling
 void lineWidth(float val);							///< Set width of lines
 void matrixMode(int mode);							///< Set current transform matrix
+void multMatrix(const float * m);					///< Multiply current matrix by column-major 4x4 matrix
 void ortho(float l, float r, float b, float t, float n = -1.0f, float f = 1.0f);		///< Set orthographic projection mode
 void paint(int prim, Point2 * verts, int numVerts);	///< Draw array of 2D vertices
 void paint(int prim, const GraphicsData& gb);		///< Render graphics data
+void paint(int prim, const GraphicsData& gb, unsigned texture); ///< Render graphics data textured using its texture coordinates
 void paint(int prim, Point2 * verts, Color * cols, int numVerts);
 void paint(int prim, Point2 * verts, unsigned * indices, int numIndices); ///< Draw indexed array of 2D vertices
 void paint(int prim, Point2 * verts, Color * cols, unsigned * indices, int numIndices); 
@@ -408,7 +923,12 @@ struct Disable{
 	
 	/// Disable a capability
 	const Disable& operator<< (int cap) const {
-		glDisable(cap); UserCommands::get()->disable(cap); return *this;
+		if(Backend::current()) Backend::current()->enable(cap, false);
+		else{
+			if(Batch::current()) Batch::current()->state().enable(cap, false);
+			glDisable(cap);
+		}
+		UserCommands::get()->disable(cap); return *this;
 	}
 };
 
@@ -431,7 +951,12 @@ struct Enable{
 	
 	/// Enable a capability
 	const Enable& operator<< (int cap) const {
-		glEnable(cap); UserCommands::get()->enable(cap); return *this;
+		if(Backend::current()) Backend::current()->enable(cap, true);
+		else{
+			if(Batch::current()) Batch::current()->state().enable(cap, true);
+			glEnable(cap);
+		}
+		UserCommands::get()->enable(cap); return *this;
 	}
 };
 
@@ -681,56 +1206,88 @@ inline void x(float l, float t, float r, float b){ shape(Lines, l,t, r,b, l,b, r
 
 
 inline void paint(int prim, Point2 * verts, int numVerts){
+	stats().painted += numVerts;
+	if(Backend::current()) return Backend::current()->paint(prim, verts->elems, 2, 0, 0, numVerts);
+	if(batched(prim, verts, 0, 0, numVerts)) return;
 	//glEnableClientState(GL_VERTEX_ARRAY);
 	glVertexPointer(2, GL_FLOAT, 0, verts);
 	glDrawArrays(prim, 0, numVerts);
 	//glDisableClientState(GL_VERTEX_ARRAY);
+	++stats().calls; stats().vertices += numVerts;
 }
 
 inline void paint(int prim, Point2 * verts, Color * cols, int numVerts){
+	stats().painted += numVerts;
+	if(Backend::current()) return Backend::current()->paint(prim, verts->elems, 2, cols, 0, numVerts);
+	if(batched(prim, verts, cols, 0, numVerts)) return;
 	glEnableClientState(GL_COLOR_ARRAY);
 	glVertexPointer(2, GL_FLOAT, 0, verts);
 	glColorPointer(4, GL_FLOAT, 0, cols);
 	glDrawArrays(prim, 0, numVerts);
 	glDisableClientState(GL_COLOR_ARRAY);
+	++stats().calls; stats().vertices += numVerts;
 }
 inline void paint(int prim, Point2 * verts, index_t * indices, int numIndices){
+	stats().painted += numIndices;
+	if(Backend::current()) return Backend::current()->paint(prim, verts->elems, 2, 0, indices, numIndices);
+	if(batched(prim, verts, 0, indices, numIndices)) return;
 	glVertexPointer(2, GL_FLOAT, 0, verts);
 	glDrawElements(prim, numIndices, GLV_INDEX, indices);
+	++stats().calls; stats().vertices += numIndices;
 }
 
 inline void paint(int prim, Point2 * verts, Color * cols, index_t * indices, int numIndices){
+	stats().painted += numIndices;
+	if(Backend::current()) return Backend::current()->paint(prim, verts->elems, 2, cols, indices, numIndices);
+	if(batched(prim, verts, cols, indices, numIndices)) return;
 	glEnableClientState(GL_COLOR_ARRAY);
 	glVertexPointer(2, GL_FLOAT, 0, verts);
 	glColorPointer(4, GL_FLOAT, 0, cols);
 	glDrawElements(prim, numIndices, GLV_INDEX, indices);
 	glDisableClientState(GL_COLOR_ARRAY);
+	++stats().calls; stats().vertices += numIndices;
 }
 
 inline void paint(int prim, Point3 * verts, int numVerts){
+	stats().painted += numVerts;
+	if(Backend::current()) return Backend::current()->paint(prim, verts->elems, 3, 0, 0, numVerts);
+	flushBatch();
 	glVertexPointer(3, GL_FLOAT, 0, verts);
 	glDrawArrays(prim, 0, numVerts);
+	++stats().calls; stats().vertices += numVerts;
 }
 
 inline void paint(int prim, Point3 * verts, Color * cols, int numVerts){
+	stats().painted += numVerts;
+	if(Backend::current()) return Backend::current()->paint(prim, verts->elems, 3, cols, 0, numVerts);
+	flushBatch();
 	glEnableClientState(GL_COLOR_ARRAY);
 	glVertexPointer(3, GL_FLOAT, 0, verts);
 	glColorPointer(4, GL_FLOAT, 0, cols);
 	glDrawArrays(prim, 0, numVerts);
 	glDisableClientState(GL_COLOR_ARRAY);
+	++stats().calls; stats().vertices += numVerts;
 }
 
 inline void paint(int prim, Point3 * verts, index_t * indices, int numIndices){
+	stats().painted += numIndices;
+	if(Backend::current()) return Backend::current()->paint(prim, verts->elems, 3, 0, indices, numIndices);
+	flushBatch();
 	glVertexPointer(3, GL_FLOAT, 0, verts);
 	glDrawElements(prim, numIndices, GLV_INDEX, indices);
+	++stats().calls; stats().vertices += numIndices;
 }
 
 inline void paint(int prim, Point3 * verts, Color * cols, index_t * indices, int numIndices){
+	stats().painted += numIndices;
+	if(Backend::current()) return Backend::current()->paint(prim, verts->elems, 3, cols, indices, numIndices);
+	flushBatch();
 	glEnableClientState(GL_COLOR_ARRAY);
 	glVertexPointer(3, GL_FLOAT, 0, verts);
 	glColorPointer(4, GL_FLOAT, 0, cols);
 	glDrawElements(prim, numIndices, GLV_INDEX, indices);
 	glDisableClientState(GL_COLOR_ARRAY);
+	++stats().calls; stats().vertices += numIndices;
 }
 
 // [-2,-1) -> -1.5
@@ -782,16 +1339,20 @@ inline void scissorGUI(int l, int t, int w, int h, int windowH){
 
 
 // platform dependent
-inline void blendFunc(int s, int d){ glBlendFunc(s,d); UserCommands::get()->blendFunc(s,d); }
-inline void blendAdd(){ glBlendEquation(GL_FUNC_ADD); blendFunc(GL_SRC_COLOR, GL_ONE); }
-inline void blendTrans(){ glBlendEquation(GL_FUNC_ADD); blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); }
-inline void clear(int mask){ glClear(mask); }
-inline void clearColor(float r, float g, float b, float a){ glClearColor(r,g,b,a); }
-inline void color(float r, float g, float b, float a){ glColor4f(r,g,b,a); }
-inline void identity(){ glLoadIdentity(); }
+#define BACKEND_OR(command) if(Backend * be_ = Backend::current()) be_->command; else
+// state that batched paints depend on is tracked by the current batch
+#define TRACKED(command, gl) BACKEND_OR(command) { if(Batch * ba_ = Batch::current()) ba_->state().command; gl; }
+inline void blendEquation(int eq){ TRACKED(blendEquation(eq), glBlendEquation(eq)) }
+inline void blendFunc(int s, int d){ TRACKED(blendFunc(s,d), glBlendFunc(s,d)) UserCommands::get()->blendFunc(s,d); }
+inline void blendAdd(){ blendEquation(GL_FUNC_ADD); blendFunc(GL_SRC_COLOR, GL_ONE); }
+inline void blendTrans(){ blendEquation(GL_FUNC_ADD); blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); }
+inline void clear(int mask){ BACKEND_OR(clear(mask)) { flushBatch(); glClear(mask); } }
+inline void clearColor(float r, float g, float b, float a){ BACKEND_OR(clearColor(Color(r,g,b,a))) glClearColor(r,g,b,a); }
+inline void color(float r, float g, float b, float a){ TRACKED(color(Color(r,g,b,a)), glColor4f(r,g,b,a)) }
+inline void identity(){ TRACKED(identity(), glLoadIdentity()) }
 inline void lineStipple(char factor, short pattern){
 #ifndef GLV_OPENGL_ES1
-	glLineStipple(factor, pattern);
+	if(!Backend::current()) glLineStipple(factor, pattern);
 #endif
 }
 
@@ -805,8 +1366,9 @@ inline void lineStippling(bool v){
 }
 #endif
 
-inline void lineWidth(float v){ glLineWidth(v); UserCommands::get()->lineWidth(v); }
-inline void matrixMode(int mode){ glMatrixMode(mode); }
+inline void lineWidth(float v){ TRACKED(lineWidth(v), glLineWidth(v)) UserCommands::get()->lineWidth(v); }
+inline void matrixMode(int mode){ TRACKED(matrixMode(mode), glMatrixMode(mode)) }
+inline void multMatrix(const float * m){ TRACKED(multMatrix(m), glMultMatrixf(m)) }
 inline void ortho(float l, float r, float b, float t, float n, float f){ 
 	float W = r-l; float W2 = r+l;
 	float H = t-b; float H2 = t+b;
@@ -823,7 +1385,7 @@ inline void ortho(float l, float r, float b, float t, float n, float f){
     GLint loc = glGetUniformLocation(draw::shaderProgram(), "Projection");
     glUniformMatrix4fv(loc, 1, 0, m);
 #else
-	glMultMatrixf(m);
+	multMatrix(m);
 #endif
 }
 
@@ -835,23 +1397,28 @@ inline void perspective(float fovy, float aspect, float near, float far) {
 		0, 0, (far+near)/(near-far), -1, 
 		0, 0, (2*far*near)/(near-far), 0 
 	};
-	glMultMatrixf(m);
+	multMatrix(m);
 }
 
-inline void pointSize(float v){ glPointSize(v); UserCommands::get()->pointSize(v); }
+inline void pointSize(float v){ TRACKED(pointSize(v), glPointSize(v)) UserCommands::get()->pointSize(v); }
 inline void pointAtten(float c2, float c1, float c0){
+	if(Backend::current()) return;
 	GLfloat att[3] = {c0, c1, c2};
 	glPointParameterfv(GL_POINT_DISTANCE_ATTENUATION, att);
 }
-inline void push(){ glPushMatrix(); }
-inline void pop() { glPopMatrix(); }
-inline void rotateX(float deg){ glRotatef(deg, 1.f, 0.f, 0.f); }
-inline void rotateY(float deg){ glRotatef(deg, 0.f, 1.f, 0.f); }
-inline void rotateZ(float deg){ glRotatef(deg, 0.f, 0.f, 1.f); }
-inline void scale(float x, float y, float z){ glScalef(x,y,z); }
-inline void scissor(int x, int y, int w, int h){ glScissor(x,y,w,h); }
-inline void translate(float x, float y, float z){ glTranslatef(x,y,z); }
-inline void viewport(float x, float y, float w, float h){ glViewport((GLint)x,(GLint)y,(GLsizei)w,(GLsizei)h); }
+inline void push(){ TRACKED(push(), glPushMatrix()) }
+inline void pop() { TRACKED(pop(), glPopMatrix()) }
+inline void rotateX(float deg){ TRACKED(rotate(deg, 1.f, 0.f, 0.f), glRotatef(deg, 1.f, 0.f, 0.f)) }
+inline void rotateY(float deg){ TRACKED(rotate(deg, 0.f, 1.f, 0.f), glRotatef(deg, 0.f, 1.f, 0.f)) }
+inline void rotateZ(float deg){ TRACKED(rotate(deg, 0.f, 0.f, 1.f), glRotatef(deg, 0.f, 0.f, 1.f)) }
+inline void scale(float x, float y, float z){ TRACKED(scale(x,y,z), glScalef(x,y,z)) }
+inline void scissor(int x, int y, int w, int h){ TRACKED(scissor(x,y,w,h), glScissor(x,y,w,h)) }
+inline void translate(float x, float y, float z){ TRACKED(translate(x,y,z), glTranslatef(x,y,z)) }
+inline void viewport(float x, float y, float w, float h){
+	TRACKED(viewport((int)x,(int)y,(int)w,(int)h), glViewport((GLint)x,(GLint)y,(GLsizei)w,(GLsizei)h))
+}
+#undef TRACKED
+#undef BACKEND_OR
 
 } // draw::
 
@@ -4,9 +4,12 @@
 /*	Graphics Library of Views (GLV) - GUI Building Toolkit
 	See COPYRIGHT file for authors and license information */
 
-namespace glv{
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "glv_draw.h" // GraphicsData
 
-class GraphicsData;
+namespace glv{
 
 /// Font
 class Font{
@@ -27,8 +30,17 @@ public:
 	/// Render text string
 	virtual void render(const char * text, float x=0, float y=0, float z=0) const;
 
+	/// Render text string using a graphics buffer
+
+	/// Glyphs are tessellated once per font scale and shared between all
+	/// fonts. If text caching is on, the vertices of the whole string are also
+	/// kept, and drawn from a GPU buffer, while the text, position and font
+	/// are unchanged.
 	virtual void render(GraphicsData& g, const char * text, float x=0, float y=0, float z=0) const;
 
+	/// Set whether to cache the vertices of rendered strings
+	Font& cacheText(bool v);
+
 	/// Set spacing, in ems, between the left and right edges of successive letters
 	Font& letterSpacing(float v);
 
@@ -61,12 +73,55 @@ public:
 	/// Get number of spaces per tab
 	unsigned tabSpaces() const { return mTabSpaces; }
 
+	/// Get whether the vertices of rendered strings are cached
+	bool cacheText() const { return mCacheText; }
+
+	/// Get number of strings in text cache
+	unsigned cachedTexts() const { return mTexts[0].size() + mTexts[1].size(); }
+
 private:
+	struct TextMesh{
+		std::string text;
+		float x, y;
+		GraphicsData lines;		// line vertices, kept on the GPU
+	};
+	typedef std::unordered_map<unsigned long long, TextMesh> TextMeshes;
+
 	float mSize;
 	float mScaleX, mScaleY;
 	float mLetterSpacing;
 	float mLineSpacing;
 	unsigned mTabSpaces;
+	bool mCacheText;
+	mutable TextMeshes mTexts[2];	// most and least recently used strings
+
+	const TextMesh& textMesh(const char * text, float x, float y) const;
+	void clearTexts(){ mTexts[0].clear(); mTexts[1].clear(); }
+};
+
+
+
+/// Font that draws glyphs as textured quads
+
+/// The stroked glyph outlines are rasterized once per font size into an alpha
+/// texture atlas shared by all atlas fonts of that size. Each character is then
+/// drawn as a single quad, so long text needs far fewer vertices and, while a
+/// draw batch is current, text from many Views is drawn with one call. Text
+/// is stroked while a draw::Backend is current.
+class AtlasFont : public Font{
+public:
+	AtlasFont(float size=8);
+
+	using Font::render;
+
+	virtual void render(GraphicsData& g, const char * text, float x=0, float y=0, float z=0) const;
+
+	/// Build textured quads of text without drawing them
+
+	/// Each character is two triangles whose texture coordinates address its
+	/// cell in the atlas.
+	/// \returns false if text is null
+	bool mesh(GraphicsData& g, const char * text, float x=0, float y=0) const;
 };
 
 } // glv::
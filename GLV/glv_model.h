@@ -5,6 +5,7 @@
 	See COPYRIGHT file for authors and license information */
 
 #include "glv_conf.h"
+#include <atomic>
 #include <map>
 #include <memory>
 #include <vector>
@@ -74,52 +75,6 @@ int fromToken(Data& dst, const std::string& src);
 
 
 
-class ReferenceCounter {
-public:
-
-	/// Returns number of pointers to memory address being managed
-	static int references(void * const m){ return counting(m) ? refCount()[m] : 0; }
-
-protected:
-	typedef std::map<void *, int> RefCount;
-
-	// Begin counting reference or increment count if already counting
-	static void acquire(void * m){
-		if(!m) return; // do not count null pointers for obvious reasons
-		counting(m) ? ++refCount()[m] : refCount()[m]=1;
-	}
-	
-	// Increment count of reference if reference is being counted
-	static void incrementCount(void * m){
-		if(counting(m))	++refCount()[m];
-	}
-
-	// Returns true if the reference was being counted and can now be freed
-	static bool release(void * m){
-		if(counting(m)){
-			int& c = refCount()[m];
-			if(1==c){
-				refCount().erase(m);
-				return true;
-			}
-			--c;
-		}
-		return false;
-	}
-
-	static RefCount& refCount(){
-		static RefCount * o = new RefCount;
-		return *o;
-	}
-	
-	// is reference being counted already?
-	static bool counting(void * const m){ return refCount().count(m) != 0; }
-//	static bool owner(void * const m){ return references(m) != 1; }
-};
-
-
-
-
 /// Iterates through multidmensional arrays
 class Indexer{
 public:
@@ -195,6 +150,65 @@ protected:
 #endif
 
 
+/// Typed view of the elements of a Data
+
+/// A view gives direct access to elements of a known type without the
+/// per element type dispatch of Data::at(). It does not own the elements and
+/// becomes invalid when the viewed Data is resized or destroyed.
+template <class T>
+class DataView{
+public:
+
+	/// Construct an invalid view
+	DataView(): mElems(0), mStride(0){ for(int i=0; i<DATA_MAXDIM; ++i) mSizes[i]=0; }
+
+	/// \param[in] elems	pointer to first element
+	/// \param[in] stride	element stride
+	/// \param[in] sizes	sizes of all DATA_MAXDIM dimensions
+	DataView(T * elems, int stride, const int * sizes): mElems(elems), mStride(stride){
+		for(int i=0; i<DATA_MAXDIM; ++i) mSizes[i]=sizes[i];
+	}
+
+	/// Get element at 1D index
+	T& operator[](int i) const { return mElems[i*mStride]; }
+
+	/// Get element at 1D index
+	T& operator()(int i) const { return mElems[i*mStride]; }
+
+	/// Get element at 2D index
+	T& operator()(int i1, int i2) const { return (*this)[i1 + mSizes[0]*i2]; }
+
+	/// Get element at 3D index
+	T& operator()(int i1, int i2, int i3) const { return (*this)(i1, i2 + mSizes[1]*i3); }
+
+	/// Get element at 4D index
+	T& operator()(int i1, int i2, int i3, int i4) const { return (*this)(i1, i2, i3 + mSizes[2]*i4); }
+
+	/// Get pointer to first element
+	T * elems() const { return mElems; }
+
+	/// Get size array
+	const int * shape() const { return mSizes; }
+
+	/// Get total number of elements
+	int size() const { int r=1; for(int i=0; i<DATA_MAXDIM; ++i) r*=mSizes[i]; return r; }
+
+	/// Get size of a dimension
+	int size(int d) const { return mSizes[d]; }
+
+	/// Get element stride
+	int stride() const { return mStride; }
+
+	/// Returns whether the view references elements
+	bool valid() const { return mElems!=0; }
+
+protected:
+	T * mElems;
+	int mStride;
+	int mSizes[DATA_MAXDIM];
+};
+
+
 /// Dynamically typed multidimensional array of primitive values
 
 /// For operations between data with different types, standard type conversions
@@ -202,7 +216,7 @@ protected:
 /// For binary operations between arrays, each array is treated as a 
 /// one-dimensional array. If the number of elements differ, then the maximum 
 /// possible number of elements are used in the comparison.
-class Data : public ReferenceCounter {
+class Data{
 public:
 
 	/// Data types
@@ -223,6 +237,25 @@ public:
 	/// Value returned by various member functions when they fail
 	static const int npos = static_cast<int>(-1);
 
+	/// Instruction sets used by numeric kernels
+	enum SIMD{
+		SIMD_NONE=0,	/**< Scalar loops */
+		SIMD_SSE2,		/**< SSE2 */
+		SIMD_AVX2		/**< AVX2 */
+	};
+
+	/// Get instruction set used by numeric kernels
+
+	/// Contiguous float, double and int arrays of the same type are added,
+	/// compared and mixed with vector instructions selected at runtime
+	/// according to the CPU.
+	static SIMD simd();
+
+	/// Set highest instruction set numeric kernels may use, e.g., for benchmarking
+
+	/// \returns instruction set that will be used
+	static SIMD simd(SIMD max);
+
 
 	/// This sets the data type to void and does not allocate memory
 	Data();
@@ -374,6 +407,21 @@ public:
 	/// Get number of dimensions sized larger than 1
 	int order() const;
 	
+	/// Get number of Data sharing the elements or 0 if the elements are external
+
+	/// Elements allocated by Data carry their own atomic reference count, so
+	/// copies and slices can be made and released from different threads.
+	/// Elements mapped from a binary snapshot file share one count per file.
+	int references() const { return mBlock ? mBlock->refs.load(std::memory_order_relaxed) : 0; }
+
+	/// Get number of Data sharing elements allocated by Data
+
+	/// \param[in] elems	first element allocated by a Data or 0. Elements
+	///						that are external or mapped from a file must not be
+	///						passed.
+	/// \deprecated Use the non-static references() of a Data sharing the elements.
+	static int references(const void * elems);
+
 	/// Returns reversed slice
 	Data reversed() const { return slice((size()-1)*stride(), size(), -stride()); }
 	
@@ -501,6 +549,30 @@ public:
 	template <class T>
 	const T * elems() const { return (const T *)mElems; }
 
+	/// Get typed view of elements or an invalid view if the type differs
+	template <class T>
+	DataView<T> view(){
+		return getType<T>() == type() ? DataView<T>(elems<T>(), stride(), shape()) : DataView<T>();
+	}
+
+	/// Get typed view of elements or an invalid view if the type differs
+	template <class T>
+	DataView<const T> view() const {
+		return getType<T>() == type() ? DataView<const T>(elems<T>(), stride(), shape()) : DataView<const T>();
+	}
+
+	/// Call a function with a typed view of the elements
+
+	/// The element type is resolved once so that the function can loop over
+	/// the elements without dispatching on the type of each one. The function
+	/// is called with a DataView of bool, int, float or double elements, so it 
+	/// is usually a generic lambda. Returns false, without calling the 
+	/// function, if the type is not numerical.
+	template <class F> bool visit(F f);
+
+	/// Call a function with a typed view of the constant elements
+	template <class F> bool visit(F f) const;
+
 	// TODO: insert elements
 //	// src			source array
 //	// count		number of source elements
@@ -591,6 +663,19 @@ public:
 protected:
 	typedef char* pointer;		// pointer to memory address;
 								// char vs. void to simplify pointer arithmetic
+	friend class ModelManager;
+
+	// Header allocated in front of elements owned by Data. A block can also
+	// manage foreign memory, such as a mapped file, in which case 'free'
+	// releases it and the elements can be anywhere inside it.
+	struct Block{
+		std::atomic<int> refs;	// number of Data sharing the elements
+		Type type;
+		int size;
+		void (*free)(Block *);	// frees foreign memory; 0 if elements follow header
+	};
+
+	Block * mBlock;				// header of shared elements or 0 if external
 	pointer mData;				// pointer to first element of source data
 	pointer mElems;				// pointer to first element in this slice
 	int mStride;				// stride factor
@@ -604,13 +689,21 @@ protected:
 	const T * data() const { return (const T *)mData; }
 
 	void init(){ // zeros all attributes (used in c'tor)
-		mData=0; mElems=0; mStride=1; mType=NONE;
+		mBlock=0; mData=0; mElems=0; mStride=1; mType=NONE;
 		shapeAll(0);
 	}
 	
 	// Reallocate memory; returns size change, in bytes
 	int realloc(Data::Type type, const int * sizes=0, int n=0);
-	void setRaw(void * data, int offset, int stride, Type type);
+	void setRaw(void * data, Block * block, int offset, int stride, Type type);
+
+	static Block * allocBlock(Type type, int size);
+	static void releaseBlock(Block * b);
+	static pointer blockElems(Block * b);
+	static int blockHeaderBytes();
+
+	// Map file into memory; returns block managing the memory or 0 on failure
+	static Block * mapFile(const char * path, const char *& bytes, size_t& size);
 	int sizeBytes() const { return size()*sizeType(); }
 	
 	static int product(const int * v, int n){
@@ -618,6 +711,12 @@ protected:
 		return 0;
 	}
 
+	// Kernels for same-typed, contiguous numeric arrays.
+	// These return false if the arrays do not qualify.
+	static bool addKernel(Data& dst, const Data& src, int n);
+	static bool equalKernel(const Data& a, const Data& b, int n, bool& res);
+	static bool mixKernel(Data& dst, const Data * const * src, const double * c, int m, int n);
+
 	template <int N, class T>
 	static bool notEqual(const T* v){
 		for(int i=1; i<N; ++i){ if(v[0] != v[i]) return true; }
@@ -705,7 +804,7 @@ public:
 	public:
 		const Val& operator[](const Key& key) const {
 			static const Val null;
-			typename Map::const_iterator it = find(key);
+			typename Map::const_iterator it = this->find(key);
 			return (it!=this->end()) ? it->second : null;
 		}
 		Val& operator[](const Key& key){ return this->std::map<Key,Val>::operator[](key); }
@@ -752,12 +851,36 @@ public:
 
 	/// Load snapshots from a file
 
+	/// Files written by snapshotsToBinaryFile are detected and loaded with
+	/// snapshotsFromBinaryFile.
 	/// \param[in] path				path to file;
 	///								if empty, then uses model name with ".txt" extension
 	/// \param[in] addtoExisting	whether to add to or replace any existing snapshots
 	/// \returns					number of characters read
 	int snapshotsFromFile(const std::string& path="", bool addtoExisting=true);
 
+	/// Save all snapshots to a binary file
+
+	/// The binary format stores an index of snapshot and model names followed
+	/// by the arrays as aligned, little-endian values. It is much faster to
+	/// load than the text format, but cannot be edited by hand.
+	/// \param[in] path		path to file; if empty, then uses default file
+	///						path with ".glvs" extension
+	/// \returns			number of bytes written
+	int snapshotsToBinaryFile(const std::string& path="") const;
+
+	/// Load snapshots from a binary file
+
+	/// Where possible, the file is memory mapped and numerical arrays
+	/// reference the mapped pages directly. They are copied only when cloned
+	/// (e.g., by Data::clone) or modified.
+	/// \param[in] path				path to file; if empty, then uses default
+	///								file path with ".glvs" extension
+	/// \param[in] addtoExisting	whether to add to or replace any existing snapshots
+	/// \returns					size of file in bytes or 0 if the file
+	///								could not be read
+	int snapshotsFromBinaryFile(const std::string& path="", bool addtoExisting=true);
+
 	/// Set snapshots from a table string. If a snapshot does not exist, a new one will be created.
 	int snapshotsFromString(const std::string& src);
 
@@ -844,6 +967,12 @@ public:
 	/// Zero values with magnitude less than eps
 	void zeroSmallValues(double eps=1e-12);
 
+	/// Get hash of the names and current values of all models
+
+	/// The hash is computed from the text form of the values so that it is
+	/// the same across builds and platforms.
+	unsigned long long stateHash() const;
+
 protected:
 	std::string mName;				// name identifier
 	std::string mFileDir, mFileName;// directory and name of file
@@ -859,6 +988,7 @@ protected:
 	//int stateFromToken(const std::string& src);
 
 	bool defaultFilePath(std::string& s) const;
+	bool defaultBinaryFilePath(std::string& s) const;
 
 	//template <int N> bool loadSnapshot(const std::string ** names, const double * c);
 	//template <int N> bool loadSnapshot(const Snapshot ** snapshots, const double * c);
@@ -950,6 +1080,23 @@ inline std::string Data::at<std::string>(int i) const {
 	#undef CS
 }
 
+#define DATA_VISIT\
+	switch(type()){\
+	case Data::BOOL:	f(view<bool>());	return true;\
+	case Data::INT:		f(view<int>());		return true;\
+	case Data::FLOAT:	f(view<float>());	return true;\
+	case Data::DOUBLE:	f(view<double>());	return true;\
+	default:			return false;\
+	}
+
+template <class F>
+bool Data::visit(F f){ DATA_VISIT }
+
+template <class F>
+bool Data::visit(F f) const { DATA_VISIT }
+
+#undef DATA_VISIT
+
 template <class T>
 inline T Data::at(int i1, int i2) const { return at<T>(indexFlat(i1,i2)); }
 
@@ -961,7 +1108,7 @@ inline T Data::at(int i1, int i2, int i3, int i4) const { return at<T>(indexFlat
 
 #define DATA_SET(t, T)\
 template<> inline Data& Data::set<t>(t * src, const int * sizes, int n){\
-	setRaw(src,0,1,Data::T); shape(sizes,n); return *this;\
+	setRaw(src,0,0,1,Data::T); shape(sizes,n); return *this;\
 }\
 template<> inline Data& Data::set<const t>(const t * src, const int * sizes, int n){\
 	if(product(sizes,n)!=size() || Data::T!=type()) realloc(Data::T, sizes,n);\
@@ -1009,7 +1156,8 @@ void Data::mix(const Data* D[], double c[]){
 				&& (d.type() != Data::BOOL);
 	}
 
-	// TODO: make this more efficient...
+	if(isNum && mixKernel(*this, D, c, M, N)) return;
+
 	if(isNum){
 		double v[M];
 	
@@ -118,7 +118,7 @@ public:
 
 	Notifier();
 
-	~Notifier();
+	virtual ~Notifier();
 
 
 	/// Attach a new notification callback, type, and receiver
@@ -148,6 +148,9 @@ public:
 
 protected:
 
+	/// Called by notify() before the observers are notified
+	virtual void onNotify(void * sender, Update::t type, void * data){}
+
 	struct Handler{
 		Handler(Callback c, void * r): handler(c), receiver(r){}
 		Callback handler;
@@ -117,6 +117,22 @@ public:
 	/// Hint to specify which region of the Data is updated
 	Plottable& updateRegion(int x, int y, int w, int h);
 
+	/// Set whether graphics maps may run on a worker thread when the Plot maps in parallel
+
+	/// This should be disabled if any graphics map is shared with another
+	/// Plottable or otherwise cannot run concurrently with other maps. Such
+	/// Plottables are mapped on the drawing thread. The default is true.
+	Plottable& concurrentMap(bool v){ mConcurrentMap=v; return *this; }
+
+	/// Get whether graphics maps may run on a worker thread
+	bool concurrentMap() const { return mConcurrentMap; }
+
+	/// Get interval of plot axis visible in the Plot being drawn
+	const Interval<double>& visibleInterval(int dim) const { return mVisible[dim]; }
+
+	/// Get size, in pixels, of plot axis in the Plot being drawn or 0 if unknown
+	float visiblePixels(int dim) const { return mVisiblePixels[dim]; }
+
 	/// Add a graphics map
 	Plottable& add(GraphicsMap& v);
 
@@ -129,6 +145,12 @@ public:
 	// Plot (map and draw) data
 	virtual void doPlot(GraphicsData& gd, const Data& d);
 
+	// Map data into graphics data with all graphics maps
+	void doMap(GraphicsData& gd, const Data& d);
+
+	// Draw graphics data mapped from data
+	void doDraw(GraphicsData& gd, const Data& d);
+
 protected:
 	friend class Plot;
 	typedef std::vector<GraphicsMap *> GraphicsMaps;
@@ -146,13 +168,26 @@ protected:
 	bool mDrawUnder;
 	bool mUseStyleColor;
 	bool mActive;
+	bool mConcurrentMap;
 	struct POD2{} mPOD2;
+	Interval<double> mVisible[2];
+	float mVisiblePixels[2];
 };
 
 
 
 
 /// Density plotter
+
+/// Data values are colored into a persistent RGBA staging copy of the texture.
+/// By default, all texels are colored and uploaded every frame. When regions
+/// are hinted with updateRegion(), only those accumulated since the previous
+/// frame are colored and uploaded. The whole texture is colored again when the
+/// data is resized or reallocated or the plot color changes.
+///
+/// Other GraphicsMaps added to the plot may instead add one color per texel
+/// to the graphics data. These colors then replace the colored texels and the
+/// whole texture is uploaded.
 class PlotDensity : public Plottable{
 public:
 
@@ -170,7 +205,10 @@ public:
 	/// Set rectangular plotting region
 	PlotDensity& plotRegion(const Interval<double>& vx, const Interval<double>& vy);
 
-	/// Set update region (of texture)
+	/// Hint region of Data that has changed since the last frame
+
+	/// Regions hinted between frames are merged. A negative width or height
+	/// returns to updating the whole texture every frame.
 	PlotDensity& updateRegion(int x, int y, int w, int h);
 
 //	static GraphicsMap& defaultColorMap();
@@ -187,10 +225,26 @@ protected:
 	void onContextCreate() override;
 	void onContextDestroy() override;
 	void onDraw(GraphicsData& gd, const Data& d) override;
+
+	// Copy colors added by other GraphicsMaps into texels; returns whether any
+	bool texelsFromColors(const GraphicsData& gd, const Data& d);
+
 	Texture2 mTex;
 	Interval<double> mRegion[2];
 	float mHueSpread;
 	int mIpol;
+
+	std::vector<Color8> mTexels;		// staging copy of texture
+	std::vector<Color8> mColorMap;	// colors of values in [-1,1]
+	float mHueFactors[3];			// per channel factors of hue for saturation
+	Color mMapColor;				// plot color colormap was made for
+	float mMapHueSpread;
+	const void * mMappedElems;		// storage of Data last colored
+	int mMappedType, mMappedStride;
+	int mTexSize[2];
+	int mHint[4];		// merged hinted region, x0,y0,x1,y1; empty if x0>=x1
+	int mUpload[4];		// region of texels changed since last upload
+	bool mHinting;		// whether regions are hinted
 };
 
 
@@ -230,6 +284,23 @@ public:
 	/// Set drawing path style
 	PlotFunction1D& pathStyle(PathStyle v){ mPathStyle=v; return *this; }
 
+	/// Set whether to decimate samples to the pixel columns of the Plot
+
+	/// When decimating, only samples within the visible interval are mapped
+	/// and, if there are more than two per pixel, each pixel column is drawn
+	/// as the minimum and maximum of its samples. These are found from a
+	/// min/max pyramid over the data, so the cost depends on the number of
+	/// pixels rather than samples. The pyramid is rebuilt when the data is
+	/// resized or reallocated. If samples are changed in place, the changed
+	/// region must be passed to updateRegion().
+	PlotFunction1D& decimate(bool v){ mDecimate=v; return *this; }
+
+	/// Get whether samples are decimated to pixel columns
+	bool decimate() const { return mDecimate; }
+
+	/// Hint to specify which region of the Data is updated
+	PlotFunction1D& updateRegion(int x, int y, int w, int h);
+
 	void onMap(GraphicsData& b, const Data& d, const Indexer& ind) override;
 
 //	static GraphicsMap& defaultVertexMap();
@@ -239,8 +310,17 @@ public:
 //	};
 
 protected:
+	struct MinMax{ float min, max; };
+
 	PathStyle mPathStyle;
 	int mDomainOffset;
+	bool mDecimate;
+
+	// Pyramid level k holds the extrema of blocks of 8<<k samples
+	std::vector<std::vector<MinMax>> mPyramid;
+	const void * mPyramidElems;
+	int mPyramidSize, mPyramidType, mPyramidStride;
+	int mDirty[4];	// x and y ranges of samples changed since last update
 };
 
 
@@ -287,12 +367,36 @@ public:
 
 	Plot& remove(Plottable& v);
 
+	/// Set whether Plottables are mapped in parallel
+
+	/// In parallel mode, each active Plottable maps its data into its own
+	/// GraphicsData on a pool of worker threads shared by all Plots. The
+	/// drawing thread waits for all maps to finish and then draws the results
+	/// in order. Plottable::doMap and Plottable::doDraw are called instead of
+	/// Plottable::doPlot. Plottables with concurrentMap disabled are mapped on
+	/// the drawing thread.
+	Plot& parallelMap(bool v){ mParallelMap=v; return *this; }
+
+	/// Get whether Plottables are mapped in parallel
+	bool parallelMap() const { return mParallelMap; }
+
+	/// Set number of worker threads used for parallel mapping
+
+	/// The default is one less than the number of hardware threads. The
+	/// drawing thread also maps, so 0 maps serially.
+	static void mapThreads(int n);
+
+	/// Get number of worker threads used for parallel mapping
+	static int mapThreads();
+
 	const char * className() const override { return "Plot"; }
 	void onDraw(GLV& g) override;
 	bool onEvent(Event::t e, GLV& g) override;
 
 protected:
 	Plottables mPlottables;
+	std::vector<GraphicsData> mMapped;	// graphics of each Plottable
+	bool mParallelMap;
 };
 
 
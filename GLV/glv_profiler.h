@@ -0,0 +1,193 @@
+#ifndef INC_GLV_PROFILER_H
+#define INC_GLV_PROFILER_H
+
+/*	Graphics Library of Views (GLV) - GUI Building Toolkit
+	See COPYRIGHT file for authors and license information */
+
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "glv_core.h"
+
+namespace glv{
+
+/// Times the callbacks of each View over recent frames
+
+/// When attached to a GLV, every frame drawn by GLV::drawWidgets() is
+/// recorded into a ring of recent frames. Each call to a View's onAnimate,
+/// onDataModelSync, rectifyGeometry, draw handlers and draw is timed with a
+/// high-resolution clock along with the number of vertices painted while
+/// drawing. Timings can be queried by class name or View name, or written out
+/// as Chrome trace JSON for viewing in chrome://tracing or Perfetto.
+///
+/// When no profiler is attached the GLV only tests a null pointer around each
+/// callback.
+class FrameProfiler{
+public:
+
+	/// Timed phases of a frame
+	enum Phase{
+		Animate,		///< View::onAnimate
+		DataModelSync,	///< View::onDataModelSync
+		Geometry,		///< View::rectifyGeometry
+		DrawHandlers,	///< Draw handlers added to View
+		Draw,			///< View::doDraw, including draw handlers
+		NumPhases
+	};
+
+	/// Get name of phase
+	static const char * phaseName(Phase p);
+
+	/// Timings of one View over one or more frames
+	struct ViewTiming{
+		ViewTiming(): view(0), className(""), vertices(0){
+			for(double& v : seconds) v = 0;
+		}
+
+		/// Get total time, in seconds, excluding draw handlers counted by Draw
+		double total() const { return seconds[Animate] + seconds[DataModelSync] + seconds[Geometry] + seconds[Draw]; }
+
+		const View * view;			///< View timed, may no longer exist
+		const char * className;		///< Class name of View
+		std::string name;			///< Name of View
+		double seconds[NumPhases];	///< Time spent in each phase
+		unsigned vertices;			///< Number of vertices painted while drawing
+	};
+
+	/// One timed call
+	struct Sample{
+		int view;			///< Index of View in frame
+		Phase phase;		///< Phase timed
+		double start;		///< Start time, in seconds since profiler epoch
+		double duration;	///< Duration, in seconds
+	};
+
+	/// Timings of one frame
+	struct Frame{
+		unsigned number;				///< Sequence number of frame
+		double start;					///< Start time, in seconds since profiler epoch
+		double duration;				///< Duration, in seconds
+		std::vector<ViewTiming> views;	///< Timings of each View called
+		std::vector<Sample> samples;	///< All timed calls in order of completion
+	};
+
+
+	/// \param[in] frames	number of recent frames to retain
+	FrameProfiler(int frames=60);
+
+	/// Detaches from GLV, if attached
+	~FrameProfiler();
+
+	/// Start profiling frames of a GLV
+	FrameProfiler& attach(GLV& g);
+
+	/// Stop profiling
+	FrameProfiler& detach();
+
+	/// Get whether attached to a GLV
+	bool profiling() const { return 0 != mGLV; }
+
+	/// Remove all frames and restart the epoch
+	FrameProfiler& clear();
+
+	/// Get number of recent frames retained
+	int capacity() const { return int(mFrames.size()) - 1; }
+
+	/// Set number of recent frames retained, removing all frames
+	FrameProfiler& capacity(int frames);
+
+	/// Get number of frames recorded, up to the capacity
+	int frames() const { return mCount; }
+
+	/// Get a recorded frame, 0 being the most recent
+	const Frame& frame(int i=0) const;
+
+	/// Sum the timings of Views matching a class name or name
+
+	/// \param[in] classOrName	class name or name of Views to match
+	/// \param[in] frames		number of most recent frames to sum or 0 for all
+	/// \returns summed timings; the view is set when only one View matches
+	ViewTiming query(const std::string& classOrName, int frames=0) const;
+
+	/// Get all frames as Chrome trace event JSON, oldest first
+	std::string chromeTrace() const;
+
+	/// Write all frames as Chrome trace event JSON to file
+	bool writeChromeTrace(const std::string& path) const;
+
+
+	/// Called by GLV at start of frame
+	void beginFrame();
+
+	/// Called by GLV at end of frame
+	void endFrame();
+
+	/// Times a phase of a View for the duration of its scope
+
+	/// Nothing is timed if the profiler is null or no frame is in progress.
+	///
+	class Scope{
+	public:
+		Scope(FrameProfiler * p, const View& v, Phase ph)
+		:	mProf(p && p->mCurrent ? p : 0)
+		{	if(mProf) mProf->beginScope(*this, v, ph); }
+
+		~Scope(){ if(mProf) mProf->endScope(*this); }
+
+	private:
+		friend class FrameProfiler;
+		FrameProfiler * mProf;
+		int mView;
+		Phase mPhase;
+		std::chrono::steady_clock::time_point mStart;
+		unsigned mPainted;
+	};
+
+private:
+	typedef std::chrono::steady_clock clock;
+	std::vector<Frame> mFrames;	// ring with one frame in progress
+	std::unordered_map<const View *, int> mIndex;	// Views of frame in progress
+	Frame * mCurrent;
+	GLV * mGLV;
+	clock::time_point mEpoch, mFrameStart;
+	int mNext, mCount;
+	unsigned mNumber;
+
+	double since(clock::time_point t) const;
+	void beginScope(Scope& s, const View& v, Phase ph);
+	void endScope(Scope& s);
+};
+
+
+
+/// Overlay showing recent frame times and the slowest Views of a profiler
+
+/// Frame times are drawn as bars, oldest to the left, with a line at 1/60
+/// of a second. The Views taking the most time in the last frame are listed
+/// below.
+class ProfilerView : public View{
+public:
+
+	/// \param[in] p		profiler to show
+	/// \param[in] r		geometry
+	/// \param[in] rows		number of slowest Views to list
+	ProfilerView(const FrameProfiler& p, const Rect& r=Rect(200, 120), int rows=4);
+
+	/// Get number of slowest Views listed
+	int rows() const { return mRows; }
+
+	/// Set number of slowest Views listed
+	ProfilerView& rows(int v){ mRows=v; return *this; }
+
+	void onDraw(GLV& g) override;
+	const char * className() const override { return "ProfilerView"; }
+
+protected:
+	const FrameProfiler& mProfiler;
+	int mRows;
+};
+
+} // glv::
+
+#endif
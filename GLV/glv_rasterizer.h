@@ -0,0 +1,91 @@
+#ifndef INC_GLV_RASTERIZER_H
+#define INC_GLV_RASTERIZER_H
+
+/*	Graphics Library of Views (GLV) - GUI Building Toolkit
+	See COPYRIGHT file for authors and license information */
+
+#include <vector>
+#include "glv_draw.h"
+
+namespace glv{
+namespace draw{
+
+/// Software renderer into an RGBA framebuffer
+
+/// The rasterizer renders draw:: commands on the CPU so that Views can be
+/// drawn without an OpenGL context, e.g., for testing or generating images
+/// on a headless machine. It supports points, lines and triangles (including
+/// strips, loops and fans), per vertex colors, smooth points and lines,
+/// scissoring and the blend functions and equations used by GLV. Textures
+/// and depth testing are not supported.
+///
+/// Example:
+/// \code
+///	draw::Rasterizer ras(400, 300);
+///	ras.begin();
+///	glv.drawGLV(ras.width(), ras.height(), 0);
+///	ras.end();
+///	ras.writePNG("glv.png");
+/// \endcode
+class Rasterizer : public Backend{
+public:
+
+	/// \param[in] width	width of framebuffer, in pixels
+	/// \param[in] height	height of framebuffer, in pixels
+	Rasterizer(int width=0, int height=0);
+
+	~Rasterizer();
+
+	int width() const { return mW; }		///< Get width of framebuffer
+	int height() const { return mH; }		///< Get height of framebuffer
+
+	/// Get framebuffer as interleaved RGBA bytes, top row first
+	const unsigned char * pixels() const { return mPixels.empty() ? 0 : &mPixels[0]; }
+
+	/// Get RGBA bytes of pixel, origin at top-left
+	const unsigned char * pixel(int x, int y) const { return &mPixels[(y*mW + x)*4]; }
+
+	/// Make this the current backend for draw:: commands
+	Rasterizer& begin();
+
+	/// Restore the backend that was current before calling begin()
+	Rasterizer& end();
+
+	/// Resize framebuffer and set viewport to cover it
+	Rasterizer& resize(int width, int height);
+
+	/// Write framebuffer to binary PPM (P6) file. Alpha is discarded.
+	bool writePPM(const char * path) const;
+
+	/// Write framebuffer to RGBA PNG file
+
+	/// The image data is stored uncompressed so that no external
+	/// dependencies are needed.
+	bool writePNG(const char * path) const;
+
+	void paint(int prim, const float * verts, int dim, const Color * cols, const index_t * indices, int num) override;
+	void clear(int mask) override;
+	bool retainsFrame() const override { return true; }
+
+protected:
+	std::vector<unsigned char> mPixels;
+	std::vector<index_t> mSeq;
+	Backend * mPrev;
+	int mW, mH;
+	bool mActive;
+
+	// Get clip box in window coordinates, returns false if empty
+	bool clipBox(int& l, int& b, int& r, int& t) const;
+
+	// Blend color into pixel in window coordinates
+	void fragment(int x, int y, const Color& c, float coverage=1);
+
+	void point(float x, float y, const Color& c, int l, int b, int r, int t);
+	void line(float x0, float y0, float x1, float y1, const Color& c0, const Color& c1, int l, int b, int r, int t);
+	void triangle(const float * xs, const float * ys, const Color * cs, int l, int b, int r, int t);
+};
+
+} // draw::
+} // glv::
+
+#endif
@@ -55,6 +55,10 @@ public:
 
 	const TRect& operator= (const TRect& r);
 
+	/// Returns whether all components are equal
+	bool operator==(const TRect& r) const { return l==r.l && t==r.t && w==r.w && h==r.h; }
+	bool operator!=(const TRect& r) const { return !(*this == r); }
+
 	/// Get a Rect with dimensions offset from arguments
 	TRect getOffset(T dl, T dt, T dw=0, T dh=0) const { return TRect(l+dl,t+dt,w+dw,h+dh); }
 
@@ -124,6 +128,9 @@ public:
 
 	/// Called when the width or height change. Changes in extent are passed in.
 	virtual void onResizeRect(T dx, T dy){}
+
+	/// Called when the left or top edge positions change. Changes in position are passed in.
+	virtual void onMoveRect(T dx, T dy){}
 	
 	void print(FILE * fp=stdout) const;	///< Write about TRect to a file
 	
@@ -131,6 +138,9 @@ private:
 	void onResizeProxy(T dx, T dy){	// calls onResize if at least 1 dimension has changed
 		if(dx!=T(0) || dy!=T(0)) onResizeRect(dx,dy);
 	}
+	void onMoveProxy(T dx, T dy){	// calls onMove if at least 1 coordinate has changed
+		if(dx!=T(0) || dy!=T(0)) onMoveRect(dx,dy);
+	}
 public:
 	void posAdd(T x, T y){translate(x,y);} ///< \deprecated
 };
@@ -142,11 +152,12 @@ public:
 
 #define TEM template <class T>
 
-TEM TRect<T>::TRect(){ set((T)0, (T)0, (T)40, (T)40); }
-TEM TRect<T>::TRect(T v){ set(0, 0, v, v); }
-TEM TRect<T>::TRect(T iw, T ih){ set(0, 0, iw, ih); }
-TEM TRect<T>::TRect(T il, T it, T iw, T ih){ set(il, it, iw, ih); }
-TEM TRect<T>::TRect(const TRect& v){ *this = v; }
+// Members are zeroed first since setters compute changes from them
+TEM TRect<T>::TRect(){ l=t=w=h=T(0); set((T)0, (T)0, (T)40, (T)40); }
+TEM TRect<T>::TRect(T v){ l=t=w=h=T(0); set(0, 0, v, v); }
+TEM TRect<T>::TRect(T iw, T ih){ l=t=w=h=T(0); set(0, 0, iw, ih); }
+TEM TRect<T>::TRect(T il, T it, T iw, T ih){ l=t=w=h=T(0); set(il, it, iw, ih); }
+TEM TRect<T>::TRect(const TRect& v){ l=t=w=h=T(0); *this = v; }
 
 TEM const TRect<T>& TRect<T>::operator= (const TRect<T>& r){
 	set(r.l, r.t, r.w, r.h);
@@ -169,35 +180,34 @@ TEM inline void TRect<T>::extent(T wi, T he){
 TEM inline void TRect<T>::fitSquare(T v){ w > h ? extent(v, v * h/w) : extent(v * w/h, v); }
 
 TEM inline void TRect<T>::fixNegativeExtent(){
-	if(w < (T)0){ w = -w; l -= w; }
-	if(h < (T)0){ h = -h; t -= h; }
+	if(w < (T)0){ w = -w; translate(-w, 0); }
+	if(h < (T)0){ h = -h; translate(0, -h); }
 }
 
-TEM inline void TRect<T>::pos(T le, T to){ l = le; t = to; }
-TEM inline void TRect<T>::translate(T x, T y){ l += x; t += y; }
+TEM inline void TRect<T>::pos(T le, T to){ T dx=le-l, dy=to-t; l = le; t = to; onMoveProxy(dx, dy); }
+TEM inline void TRect<T>::translate(T x, T y){ l += x; t += y; onMoveProxy(x, y); }
 TEM inline void TRect<T>::posRightOf(const TRect<T> & r, T by){ pos(r.right() + by, r.t); }
 
 TEM inline void TRect<T>::posRelTo(const TRect<T>& r, float rxf, float ryf, float xf, float yf, float x, float y){
-	l = r.l + r.w*rxf - w*xf + x;
-	t = r.t + r.h*ryf - h*yf + y;
+	pos(r.l + r.w*rxf - w*xf + x, r.t + r.h*ryf - h*yf + y);
 }
 
 TEM inline void TRect<T>::posUnder(const TRect<T> & r, T by){ pos(r.l, r.bottom() + by); }
-TEM inline void TRect<T>::resizeLeftTo(T v){ T dl = l-v; w += dl; l = v; onResizeProxy(dl, 0); }
-TEM inline void TRect<T>::resizeTopTo(T v){	T dt = t-v; h += dt; t = v; onResizeProxy(0, dt); }
+TEM inline void TRect<T>::resizeLeftTo(T v){ T dl = l-v; w += dl; l = v; onMoveProxy(-dl, 0); onResizeProxy(dl, 0); }
+TEM inline void TRect<T>::resizeTopTo(T v){	T dt = t-v; h += dt; t = v; onMoveProxy(0, -dt); onResizeProxy(0, dt); }
 TEM inline void TRect<T>::resizeRightTo(T v){ width(v - l); }
 TEM inline void TRect<T>::resizeBottomTo(T v){ height(v - t); }
-TEM inline void TRect<T>::resizeEdgesBy(T v){ l -= v; t -= v; extent(w + 2 * v, h + 2 * v); }
+TEM inline void TRect<T>::resizeEdgesBy(T v){ translate(-v, -v); extent(w + 2 * v, h + 2 * v); }
 TEM inline void TRect<T>::set(const TRect<T>& r){ set(r.l, r.t, r.w, r.h); }
 TEM inline void	TRect<T>::set(T le, T to, T wi, T he){ pos(le, to); extent(wi, he); }
 TEM inline void TRect<T>::transpose(){ extent(h, w); }
 
-TEM inline void TRect<T>::left  (T v){ l = v; }
-TEM inline void TRect<T>::top   (T v){ t = v; }
+TEM inline void TRect<T>::left  (T v){ pos(v, t); }
+TEM inline void TRect<T>::top   (T v){ pos(l, v); }
 TEM inline void TRect<T>::width (T v){ extent(v, h); }
 TEM inline void TRect<T>::height(T v){ extent(w, v); }
-TEM inline void TRect<T>::bottom(T v){ t = v - h; }
-TEM inline void TRect<T>::right (T v){ l = v - w; }
+TEM inline void TRect<T>::bottom(T v){ pos(l, v - h); }
+TEM inline void TRect<T>::right (T v){ pos(v - w, t); }
 
 TEM inline T TRect<T>::right() const { return l + w; }
 TEM inline T TRect<T>::bottom() const { return t + h; }
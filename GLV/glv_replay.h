@@ -0,0 +1,157 @@
+#ifndef INC_GLV_REPLAY_H
+#define INC_GLV_REPLAY_H
+
+/*	Graphics Library of Views (GLV) - GUI Building Toolkit
+	See COPYRIGHT file for authors and license information */
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include "glv_core.h"
+
+namespace glv{
+
+/// Histogram of durations in power-of-two buckets of nanoseconds
+class LatencyHistogram{
+public:
+
+	enum{ NumBuckets = 40 };
+
+	LatencyHistogram(){ clear(); }
+
+	/// Add a duration, in seconds
+	void add(double sec);
+
+	/// Remove all durations
+	void clear();
+
+	unsigned count() const { return mCount; }	///< Get number of durations
+	double min() const { return mMin; }			///< Get shortest duration, in seconds
+	double max() const { return mMax; }			///< Get longest duration, in seconds
+	double total() const { return mTotal; }		///< Get sum of durations, in seconds
+	double mean() const { return mCount ? mTotal/mCount : 0; } ///< Get mean duration, in seconds
+
+	/// Get approximate duration, in seconds, below which a fraction of durations fall
+
+	/// The result is the upper edge of the bucket containing the fraction.
+	///
+	double percentile(double frac) const;
+
+	/// Get number of durations in bucket i, from 2^(i-1) to 2^i nanoseconds
+	unsigned bucket(int i) const { return mBuckets[i]; }
+
+	/// Print histogram to stdout
+	void print() const;
+
+private:
+	unsigned mBuckets[NumBuckets];
+	unsigned mCount;
+	double mMin, mMax, mTotal;
+};
+
+
+
+/// Records input events posted to a GLV into a compact binary log
+
+/// Each event is stored with the time since the previous one, in
+/// microseconds, using variable-length integers. Mouse positions are stored
+/// as differences from the previous position so that most events take only
+/// a few bytes.
+class InputRecorder : public InputObserver{
+public:
+
+	InputRecorder();
+
+	/// Detaches from GLV, if attached
+	~InputRecorder();
+
+	/// Start recording events posted to a GLV
+	InputRecorder& attach(GLV& g);
+
+	/// Stop recording
+	InputRecorder& detach();
+
+	/// Remove all recorded events
+	InputRecorder& clear();
+
+	/// Get whether attached to a GLV
+	bool recording() const { return 0 != mGLV; }
+
+	/// Get number of recorded events
+	int size() const { return mCount; }
+
+	/// Get binary log
+	const std::string& log() const { return mLog; }
+
+	/// Write binary log to file
+	bool writeFile(const std::string& path) const;
+
+	void onInput(const InputEvent& e) override;
+
+private:
+	typedef std::chrono::steady_clock clock;
+	std::string mLog;
+	GLV * mGLV;
+	clock::time_point mLast;
+	int mCount;
+	int mX, mY;
+};
+
+
+
+/// Replays a binary input log into a GLV
+
+/// Events are posted to the GLV one at a time, either as fast as possible or
+/// with the recorded timing. The time each event takes to post and dispatch
+/// is collected into a histogram. Input queueing of the GLV is turned off
+/// during replay so that every event is handled when it is posted.
+class InputReplay{
+public:
+
+	InputReplay(){}
+
+	/// \param[in] log		binary log as produced by InputRecorder
+	InputReplay(const std::string& log);
+
+	/// Set binary log
+	InputReplay& log(const std::string& v);
+
+	/// Read binary log from file
+	bool readFile(const std::string& path);
+
+	/// Decode log into events
+
+	/// \returns whether the log is valid
+	///
+	bool events(std::vector<InputEvent>& events, std::vector<double> * times=0) const;
+
+	/// Replay all events
+
+	/// Nothing is posted if the log is invalid.
+	/// \param[in] g			GLV to post events to
+	/// \param[in] realTime		whether to wait between events as recorded
+	/// \returns number of events replayed or -1 if the log is invalid
+	int run(GLV& g, bool realTime=false);
+
+	/// Get histogram of time to handle each event of the last run
+	const LatencyHistogram& latency() const { return mLatency; }
+
+	/// Get hash of model state after the last run
+
+	/// The state is that of the GLV's model manager together with all named
+	/// Views in its tree.
+	unsigned long long stateHash() const { return mStateHash; }
+
+	/// Get duration of the last run, in seconds
+	double seconds() const { return mSeconds; }
+
+private:
+	std::string mLog;
+	LatencyHistogram mLatency;
+	unsigned long long mStateHash = 0;
+	double mSeconds = 0;
+};
+
+} // glv::
+
+#endif
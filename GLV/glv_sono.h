@@ -4,6 +4,7 @@
 /*	Graphics Library of Views (GLV) - GUI Building Toolkit
 	See COPYRIGHT file for authors and license information */
 
+#include <atomic>
 #include <vector>
 #include "glv_core.h"
 #include "glv_plots.h"
@@ -15,8 +16,6 @@ class TimeScope : public Plot{
 public:
 
 	TimeScope(const glv::Rect& r=glv::Rect(200,100), int frames=0, int chans=1);
-	
-	~TimeScope();
 
 	int   frames() const { return data().size(0); }
 	int channels() const { return data().size(1); }
@@ -31,22 +30,49 @@ public:
 
 	/// Update scope with new audio data
 
-	/// This can be safely called from the audio thread.
-	///
+	/// This can be safely called from the audio thread. It never blocks or 
+	/// allocates; the data is queued and moved into the plot on the next 
+	/// animation frame. Only the newest frames of a block larger than the
+	/// queue are kept. If there is not enough room left in the queue, the 
+	/// whole block is dropped and counted by droppedBlocks().
 	void update(const float * buf, int bufFrames, int bufChans, bool interleaved);
 
+	/// Get number of audio blocks dropped by update()
+	unsigned droppedBlocks() const { return mDropped.load(std::memory_order_relaxed); }
+
+	/// Get number of plot lengths of audio that can be queued between frames
+	int historyDepth() const { return mHistory; }
+
+	/// Set number of plot lengths of audio that can be queued between frames
+
+	/// This should not be called from the audio thread.
+	///
+	TimeScope& historyDepth(int v);
+
 	/// Set whether to synchronize waveform to first positive slope zero-crossing
 	TimeScope& sync(bool v);
 
+	void onAnimate(double dsec) override;
 	bool onEvent(Event::t e, GLV& g) override;
 	const char * className() const override { return "TimeScope"; }
 
 protected:
 	std::vector<PlotFunction1D> mGraphs;
-	float * mSamples = nullptr;
+	RingBuffer<float> mQueue;		// interleaved frames from audio thread
+	std::vector<float> mBlock;		// audio thread conversion buffer
+	std::vector<float> mChunk;		// frames read from queue
+	std::vector<float> mPrevFrame;	// last frame read, for sync search
+	std::vector<float> mSamples;	// plot samples, channel-major
+	int mFrames = 0, mChans = 0;	// plot size as seen by audio thread
+	int mHistory = 4;
 	int mFill = 0;
 	int mSync;
-	bool mLocked = false;
+	std::atomic<unsigned> mDropped{0};
+	std::atomic<bool> mProducing{false};
+	std::atomic<bool> mSuspended{false};
+
+	void suspend();
+	void resume();
 };
 
 
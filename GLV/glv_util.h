@@ -4,10 +4,16 @@
 /*	Graphics Library of Views (GLV) - GUI Building Toolkit
 	See COPYRIGHT file for authors and license information */
 
+#include <atomic>
+#include <cstddef>
 #include <cstdlib> // malloc
 #include <cstring> // memset
 #include <cmath>
 #include <list>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace glv {
@@ -41,6 +47,9 @@ public:
 	bool created() const { return 0!=mValue; }
 	void clear(){ delete mValue; mValue=0; }
 
+	/// Replace value with a heap allocated object, e.g., of a derived type
+	void set(T * v){ clear(); mValue=v; }
+
 protected:
 	T& create() const { if(!mValue){ mValue = new T(); } return *mValue; }
 	mutable T * mValue;
@@ -163,9 +172,149 @@ protected:
 };
 
 
+/// Bump allocator for memory needed only for a short time, e.g. one frame
+
+/// Allocations are carved out of large blocks by advancing an offset and
+/// are never freed individually. Instead, all memory is reclaimed at once by
+/// calling reset(). If the allocations since the last reset spilled over into
+/// more than one block, the blocks are replaced by a single block as large as
+/// all of them together so that a following period with similar demand needs
+/// no further memory from the system.
+class FrameArena{
+public:
+
+	/// \param[in] blockSize	minimum size of blocks, in bytes
+	explicit FrameArena(size_t blockSize=65536)
+	:	mBlockSize(blockSize), mOffset(0), mUsed(0), mHighWater(0), mAllocations(0)
+	{}
+
+	~FrameArena(){ freeBlocks(); }
+
+	/// Allocate memory; the alignment must be a power of two
+	void * allocate(size_t bytes, size_t align=alignof(std::max_align_t)){
+		if(mBlocks.empty() || !fits(mBlocks.back(), bytes, align)){
+			size_t size = bytes + align;
+			if(size < mBlockSize) size = mBlockSize;
+			addBlock(size);
+		}
+		Block& b = mBlocks.back();
+		size_t start = aligned(b, align);
+		mUsed += start + bytes - mOffset;
+		mOffset = start + bytes;
+		return b.data + start;
+	}
+
+	/// Reclaim all memory allocated since the last reset
+	void reset(){
+		if(mUsed > mHighWater) mHighWater = mUsed;
+		if(mBlocks.size() > 1){
+			size_t size = capacity();
+			freeBlocks();
+			addBlock(size);
+		}
+		mOffset = mUsed = 0;
+	}
+
+	size_t used() const { return mUsed; }				///< Get bytes allocated since last reset
+	size_t highWater() const { return mUsed > mHighWater ? mUsed : mHighWater; } ///< Get most bytes allocated between resets
+	size_t blockSize() const { return mBlockSize; }		///< Get minimum size of blocks, in bytes
+	int blocks() const { return int(mBlocks.size()); }	///< Get number of blocks held
+
+	/// Get bytes held in blocks
+	size_t capacity() const {
+		size_t r=0;
+		for(unsigned i=0; i<mBlocks.size(); ++i) r += mBlocks[i].size;
+		return r;
+	}
+
+	/// Get number of blocks allocated from the system since construction
+	unsigned allocations() const { return mAllocations; }
+
+private:
+	struct Block{ char * data; size_t size; };
+	std::vector<Block> mBlocks;
+	size_t mBlockSize, mOffset, mUsed, mHighWater;
+	unsigned mAllocations;
+
+	FrameArena(const FrameArena&);
+	FrameArena& operator= (const FrameArena&);
+
+	size_t aligned(const Block& b, size_t align) const {
+		size_t a = size_t(b.data) + mOffset;
+		return mOffset + (((a + align-1) & ~(align-1)) - a);
+	}
+	bool fits(const Block& b, size_t bytes, size_t align) const {
+		return aligned(b, align) + bytes <= b.size;
+	}
+	void addBlock(size_t size){
+		Block b = { static_cast<char *>(::operator new(size)), size };
+		mBlocks.push_back(b);
+		mOffset = 0;
+		++mAllocations;
+	}
+	void freeBlocks(){
+		for(unsigned i=0; i<mBlocks.size(); ++i) ::operator delete(mBlocks[i].data);
+		mBlocks.clear();
+	}
+};
+
+
+/// Allocator drawing from a FrameArena, or from the heap if it has none
+
+/// Elements constructed without arguments are default-initialized rather 
+/// than value-initialized, so growing a container of plain data does not
+/// clear the new memory. Memory from an arena is only reclaimed when the
+/// arena is reset. Containers copied from one using an arena use the heap.
+template <class T>
+class ArenaAllocator{
+public:
+	typedef T value_type;
+	typedef std::true_type propagate_on_container_move_assignment;
+	typedef std::true_type propagate_on_container_swap;
+
+	template <class U> struct rebind{ typedef ArenaAllocator<U> other; };
+
+	/// \param[in] arena	arena to draw memory from or 0 to use the heap
+	ArenaAllocator(FrameArena * arena=0): mArena(arena){}
+
+	template <class U>
+	ArenaAllocator(const ArenaAllocator<U>& v): mArena(v.arena()){}
+
+	/// Get arena memory is drawn from or 0 if the heap
+	FrameArena * arena() const { return mArena; }
+
+	T * allocate(size_t n){
+		return mArena
+			? static_cast<T *>(mArena->allocate(n*sizeof(T), alignof(T)))
+			: std::allocator<T>().allocate(n);
+	}
+
+	void deallocate(T * p, size_t n){
+		if(!mArena) std::allocator<T>().deallocate(p, n);
+	}
+
+	template <class U>
+	void construct(U * p){ ::new(static_cast<void *>(p)) U; }
+
+	template <class U, class... Args>
+	void construct(U * p, Args&&... args){ ::new(static_cast<void *>(p)) U(std::forward<Args>(args)...); }
+
+	ArenaAllocator select_on_container_copy_construction() const { return ArenaAllocator(); }
+
+	template <class U>
+	bool operator==(const ArenaAllocator<U>& v) const { return mArena == v.arena(); }
+
+	template <class U>
+	bool operator!=(const ArenaAllocator<U>& v) const { return mArena != v.arena(); }
+
+private:
+	FrameArena * mArena;
+};
+
+
 /// Array optimized for dynamically changing its size
-template <class T, class Alloc=std::allocator<T> >
-class Buffer : protected Alloc{
+template <class T, class Alloc=ArenaAllocator<T> >
+class Buffer{
 public:
 
 	/// \param[in] capacity		capacity of buffer
@@ -180,7 +329,7 @@ public:
 	const T& operator[](int i) const { return mElems[i]; }
 
 	/// Returns number of elements before needing to allocate more memory
-	int capacity() const { return mElems.capacity(); }
+	int capacity() const { return int(mElems.size()); }
 
 	/// Returns number of elements
 	int size() const { return mSize; }
@@ -200,6 +349,20 @@ public:
 	/// Set size of buffer back to 0
 	void reset(){ setSize(0); }
 
+	/// Empty buffer and free its memory
+	void release(){ mElems = std::vector<T, Alloc>(mElems.get_allocator()); reset(); }
+
+	/// Set arena to draw memory from or 0 to use the heap
+
+	/// The buffer is emptied and its memory freed.
+	Buffer& arena(FrameArena * a){ mElems = std::vector<T, Alloc>(Alloc(a)); reset(); return *this; }
+
+	/// Get arena memory is drawn from or 0 if the heap
+	FrameArena * arena() const { return mElems.get_allocator().arena(); }
+
+	/// Ensure capacity is at least n elements
+	void reserve(int n){ if(n > capacity()) grow(n); }
+
 	/// Resize buffer
 
 	/// This will set both the size and capacity of the buffer to the requested 
@@ -221,20 +384,123 @@ public:
 	/// Appends element to end of buffer growing its size if necessary
 	void append(const T &v, double growFactor=2){
 		if(size() >= capacity()){
-			T vcopy = v; // 'v' may become invalidated after resize
-			mElems.resize(size() ? int(size()*growFactor) : 4);
-			Alloc::construct(&mElems[0] + size(), vcopy);
+			T vcopy = v; // 'v' may become invalidated after growing
+			grow(size() ? int(size()*growFactor) : 4);
+			mElems[size()] = vcopy;
 		}
 		else{
-			Alloc::construct(&mElems[0] + size(), v);
+			mElems[size()] = v;
 		}
 		++mSize;
 	}
 
+	/// Appends n elements to end of buffer growing its size if necessary
+	void append(const T * src, int n){
+		int newSize = size() + n;
+		if(newSize > capacity()){
+			grow(newSize > size()*2 ? newSize : size()*2);
+		}
+		for(int i=0; i<n; ++i) mElems[size()+i] = src[i];
+		setSize(newSize);
+	}
+
 private:
 	int mSize;
 	std::vector<T, Alloc> mElems;
 	void setSize(int n){ mSize=n; }
+
+	// Grow capacity to n elements. Only the used elements are copied and the
+	// vector is reserved exactly n elements so that it does not overallocate.
+	void grow(int n){
+		if(mElems.capacity() < size_t(n)){
+			mElems.resize(size());
+			mElems.reserve(n);
+		}
+		mElems.resize(n);
+	}
+};
+
+
+/// Wait-free single-producer, single-consumer ring buffer
+
+/// One thread may write while another thread reads without any locking. 
+/// Neither side ever blocks; a write that does not fit is truncated and a 
+/// read returns only what is available. The read and write positions are 
+/// padded onto separate cache lines so the two threads do not contend over
+/// them.
+/// Resizing and clearing are not thread-safe.
+template <class T>
+class RingBuffer{
+public:
+
+	/// \param[in] capacity		minimum capacity, rounded up to a power of two
+	explicit RingBuffer(int capacity=0): mWrite(0), mRead(0){ resize(capacity); }
+
+	/// Get maximum number of elements that can be stored
+	int capacity() const { return mElems.size(); }
+
+	/// Get number of elements available to read (consumer)
+	int readable() const {
+		return mWrite.load(std::memory_order_acquire) - mRead.load(std::memory_order_relaxed);
+	}
+
+	/// Get number of elements that can be written (producer)
+	int writable() const {
+		return capacity() - int(mWrite.load(std::memory_order_relaxed) - mRead.load(std::memory_order_acquire));
+	}
+
+	/// Write elements (producer)
+
+	/// \returns number of elements written
+	int write(const T * src, int n){
+		unsigned w = mWrite.load(std::memory_order_relaxed);
+		n = min(n, writable());
+		for(int i=0; i<n; ++i) mElems[(w+i) & mMask] = src[i];
+		mWrite.store(w+n, std::memory_order_release);
+		return n;
+	}
+
+	/// Read elements (consumer)
+
+	/// \returns number of elements read
+	int read(T * dst, int n){
+		unsigned r = mRead.load(std::memory_order_relaxed);
+		n = min(n, readable());
+		for(int i=0; i<n; ++i) dst[i] = mElems[(r+i) & mMask];
+		mRead.store(r+n, std::memory_order_release);
+		return n;
+	}
+
+	/// Discard elements without reading them (consumer)
+
+	/// \returns number of elements discarded
+	int skip(int n){
+		n = min(n, readable());
+		mRead.store(mRead.load(std::memory_order_relaxed) + n, std::memory_order_release);
+		return n;
+	}
+
+	/// Discard all elements
+	void clear(){ mWrite.store(0); mRead.store(0); }
+
+	/// Set capacity, rounded up to a power of two. This also clears the buffer.
+	void resize(int n){
+		int c = n>0 ? 1:0;
+		while(c < n) c <<= 1;
+		mElems.assign(c, T());
+		mMask = c ? c-1 : 0;
+		clear();
+	}
+
+private:
+	std::vector<T> mElems;
+	unsigned mMask;
+	// padded so that positions never share a cache line
+	char mPad1[64];
+	std::atomic<unsigned> mWrite;
+	char mPad2[64 - sizeof(std::atomic<unsigned>)];
+	std::atomic<unsigned> mRead;
+	char mPad3[64 - sizeof(std::atomic<unsigned>)];
 };
 
 
@@ -152,6 +152,7 @@ public:
 			Data t=d; t.clone();
 			if(onAssignData(t, ind1, ind2)){
 				//model().assign(t, ind1, ind2);
+				damage();
 			}
 		}
 	}
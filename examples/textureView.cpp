@@ -25,6 +25,8 @@ public:
 			pixs[k*3+2] = 0;
 		}}
 		mTex.magFilter(GL_NEAREST);
+		listen(Event::WindowCreate, true);
+		listen(Event::WindowDestroy, true);
 	}
 
 
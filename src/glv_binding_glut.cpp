@@ -169,21 +169,14 @@ static void glutDisplayCB(){
 
 // this must be called whenever a GLUT input event for a keyboard or mouse
 // callback is generated.
-static void modToGLV(){
-	GLV * g = Window::Impl::getGLV();
-	if(g){
-		int mod = glutGetModifiers();
-		
-		g->setKeyModifiers(
-			mod & GLUT_ACTIVE_SHIFT,
-			mod & GLUT_ACTIVE_ALT,
-			mod & GLUT_ACTIVE_CTRL,
-			false,	/* no caps key state available */
-			false	/* no meta key state available */
-		);
-		
-		//printf("a:%d c:%d s:%d\n", g->keyboard.alt(), g->keyboard.ctrl(), g->keyboard.shift());
-	}
+static void modToGLV(InputEvent& e){
+	int mod = glutGetModifiers();
+	e.modifiers[0] = mod & GLUT_ACTIVE_SHIFT;
+	e.modifiers[1] = mod & GLUT_ACTIVE_ALT;
+	e.modifiers[2] = mod & GLUT_ACTIVE_CTRL;
+	e.modifiers[3] = false;	/* no caps key state available */
+	e.modifiers[4] = false;	/* no meta key state available */
+	e.hasModifiers = true;
 }
 
 
@@ -275,9 +268,10 @@ static void keyToGLV(unsigned int key, bool down, bool special){
 		}
 		
 		if(INVALID_KEY != key){
-			down ? g->setKeyDown(key) : g->setKeyUp(key);
-			modToGLV();
-			g->propagateEvent();
+			InputEvent e(down ? Event::KeyDown : Event::KeyUp);
+			e.key = key;
+			modToGLV(e);
+			g->postInput(e);
 		}
 	}
 }
@@ -308,11 +302,6 @@ static void glutMouseCB(int btn, int state, int ax, int ay){
 	//printf("GLUT: mouse event x:%d y:%d bt:#%d,%d\n", ax,ay, btn, state==GLUT_DOWN);
 	GLV * g = Window::Impl::getGLV();
 	if(g){
-		space_t x = (space_t)ax;
-		space_t y = (space_t)ay;
-		space_t relx = x;
-		space_t rely = y;
-
 		switch(btn){
 			case GLUT_LEFT_BUTTON:		btn = Mouse::Left; break;
 			case GLUT_MIDDLE_BUTTON:	btn = Mouse::Middle; break;
@@ -320,27 +309,21 @@ static void glutMouseCB(int btn, int state, int ax, int ay){
 			default:					btn = Mouse::Extra;		// unrecognized button
 		}
 
-		if(GLUT_DOWN == state)		g->setMouseDown(relx, rely, btn, 0);
-		else if(GLUT_UP == state)	g->setMouseUp  (relx, rely, btn, 0);
-
-		g->setMousePos((int)x, (int)y, relx, rely);
-		modToGLV();
-		g->propagateEvent();
+		InputEvent e(GLUT_DOWN == state ? Event::MouseDown : Event::MouseUp);
+		e.x = ax; e.y = ay;
+		e.button = btn;
+		modToGLV(e);
+		g->postInput(e);
 	}
 }
 
 static void motionToGLV(int ax, int ay, glv::Event::t e){
 	GLV * g = Window::Impl::getGLV();
 	if(g){
-		space_t x = (space_t)ax;
-		space_t y = (space_t)ay;
-		space_t relx = x;
-		space_t rely = y;
-
-		g->setMouseMotion(relx, rely, e);
-		g->setMousePos((int)x, (int)y, relx, rely);
-		//modToGLV();	// GLUT complains about calling glutGetModifiers()
-		g->propagateEvent();
+		InputEvent ie(e);
+		ie.x = ax; ie.y = ay;
+		//modToGLV(ie);	// GLUT complains about calling glutGetModifiers()
+		g->postInput(ie);
 	}
 }
 
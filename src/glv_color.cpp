@@ -59,4 +59,20 @@ void Color::print(const char * append) const{
  	fprintf(stdout, "[%.2f, %.2f, %.2f, %.2f]%s", r, g, b, a, append);
 }
 
+// These loop over components so that compilers can vectorize them.
+void toColor8(Color8 * dst, const Color * src, int n){
+	const float * s = reinterpret_cast<const float *>(src);
+	unsigned char * d = reinterpret_cast<unsigned char *>(dst);
+	for(int i=0; i<n*4; ++i){
+		float v = s[i]*255.f + 0.5f;
+		d[i] = (unsigned char)(v > 0.f ? (v < 255.f ? v : 255.f) : 0.f);
+	}
+}
+
+void toColor(Color * dst, const Color8 * src, int n){
+	const unsigned char * s = reinterpret_cast<const unsigned char *>(src);
+	float * d = reinterpret_cast<float *>(dst);
+	for(int i=0; i<n*4; ++i) d[i] = s[i] * (1.f/255.f);
+}
+
 } // end namespace glv
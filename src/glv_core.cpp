@@ -25,7 +25,7 @@ namespace Event{
 
 
 Style::Style(bool deletable)
-:	SmartPointer(deletable)
+:	SmartPointer(deletable), atlasFont(false)
 {}
 
 
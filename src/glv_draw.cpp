@@ -1,11 +1,140 @@
 /*	Graphics Library of Views (GLV) - GUI Building Toolkit
 	See COPYRIGHT file for authors and license information */
 
+#include <algorithm>
 #include <cmath>
+#include <cstddef>
+#include <string.h>
+#include <vector>
 #include "glv_draw.h"
 #include "glv_font.h"
 
 namespace glv{
+
+// Copy of graphics data kept for drawing across paints
+struct GraphicsData::Cache{
+	enum{ None, GPU, Memory };
+
+	unsigned long long key = 0;	// stamp or content hash of copy
+	bool stamped = false;
+	int where = None;			// location of copy
+	draw::ContextObjects buffers{draw::ContextObjects::Buffers, 2};	// GPU vertex attributes and indices
+	size_t colorsAt = 0;		// byte offsets of arrays in attribute buffer
+	size_t texCoordsAt = 0;
+	GraphicsData copy;			// copy for software backends
+
+	// Get whether copy at location is out of date and mark it as up to date
+	bool stale(const GraphicsData& b, int at){
+		if(GPU == at && !buffers.claim()) where = None;	// no buffers in this context
+		unsigned long long k = b.stamp() ? b.stamp() : hash(b);
+		bool res = at != where || k != key || stamped != (b.stamp() != 0);
+		key = k; stamped = b.stamp() != 0; where = at;
+		return res;
+	}
+
+	// Hash in four independent lanes so multiplies overlap
+	static unsigned long long hash(unsigned long long h, const void * data, size_t n){
+		const unsigned long long P = 1099511628211ULL;
+		const unsigned char * p = static_cast<const unsigned char *>(data);
+		unsigned long long l[4] = {h, h+1, h+2, h+3};
+		for(; n>=32; n-=32, p+=32){
+			unsigned long long w[4]; memcpy(w, p, 32);
+			for(int i=0; i<4; ++i){ l[i] = (l[i] ^ w[i]) * P; l[i] ^= l[i] >> 29; }
+		}
+		h = ((((l[0] * P) ^ l[1]) * P ^ l[2]) * P ^ l[3]) * P;
+		for(; n; --n, ++p) h = (h ^ *p) * P;
+		return h;
+	}
+
+	template <class T>
+	static unsigned long long hash(unsigned long long h, const Buffer<T>& v){
+		h = (h ^ (unsigned long long)(v.size())) * 1099511628211ULL;
+		return v.size() ? hash(h, &v[0], v.size()*sizeof(T)) : h;
+	}
+
+	static unsigned long long hash(const GraphicsData& b){
+		unsigned long long h = 14695981039346656037ULL;
+		h = hash(h, b.vertices2());
+		h = hash(h, b.vertices3());
+		h = hash(h, b.colors());
+		h = hash(h, b.indices());
+		h = hash(h, b.texCoords2());
+		h = hash(h, b.colors8());
+		h = hash(h, b.colorVertices2());
+		return h;
+	}
+};
+
+template <class T>
+static void copyBuffer(Buffer<T>& dst, const Buffer<T>& src){
+	dst.reset();
+	if(src.size()) dst.append(&src[0], src.size());
+}
+
+GraphicsData::GraphicsData(): mColors(1), mStamp(0){}
+
+GraphicsData::GraphicsData(const GraphicsData& v)
+:	mVertices2(v.mVertices2), mVertices3(v.mVertices3), mColors(v.mColors),
+	mIndices(v.mIndices), mTexCoords2(v.mTexCoords2),
+	mColors8(v.mColors8), mColorVertices2(v.mColorVertices2), mStamp(v.mStamp)
+{
+	cache(v.cache());
+}
+
+GraphicsData::GraphicsData(GraphicsData&& v) = default;
+
+GraphicsData::~GraphicsData(){}
+
+GraphicsData& GraphicsData::operator= (const GraphicsData& v){
+	if(this != &v){
+		mVertices2 = v.mVertices2;
+		mVertices3 = v.mVertices3;
+		mColors = v.mColors;
+		mIndices = v.mIndices;
+		mTexCoords2 = v.mTexCoords2;
+		mColors8 = v.mColors8;
+		mColorVertices2 = v.mColorVertices2;
+		mStamp = v.mStamp;
+		cache(v.cache());
+		if(mCache) mCache->where = Cache::None;
+	}
+	return *this;
+}
+
+GraphicsData& GraphicsData::operator= (GraphicsData&& v) = default;
+
+GraphicsData& GraphicsData::arena(FrameArena * a){
+	mVertices2.arena(a); mVertices3.arena(a);
+	mColors.arena(a); mIndices.arena(a); mTexCoords2.arena(a);
+	mColors8.arena(a); mColorVertices2.arena(a);
+	return *this;
+}
+
+void GraphicsData::release(){
+	mVertices2.release(); mVertices3.release();
+	mColors.release(); mIndices.release(); mTexCoords2.release();
+	mColors8.release(); mColorVertices2.release();
+}
+
+void GraphicsData::capacities(int * c) const {
+	c[0] = mVertices2.capacity(); c[1] = mVertices3.capacity();
+	c[2] = mColors.capacity(); c[3] = mIndices.capacity(); c[4] = mTexCoords2.capacity();
+	c[5] = mColors8.capacity(); c[6] = mColorVertices2.capacity();
+}
+
+void GraphicsData::reserve(const int * c){
+	mVertices2.reserve(c[0]); mVertices3.reserve(c[1]);
+	mColors.reserve(c[2]); mIndices.reserve(c[3]); mTexCoords2.reserve(c[4]);
+	mColors8.reserve(c[5]); mColorVertices2.reserve(c[6]);
+}
+
+GraphicsData& GraphicsData::cache(bool v){
+	if(!v) mCache.reset();
+	else if(!mCache) mCache.reset(new Cache);
+	return *this;
+}
+
+
 namespace draw{
 
 int printError(const char * pre, bool verbose, FILE * out){
@@ -26,7 +155,81 @@ int printError(const char * pre, bool verbose, FILE * out){
 }
 
 
+// GL objects released in a context, to be deleted when it is next current
+struct ContextState{
+	unsigned revision = 0;	// incremented when context is lost
+	std::vector<GLuint> released[2];
+};
+
+static std::vector<ContextState>& contexts(){
+	static auto& v = *new std::vector<ContextState>;
+	return v;
+}
+
+static int currentContext = -1;
+
+int newContext(){
+	contexts().emplace_back();
+	return contexts().size() - 1;
+}
+
+void context(int id){
+	currentContext = id;
+	if(id < 0) return;
+	std::vector<GLuint> * r = contexts()[id].released;
+	if(!r[0].empty()) glDeleteBuffers(r[0].size(), &r[0][0]);
+	if(!r[1].empty()) glDeleteTextures(r[1].size(), &r[1][0]);
+	r[0].clear();
+	r[1].clear();
+}
+
+int context(){ return currentContext; }
+
+void contextLost(int id){
+	ContextState& s = contexts()[id];
+	++s.revision;
+	s.released[0].clear();
+	s.released[1].clear();
+}
+
+int releasedObjects(int id){
+	const ContextState& s = contexts()[id];
+	return s.released[0].size() + s.released[1].size();
+}
+
+ContextObjects::ContextObjects(Kind kind, int num)
+:	mKind(kind), mNum(num), mContext(currentContext), mRevision(0)
+{
+	mNames[0] = mNames[1] = 0;
+	if(mContext >= 0) mRevision = contexts()[mContext].revision;
+}
+
+bool ContextObjects::claim(){
+	if(mContext == currentContext && (mContext < 0 || mRevision == contexts()[mContext].revision)){
+		return mNames[0] != 0;
+	}
+	release();
+	mContext = currentContext;
+	mRevision = mContext >= 0 ? contexts()[mContext].revision : 0;
+	return false;
+}
+
+void ContextObjects::release(){
+	if(!mNames[0]) return;
+	if(mContext < 0){ // outside of any tracked context, assume it is current
+		if(Buffers == mKind) glDeleteBuffers(mNum, mNames);
+		else glDeleteTextures(mNum, mNames);
+	}
+	else if(mRevision == contexts()[mContext].revision){
+		std::vector<GLuint>& r = contexts()[mContext].released[mKind];
+		r.insert(r.end(), mNames, mNames + mNum);
+	}
+	mNames[0] = mNames[1] = 0;
+}
+
+
 void fog(float end, float start, const Color& c){
+	if(Backend::current()) return;
 	glFogf(GL_FOG_MODE, GL_LINEAR);  // ky was glFogi??
 	glFogf(GL_FOG_START, start); glFogf(GL_FOG_END, end);
 	float fogColor[4] = {c.r, c.g, c.b, c.a};
@@ -123,25 +326,595 @@ void grid(GraphicsData& g, float l, float t, float w, float h, float divx, float
 //}
 
 
-void paint(int prim, const GraphicsData& b){
-	int Nc = b.colors().size();
-	int Nv2= b.vertices2().size();
-	int Nv3= b.vertices3().size();
+Backend::Backend()
+:	mColor(1), mClearColor(0,0,0,1), mMatrixMode(ModelView),
+	mBlendEq(GL_FUNC_ADD), mBlendSrc(GL_ONE), mBlendDst(GL_ZERO),
+	mLineWidth(1), mPointSize(1)
+{
+	for(int i=0; i<4; ++i) mScissor[i] = mViewport[i] = 0;
+	for(int i=0; i<2; ++i){ mStacks[i].resize(1); }
+	identity();
+	matrixMode(Projection); identity();
+	matrixMode(ModelView);
+}
+
+void Backend::enable(int cap, bool v){
+	std::vector<int>::iterator it = std::find(mCaps.begin(), mCaps.end(), cap);
+	if(v && it == mCaps.end()) mCaps.push_back(cap);
+	else if(!v && it != mCaps.end()) mCaps.erase(it);
+}
+
+bool Backend::enabled(int cap) const {
+	return std::find(mCaps.begin(), mCaps.end(), cap) != mCaps.end();
+}
+
+void Backend::scissor(int x, int y, int w, int h){
+	mScissor[0]=x; mScissor[1]=y; mScissor[2]=w; mScissor[3]=h;
+}
+
+void Backend::viewport(int x, int y, int w, int h){
+	mViewport[0]=x; mViewport[1]=y; mViewport[2]=w; mViewport[3]=h;
+}
+
+void Backend::identity(){
+	float * m = top().m;
+	for(int i=0; i<16; ++i) m[i] = (i%5) ? 0.f : 1.f;
+}
+
+void Backend::matrixMode(int mode){ mMatrixMode = mode; }
+
+void Backend::multMatrix(const float * b){
+	float * a = top().m;
+	float r[16];
+	for(int c=0; c<4; ++c){
+	for(int i=0; i<4; ++i){
+		r[c*4+i] = a[i]*b[c*4] + a[4+i]*b[c*4+1] + a[8+i]*b[c*4+2] + a[12+i]*b[c*4+3];
+	}}
+	for(int i=0; i<16; ++i) a[i] = r[i];
+}
+
+void Backend::pop(){
+	std::vector<Mat4>& st = mStacks[ModelView == mMatrixMode ? 0:1];
+	if(st.size() > 1) st.pop_back();
+}
+
+void Backend::push(){
+	std::vector<Mat4>& st = mStacks[ModelView == mMatrixMode ? 0:1];
+	st.push_back(st.back());
+}
+
+void Backend::rotate(float deg, float x, float y, float z){
+	float l = std::sqrt(x*x + y*y + z*z);
+	if(l == 0.f) return;
+	x/=l; y/=l; z/=l;
+	float a = deg * float(C_PI/180.);
+	float c = std::cos(a), s = std::sin(a), C = 1-c;
+	float m[] = {
+		x*x*C+c,	y*x*C+z*s,	x*z*C-y*s,	0,
+		x*y*C-z*s,	y*y*C+c,	y*z*C+x*s,	0,
+		x*z*C+y*s,	y*z*C-x*s,	z*z*C+c,	0,
+		0,			0,			0,			1
+	};
+	multMatrix(m);
+}
+
+void Backend::scale(float x, float y, float z){
+	float m[] = { x,0,0,0, 0,y,0,0, 0,0,z,0, 0,0,0,1 };
+	multMatrix(m);
+}
+
+void Backend::translate(float x, float y, float z){
+	float m[] = { 1,0,0,0, 0,1,0,0, 0,0,1,0, x,y,z,1 };
+	multMatrix(m);
+}
+
+void Backend::toWindow(const float * v, int dim, float& x, float& y) const {
+	const float * mv = top(0).m;
+	const float * pj = top(1).m;
+	float vz = dim > 2 ? v[2] : 0.f;
+	float e[4], c[4];
+	for(int i=0; i<4; ++i) e[i] = mv[i]*v[0] + mv[4+i]*v[1] + mv[8+i]*vz + mv[12+i];
+	for(int i=0; i<4; ++i) c[i] = pj[i]*e[0] + pj[4+i]*e[1] + pj[8+i]*e[2] + pj[12+i]*e[3];
+	if(c[3] != 0.f){ c[0]/=c[3]; c[1]/=c[3]; }
+	x = mViewport[0] + (c[0] + 1.f)*0.5f*mViewport[2];
+	y = mViewport[1] + (c[1] + 1.f)*0.5f*mViewport[3];
+}
+
+
+int independent(int prim, const index_t * indices, int num, std::vector<index_t>& out){
+	out.clear();
+	#define IDX(i) (indices ? indices[i] : index_t(i))
+	switch(prim){
+	case Points:
+		for(int i=0; i<num; ++i) out.push_back(IDX(i));
+		return Points;
+	case Lines:
+		for(int i=0; i<num-1; i+=2){ out.push_back(IDX(i)); out.push_back(IDX(i+1)); }
+		return Lines;
+	case LineStrip:
+	case LineLoop:
+		for(int i=0; i<num-1; ++i){ out.push_back(IDX(i)); out.push_back(IDX(i+1)); }
+		if(LineLoop == prim && num > 2){ out.push_back(IDX(num-1)); out.push_back(IDX(0)); }
+		return Lines;
+	case Triangles:
+		for(int i=0; i<num-2; i+=3){ out.push_back(IDX(i)); out.push_back(IDX(i+1)); out.push_back(IDX(i+2)); }
+		return Triangles;
+	case TriangleStrip:
+		for(int i=0; i<num-2; ++i){
+			int o = i&1; // keep winding consistent
+			out.push_back(IDX(i+o)); out.push_back(IDX(i+1-o)); out.push_back(IDX(i+2));
+		}
+		return Triangles;
+	case TriangleFan:
+		for(int i=1; i<num-1; ++i){ out.push_back(IDX(0)); out.push_back(IDX(i)); out.push_back(IDX(i+1)); }
+		return Triangles;
+	default: return -1;
+	}
+	#undef IDX
+}
+
+
+// Vertex and color arrays of graphics data as given to OpenGL
+struct Arrays{
+	const GLvoid * verts;	// vertex positions
+	const GLvoid * cols;	// colors or 0 if none
+	int num;				// number of vertices
+	int dim;				// components per vertex position
+	GLsizei stride;			// stride of interleaved vertices and colors or 0
+	GLenum colType;			// GL_FLOAT or GL_UNSIGNED_BYTE
+	size_t vertBytes;		// size of vertex array, including interleaved colors
+	size_t colBytes;		// size of separate color array
+
+	Arrays(const GraphicsData& b)
+	:	verts(0), cols(0), num(0), dim(2), stride(0), colType(GL_FLOAT), vertBytes(0), colBytes(0)
+	{
+		int Nv2= b.vertices2().size();
+		int Nv3= b.vertices3().size();
+		int Nvc= b.colorVertices2().size();
+		int Nc = b.colors().size();
+		int Nc8= b.colors8().size();
+
+		if(Nv3){
+			verts = &b.vertices3()[0]; num = Nv3; dim = 3;
+			vertBytes = Nv3*sizeof(Point3);
+		}
+		else if(Nv2){
+			verts = &b.vertices2()[0]; num = Nv2;
+			vertBytes = Nv2*sizeof(Point2);
+		}
+		else if(Nvc){
+			verts = &b.colorVertices2()[0]; num = Nvc; stride = sizeof(ColorPoint2);
+			vertBytes = Nvc*sizeof(ColorPoint2);
+			cols = &b.colorVertices2()[0].color; colType = GL_UNSIGNED_BYTE;
+			return;
+		}
+
+		if(Nc && (Nc >= Nv2 || Nc >= Nv3)){
+			cols = &b.colors()[0]; colBytes = Nc*sizeof(Color);
+		}
+		else if(Nc8 && (Nc8 >= Nv2 || Nc8 >= Nv3)){
+			cols = &b.colors8()[0]; colType = GL_UNSIGNED_BYTE; colBytes = Nc8*sizeof(Color8);
+		}
+	}
+
+	bool packed() const { return stride || GL_UNSIGNED_BYTE == colType; }
+
+	// Get float vertices and colors, converting packed arrays into scratch space
+	void unpack(const float *& vs, const Color *& cs) const {
+		static std::vector<Point2> scratchVerts;
+		static std::vector<Color> scratchCols;
+		vs = static_cast<const float *>(verts);
+		cs = static_cast<const Color *>(cols);
+		if(stride){
+			auto * cv = static_cast<const ColorPoint2 *>(verts);
+			scratchVerts.resize(num);
+			scratchCols.resize(num);
+			for(int i=0; i<num; ++i){
+				scratchVerts[i] = Point2(cv[i].x, cv[i].y);
+				scratchCols[i] = cv[i].color.toColor();
+			}
+			vs = scratchVerts[0].elems;
+			cs = &scratchCols[0];
+		}
+		else if(cols && GL_UNSIGNED_BYTE == colType){
+			int n = colBytes/sizeof(Color8);
+			scratchCols.resize(n);
+			toColor(&scratchCols[0], static_cast<const Color8 *>(cols), n);
+			cs = &scratchCols[0];
+		}
+	}
+};
+
+// Send graphics data to GPU buffers of its cache
+static void refreshGL(GraphicsData::Cache& c, const GraphicsData& b, const Arrays& a){
+	int Nv2= a.dim == 2 ? a.num : 0;
 	int Ni = b.indices().size();
+	bool Et = Nv2 && b.texCoords2().size() >= Nv2;
+
+	size_t tbytes = Et ? Nv2*sizeof(Point2) : 0;
+	c.colorsAt = a.vertBytes;
+	c.texCoordsAt = a.vertBytes + a.colBytes;
+
+	if(!c.buffers.name()) glGenBuffers(2, c.buffers.names());
+	glBindBuffer(GL_ARRAY_BUFFER, c.buffers.name(0));
+	glBufferData(GL_ARRAY_BUFFER, a.vertBytes + a.colBytes + tbytes, 0, GL_STATIC_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, a.vertBytes, a.verts);
+	if(a.colBytes) glBufferSubData(GL_ARRAY_BUFFER, c.colorsAt, a.colBytes, a.cols);
+	if(tbytes) glBufferSubData(GL_ARRAY_BUFFER, c.texCoordsAt, tbytes, &b.texCoords2()[0]);
+	if(Ni){
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, c.buffers.name(1));
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, Ni*sizeof(index_t), &b.indices()[0], GL_STATIC_DRAW);
+	}
 
-	bool Ec = Nc && (Nc >= Nv2 || Nc >= Nv3);
+	stats().bytes += a.vertBytes + a.colBytes + tbytes + Ni*sizeof(index_t);
+}
+
+static void paintGL(int prim, const GraphicsData& b, bool Et, unsigned texture){
+	Arrays a(b);
+	int Ni = b.indices().size();
+	bool Ec = a.cols;
+	stats().painted += Ni ? Ni : a.num;
+
+	if(3 == a.dim) flushBatch();
+	else if(a.num && Batch::current()){
+		const float * vs; const Color * cs;
+		a.unpack(vs, cs);
+		if(batched(
+			prim, reinterpret_cast<const Point2 *>(vs), cs,
+			Ni ? &b.indices()[0] : 0, Ni ? Ni : a.num,
+			Et ? &b.texCoords2()[0] : 0, texture
+		)) return;
+	}
+
+	// Cached arrays are given as offsets into the bound buffer objects
+	GraphicsData::Cache * c = b.cached();
+	if(c){
+		if(c->stale(b, GraphicsData::Cache::GPU)) refreshGL(*c, b, a);
+		glBindBuffer(GL_ARRAY_BUFFER, c->buffers.name(0));
+		if(Ni) glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, c->buffers.name(1));
+	}
+	else{
+		stats().bytes += a.vertBytes + a.colBytes + (Et ? a.num*sizeof(Point2) : 0) + Ni*sizeof(index_t);
+	}
+	auto array = [c](const void * p, size_t offset){
+		return c ? (const GLvoid *)offset : (const GLvoid *)p;
+	};
 
 	if(Ec){
+		size_t at = a.stride ? offsetof(ColorPoint2, color) : (c ? c->colorsAt : 0);
 		glEnableClientState(GL_COLOR_ARRAY);
-		glColorPointer(4, GL_FLOAT, 0, &b.colors()[0]);
+		glColorPointer(4, a.colType, a.stride, array(a.cols, at));
 	}
-	if(Nv3)	glVertexPointer(3, GL_FLOAT, 0, &b.vertices3()[0]);
-	else	glVertexPointer(2, GL_FLOAT, 0, &b.vertices2()[0]);
+	if(Et){
+		glEnable(GL_TEXTURE_2D);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+		glTexCoordPointer(2, GL_FLOAT, 0, array(&b.texCoords2()[0], c ? c->texCoordsAt : 0));
+	}
+	glVertexPointer(a.dim, GL_FLOAT, a.stride, array(a.verts, 0));
 	
-	if(Ni)	glDrawElements(prim, b.indices().size(), GLV_INDEX, &b.indices()[0]);
-	else	glDrawArrays(prim, 0, Nv3 ? Nv3 : Nv2);
+	if(Ni)	glDrawElements(prim, Ni, GLV_INDEX, array(&b.indices()[0], 0));
+	else	glDrawArrays(prim, 0, a.num);
 
 	if(Ec)	glDisableClientState(GL_COLOR_ARRAY);
+	if(Et){
+		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glDisable(GL_TEXTURE_2D);
+	}
+	if(c){
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		if(Ni) glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+
+	++stats().calls; stats().vertices += Ni ? Ni : a.num;
+}
+
+void paint(int prim, const GraphicsData& gd){
+	if(Backend * be = Backend::current()){
+
+		// software backends draw from a copy in memory
+		const GraphicsData * pb = &gd;
+		if(GraphicsData::Cache * c = gd.cached()){
+			auto& cp = c->copy;
+			if(c->stale(gd, GraphicsData::Cache::Memory)){
+				copyBuffer(cp.vertices2(), gd.vertices2());
+				copyBuffer(cp.vertices3(), gd.vertices3());
+				copyBuffer(cp.colors(), gd.colors());
+				copyBuffer(cp.indices(), gd.indices());
+				copyBuffer(cp.texCoords2(), gd.texCoords2());
+				copyBuffer(cp.colors8(), gd.colors8());
+				copyBuffer(cp.colorVertices2(), gd.colorVertices2());
+				Arrays a(cp);
+				stats().bytes += a.vertBytes + a.colBytes
+					+ cp.texCoords2().size()*sizeof(Point2) + cp.indices().size()*sizeof(index_t);
+			}
+			pb = &cp;
+		}
+		const GraphicsData& b = *pb;
+
+		Arrays a(b);
+		int Ni = b.indices().size();
+		if(!a.num) return;
+		stats().painted += Ni ? Ni : a.num;
+		const float * vs; const Color * cs;
+		a.unpack(vs, cs);
+		be->paint(prim, vs, a.dim, cs, Ni ? &b.indices()[0] : 0, Ni ? Ni : a.num);
+		return;
+	}
+	paintGL(prim, gd, false, 0);
+}
+
+void paint(int prim, const GraphicsData& b, unsigned texture){
+	if(Backend::current()) return;
+	Arrays a(b);
+	bool Et = a.num && 2 == a.dim && b.texCoords2().size() >= a.num;
+	paintGL(prim, b, Et, texture);
+}
+
+
+Batch::Batch()
+:	mNumBuckets(0), mSearchDepth(16)
+{
+	for(int i=0; i<16; ++i) mProj[i]=0;
+	for(int i=0; i<4; ++i) mViewport[i]=0;
+}
+
+bool Batch::Key::operator==(const Key& k) const {
+	return prim==k.prim && size==k.size && blend==k.blend
+		&& blendSrc==k.blendSrc && blendDst==k.blendDst && blendEq==k.blendEq
+		&& smooth==k.smooth && scissor==k.scissor && texture==k.texture
+		&& (!scissor || (box[0]==k.box[0] && box[1]==k.box[1] && box[2]==k.box[2] && box[3]==k.box[3]));
+}
+
+void Batch::State::capture(){
+	GLint mode;
+	glGetIntegerv(GL_MATRIX_MODE, &mode);
+	mMatrixMode = mode;
+	for(int i=0; i<2; ++i) mStacks[i].resize(1);
+	glGetFloatv(GL_MODELVIEW_MATRIX, mStacks[0][0].m);
+	glGetFloatv(GL_PROJECTION_MATRIX, mStacks[1][0].m);
+	glGetFloatv(GL_CURRENT_COLOR, mColor.components);
+	glGetFloatv(GL_LINE_WIDTH, &mLineWidth);
+	glGetFloatv(GL_POINT_SIZE, &mPointSize);
+	glGetIntegerv(GL_BLEND_SRC, &mBlendSrc);
+	glGetIntegerv(GL_BLEND_DST, &mBlendDst);
+	#ifdef GLV_OPENGL_ES1
+	mBlendEq = 0;
+	#else
+	glGetIntegerv(GL_BLEND_EQUATION, &mBlendEq);
+	#endif
+	glGetIntegerv(GL_SCISSOR_BOX, mScissor);
+	glGetIntegerv(GL_VIEWPORT, mViewport);
+
+	// capabilities batched paints depend on
+	static const int caps[] = {
+		Blend, DepthTest, LineSmooth, PointSmooth, ScissorTest, Texture2D,
+		#ifndef GLV_OPENGL_ES1
+		GL_LINE_STIPPLE
+		#endif
+	};
+	mCaps.clear();
+	for(int cap : caps) if(glIsEnabled(cap)) mCaps.push_back(cap);
+}
+
+void Batch::begin(){
+	mState.capture();
+	begin(mState);
+}
+
+void Batch::begin(const Backend& state){
+	if(&state != &mState) static_cast<Backend&>(mState) = state;
+	mNumBuckets = 0;
+	for(int i=0; i<16; ++i) mProj[i] = mState.projection()[i];
+	for(int i=0; i<4; ++i) mViewport[i] = mState.viewport()[i];
+	current() = this;
+}
+
+void Batch::end(){
+	flush();
+	if(current() == this) current() = 0;
+}
+
+bool Batch::add(int prim, const Point2 * verts, const Color * cols, const index_t * indices, int num,
+	const Point2 * texcs, unsigned texture
+){
+
+	const State& s = mState;
+
+	// states which cannot be captured
+	if((!texcs && s.enabled(Texture2D)) || s.enabled(DepthTest)) return false;
+	#ifndef GLV_OPENGL_ES1
+	if(s.enabled(GL_LINE_STIPPLE)) return false;
+	#endif
+
+	// vertices are transformed on the CPU, so the transform must be planar
+	const float * pj = s.projection(), * mv = s.modelView();
+	for(int i=0; i<16; ++i) if(pj[i] != mProj[i]) return false;
+	for(int i=0; i<4; ++i) if(s.viewport()[i] != mViewport[i]) return false;
+	if(mv[2]!=0.f || mv[3]!=0.f || mv[6]!=0.f || mv[7]!=0.f || mv[15]!=1.f) return false;
+
+	// capture remaining state
+	Key k;
+	k.prim = prim;
+	switch(prim){
+	case Points:	k.size = s.pointSize(); k.smooth = s.enabled(PointSmooth); break;
+	case Lines:
+	case LineStrip:
+	case LineLoop:	k.size = s.lineWidth(); k.smooth = s.enabled(LineSmooth); break;
+	default:		k.smooth = 0;
+	}
+	k.blend = s.enabled(Blend);
+	k.blendSrc = s.blendSrc();
+	k.blendDst = s.blendDst();
+	k.blendEq = s.blendEquation();
+	k.scissor = s.enabled(ScissorTest);
+	for(int i=0; i<4; ++i) k.box[i] = s.scissor()[i];
+	k.texture = texture;
+
+	return add(k, mv, s.color(), verts, cols, indices, num, texcs);
+}
+
+bool Batch::add(const Key& state, const float * mv, const Color& color,
+	const Point2 * verts, const Color * cols, const index_t * indices, int num,
+	const Point2 * texcs
+){
+	// convert into independent primitives
+	Key k = state;
+	k.prim = independent(state.prim, indices, num, mSeq);
+	if(k.prim < 0) return false;
+	if(!texcs) k.texture = 0;
+
+	if(mSeq.empty()) return true;
+
+	// bounds of transformed vertices, padded to the footprint of strokes
+	const float pad = k.size*0.5f;
+	float l=1e30f, t=1e30f, r=-1e30f, b=-1e30f;
+	for(unsigned i=0; i<mSeq.size(); ++i){
+		const Point2& p = verts[mSeq[i]];
+		float x = mv[0]*p.x + mv[4]*p.y + mv[12];
+		float y = mv[1]*p.x + mv[5]*p.y + mv[13];
+		if(x<l) l=x;
+		if(x>r) r=x;
+		if(y<t) t=y;
+		if(y>b) b=y;
+	}
+	l-=pad; t-=pad; r+=pad; b+=pad;
+
+	if(k.scissor){
+		// scissor box in window space, y down
+		float sl = k.box[0], st = mViewport[3] - (k.box[1] + k.box[3]);
+		float sr = sl + k.box[2], sb = st + k.box[3];
+
+		// entirely cropped?
+		if(l>=sr || r<=sl || t>=sb || b<=st) return true;
+
+		// entirely contained, so scissor has no effect
+		if(l>=sl && r<=sr && t>=st && b<=sb) k.scissor = 0;
+	}
+
+	// search back for a matching bucket that the primitives can move ahead to
+	int target = -1;
+	for(int i=int(mNumBuckets)-1, n=0; i>=0 && n<int(mSearchDepth); --i, ++n){
+		const Bucket& bk = mBuckets[i];
+		if(bk.key == k){ target = i; break; }
+		if(l<bk.r && r>bk.l && t<bk.b && b>bk.t) break;
+	}
+
+	if(target < 0){
+		if(mNumBuckets == mBuckets.size()) mBuckets.push_back(Bucket());
+		target = mNumBuckets++;
+		Bucket& bk = mBuckets[target];
+		bk.key = k;
+		bk.verts.clear();
+		bk.cols.clear();
+		bk.texcs.clear();
+		bk.l=l; bk.t=t; bk.r=r; bk.b=b;
+	}
+
+	Bucket& bk = mBuckets[target];
+	if(l<bk.l) bk.l=l;
+	if(r>bk.r) bk.r=r;
+	if(t<bk.t) bk.t=t;
+	if(b>bk.b) bk.b=b;
+
+	for(unsigned i=0; i<mSeq.size(); ++i){
+		const Point2& p = verts[mSeq[i]];
+		bk.verts.push_back(Point2(
+			mv[0]*p.x + mv[4]*p.y + mv[12],
+			mv[1]*p.x + mv[5]*p.y + mv[13]
+		));
+		bk.cols.push_back(cols ? cols[mSeq[i]] : color);
+		if(texcs) bk.texcs.push_back(texcs[mSeq[i]]);
+	}
+
+	return true;
+}
+
+void Batch::applyKey(const Key& k){
+	switch(k.prim){
+	case Points:
+		glPointSize(k.size);
+		(k.smooth ? glEnable : glDisable)(GL_POINT_SMOOTH);
+		break;
+	case Lines:
+		glLineWidth(k.size);
+		(k.smooth ? glEnable : glDisable)(GL_LINE_SMOOTH);
+		break;
+	default:;
+	}
+	(k.blend ? glEnable : glDisable)(GL_BLEND);
+	glBlendFunc(k.blendSrc, k.blendDst);
+	#ifndef GLV_OPENGL_ES1
+	glBlendEquation(k.blendEq);
+	#endif
+	(k.scissor ? glEnable : glDisable)(GL_SCISSOR_TEST);
+	if(k.scissor) glScissor(k.box[0], k.box[1], k.box[2], k.box[3]);
+}
+
+void Batch::flush(){
+	if(!mNumBuckets) return;
+
+	// state affected by drawing buckets is restored from the tracked state
+	const State& s = mState;
+	Key old;
+	old.prim = -1;
+	old.blend = s.enabled(Blend);
+	old.blendSrc = s.blendSrc();
+	old.blendDst = s.blendDst();
+	old.blendEq = s.blendEquation();
+	old.scissor = s.enabled(ScissorTest);
+	for(int i=0; i<4; ++i) old.box[i] = s.scissor()[i];
+	const int * viewport = s.viewport();
+
+	// vertices are in the window space of the batch
+	glViewport(mViewport[0], mViewport[1], mViewport[2], mViewport[3]);
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadMatrixf(mProj);
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+
+	for(unsigned i=0; i<mNumBuckets; ++i){
+		const Bucket& bk = mBuckets[i];
+		applyKey(bk.key);
+		glVertexPointer(2, GL_FLOAT, 0, &bk.verts[0]);
+		glColorPointer(4, GL_FLOAT, 0, &bk.cols[0]);
+		if(bk.key.texture){
+			glEnable(GL_TEXTURE_2D);
+			glBindTexture(GL_TEXTURE_2D, bk.key.texture);
+			glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+			glTexCoordPointer(2, GL_FLOAT, 0, &bk.texcs[0]);
+		}
+		glDrawArrays(bk.key.prim, 0, bk.verts.size());
+		if(bk.key.texture){
+			glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+			glBindTexture(GL_TEXTURE_2D, 0);
+			glDisable(GL_TEXTURE_2D);
+		}
+		++stats().calls; stats().vertices += bk.verts.size();
+	}
+
+	// the vertex array stays enabled as all paints require it
+	glDisableClientState(GL_COLOR_ARRAY);
+	glPopMatrix();
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(s.mode());
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+	// restore state
+	applyKey(old);
+	glLineWidth(s.lineWidth());
+	glPointSize(s.pointSize());
+	(s.enabled(LineSmooth) ? glEnable : glDisable)(GL_LINE_SMOOTH);
+	(s.enabled(PointSmooth) ? glEnable : glDisable)(GL_POINT_SMOOTH);
+	glColor4fv(s.color().components);
+
+	mNumBuckets = 0;
 }
 
 void enter2D(float w, float h) {
@@ -1,7 +1,10 @@
-#include <ctype.h>		// isgraph
-#include <string.h>		// strlen
+#include <string.h>		// strlen, memcmp
+#include <cmath>
+#include <memory>
 #include "glv_font.h"
 #include "glv_draw.h"	// GraphicsData
+#include "glv_rasterizer.h"
+#include "glv_texture.h"
 
 namespace glv{
 
@@ -208,66 +211,92 @@ static Glyph glyphs[94] = {
 //}
 
 
-static bool addCharacter(GraphicsData& g, int c, float dx, float dy, float sx, float sy){
+// Append vertices of character with its origin at (0,0)
+static void addCharacter(std::vector<Point2>& g, int c, float sx, float sy){
 
 	// composite character
-	if(c == '$'){ addCharacter(g, 'S',dx,dy,sx,sy); return addCharacter(g, '|',dx,dy,sx,sy); }
-
-	if(isgraph(c)){	// is graphical character?
-		#define GETX(x) ((x*sx+dx))
-		#define GETY(y) ((y*sy+dy))
-
-		c -= 33;
-		
-		float * x = glyphs[c].x;
-		float * y = glyphs[c].y;
-		int n     = glyphs[c].size();
-		int dots  = glyphs[c].dots();
-
-		if(dots){
-			// 8*2 = 16
-			for(int j=0; j<dots; ++j){
-				float l = GETX(x[j]);	float t = GETY(y[j]);
-				float r = l + sx;		float b = t + sy;
-				g.addVertex2(l,t,r,t);
-				g.addVertex2(r,t,r,b);
-				g.addVertex2(r,b,l,b);
-				g.addVertex2(l,b,l,t);
-			}
-			if(n == 0) goto render;
-			x += dots; y += dots;
-		}
+	if(c == '$'){ addCharacter(g, 'S',sx,sy); addCharacter(g, '|',sx,sy); return; }
 
-		--n;
-		// 16 + 1 = 17
-		g.addVertex2(GETX(x[0]), GETY(y[0]));
-		
-		// 17 + 7*2 = 31
-		if(glyphs[c].once() == 0){	// line strip
-			for(int i=1; i<n; ++i){
-				
-				float px = GETX(x[i]);
-				float py = GETY(y[i]);
-				g.addVertex2(px, py);
-				g.addVertex2(px, py);
-			}
+	#define GETX(x) ((x*sx))
+	#define GETY(y) ((y*sy))
+
+	c -= 33;
+	
+	float * x = glyphs[c].x;
+	float * y = glyphs[c].y;
+	int n     = glyphs[c].size();
+	int dots  = glyphs[c].dots();
+
+	if(dots){
+		// 8*2 = 16
+		for(int j=0; j<dots; ++j){
+			float l = GETX(x[j]);	float t = GETY(y[j]);
+			float r = l + sx;		float b = t + sy;
+			g.emplace_back(l,t); g.emplace_back(r,t);
+			g.emplace_back(r,t); g.emplace_back(r,b);
+			g.emplace_back(r,b); g.emplace_back(l,b);
+			g.emplace_back(l,b); g.emplace_back(l,t);
 		}
-		else{		// normal lines
-			for(int i=1; i<n; ++i) g.addVertex2(GETX(x[i]), GETY(y[i]));
+		if(n == 0) return;
+		x += dots; y += dots;
+	}
+
+	--n;
+	// 16 + 1 = 17
+	g.emplace_back(GETX(x[0]), GETY(y[0]));
+	
+	// 17 + 7*2 = 31
+	if(glyphs[c].once() == 0){	// line strip
+		for(int i=1; i<n; ++i){
+			float px = GETX(x[i]);
+			float py = GETY(y[i]);
+			g.emplace_back(px, py);
+			g.emplace_back(px, py);
 		}
-		
-		// 31 + 1 = 32
-		g.addVertex2(GETX(x[n]), GETY(y[n]));
-		
-		render:
-		//draw::paint(draw::Lines, xy, ind+1);
-		return true;
+	}
+	else{		// normal lines
+		for(int i=1; i<n; ++i) g.emplace_back(GETX(x[i]), GETY(y[i]));
 	}
 	
-	return c == ' ';
+	// 31 + 1 = 32
+	g.emplace_back(GETX(x[n]), GETY(y[n]));
+
+	#undef GETX
+	#undef GETY
 }
 
 
+// Line vertices of all graphical characters at a particular scale
+struct GlyphRuns{
+	std::vector<Point2> verts;
+	int begin[95];	// start of each character's run, plus end of last
+
+	GlyphRuns(float sx, float sy){
+		for(int c=33; c<=126; ++c){
+			begin[c-33] = verts.size();
+			addCharacter(verts, c, sx, sy);
+		}
+		begin[94] = verts.size();
+	}
+
+	const Point2 * run(int c) const { return &verts[begin[c-33]]; }
+	int size(int c) const { return begin[c-32] - begin[c-33]; }
+
+	// Get runs for scale, shared between all fonts
+	static const GlyphRuns& get(float sx, float sy){
+		static std::unordered_map<unsigned long long, GlyphRuns> runs;
+		unsigned long long key = (unsigned long long)(bits(sx)) << 32 | bits(sy);
+		auto it = runs.find(key);
+		if(it == runs.end()){
+			if(runs.size() >= 64) runs.clear(); // sizes are animating
+			it = runs.emplace(key, GlyphRuns(sx,sy)).first;
+		}
+		return it->second;
+	}
+
+	static unsigned bits(float v){ unsigned r; memcpy(&r, &v, 4); return r; }
+};
+
 
 struct TextIterator{
 
@@ -319,8 +348,42 @@ struct TextIterator{
 
 
 
+// Tessellate text string into line vertices
+// Call onGlyph(c, x, y) for each graphical character with its origin at the
+// pixel-centered pen position
+template <class OnGlyph>
+static void layout(const Font& f, const char * s, float tx, float ty, OnGlyph onGlyph){
+
+	struct Layout : public TextIterator{
+		Layout(const Font& f_, const char *& s_, OnGlyph& o_, float tx_, float ty_)
+		: TextIterator(f_,s_), onGlyph(o_), tx(tx_), ty(ty_), sx(f_.scaleX()), sy(f_.size()/Glyph::baseline()){}
+		bool onPrintable(char c){
+			if(c > 32 && c < 127){
+				onGlyph(c, draw::pixc(tx+x*sx), draw::pixc(ty+y*sy));
+				return true;
+			}
+			return c == ' ';
+		}
+		OnGlyph& onGlyph;
+		float tx,ty,sx,sy;
+	} l(f, s, onGlyph, tx,ty);
+
+	l.run();
+}
+
+// Tessellate text string into line vertices
+template <class AddVertex>
+static void tessellate(const Font& f, const char * s, float tx, float ty, AddVertex addVertex){
+	const GlyphRuns& runs = GlyphRuns::get(f.scaleX(), f.size()/Glyph::baseline());
+	layout(f, s, tx, ty, [&](char c, float dx, float dy){
+		const Point2 * v = runs.run(c);
+		for(int i=0, n=runs.size(c); i<n; ++i) addVertex(v[i].x + dx, v[i].y + dy);
+	});
+}
+
+
 Font::Font(float size_)
-:	mLetterSpacing(0), mLineSpacing(1.25), mTabSpaces(4)
+:	mSize(0), mLetterSpacing(0), mLineSpacing(1.25), mTabSpaces(4), mCacheText(true)
 {
 	size(size_);
 }
@@ -331,30 +394,19 @@ void Font::render(GraphicsData& gd, const char * v, float x, float y, float z) c
 	using namespace glv::draw;
 
 	gd.reset();
+	if(!v) return;
 
-	float sx = mScaleX;
-	float sy = mScaleY;
-	float tx = x;
-	float ty = y;
-	//float tz = z;
-	//float sh = -0.5*sy; // TODO: shear needs to be done an a per-line basis
-	//float sh = 0;
-	
-	//tx=ty=tz=0;
-
-	struct RenderText : public TextIterator{
-		RenderText(const Font& f_, const char *& s_, GraphicsData& g_, float tx_, float ty_, float sx_, float sy_)
-		: TextIterator(f_,s_), g(g_), tx(tx_), ty(ty_), sx(sx_), sy(sy_){}
-		bool onPrintable(char c){
-			return addCharacter(g, c, pixc(tx+x*sx), pixc(ty+y*sy), sx, sy);
+	if(mCacheText){
+		const GraphicsData& lines = textMesh(v, x, y).lines;
+		if(lines.vertices2().size()){
+			gd.vertices2().append(&lines.vertices2()[0], lines.vertices2().size());
 		}
-		GraphicsData& g;
-		float tx,ty,sx,sy;
-	} renderText(*this, v, gd, tx,ty,sx,sy);
-
-	renderText.run();
-	
-	draw::paint(draw::Lines, gd);
+		draw::paint(draw::Lines, lines);
+	}
+	else{
+		tessellate(*this, v, x, y, [&gd](float x, float y){ gd.addVertex2(x,y); });
+		draw::paint(draw::Lines, gd);
+	}
 }
 
 void Font::render(const char * v, float x, float y, float z) const{
@@ -362,6 +414,48 @@ void Font::render(const char * v, float x, float y, float z) const{
 	render(gd, v,x,y,z);
 }
 
+const Font::TextMesh& Font::textMesh(const char * v, float x, float y) const {
+	// FNV-1a hash of text and position
+	unsigned long long h = 14695981039346656037ULL;
+	const char * s = v;
+	for(; *s; ++s){ h ^= (unsigned char)(*s); h *= 1099511628211ULL; }
+	size_t len = s - v;
+	h ^= GlyphRuns::bits(x); h *= 1099511628211ULL;
+	h ^= GlyphRuns::bits(y); h *= 1099511628211ULL;
+
+	auto matches = [&](const TextMesh& m){
+		return m.x == x && m.y == y && m.text.size() == len && !memcmp(m.text.data(), v, len);
+	};
+
+	auto it = mTexts[0].find(h);
+	if(it != mTexts[0].end() && matches(it->second)) return it->second;
+
+	// When the recent strings fill up, they become the least recently used
+	// and the previous least recently used ones are dropped.
+	TextMesh m;
+	auto jt = mTexts[1].find(h);
+	if(jt != mTexts[1].end() && matches(jt->second)){
+		m = std::move(jt->second);
+		mTexts[1].erase(jt);
+	}
+	else{
+		m.text.assign(v, len);
+		m.x = x;
+		m.y = y;
+		m.lines.cache(true).stamp(1); // never changes
+		tessellate(*this, v, x, y, [&m](float x, float y){ m.lines.addVertex2(x,y); });
+	}
+
+	if(mTexts[0].size() >= 256){
+		mTexts[1].swap(mTexts[0]);
+		mTexts[0].clear();
+	}
+
+	TextMesh& r = mTexts[0][h];
+	r = std::move(m);
+	return r;
+}
+
 //void Font::render(const char * v, float x, float y, float z) const{
 //	using namespace glv::draw;
 //	draw::push(ModelView);
@@ -400,11 +494,24 @@ void Font::render(const char * v, float x, float y, float z) const{
 //	draw::pop(); // ModelView
 //}
 
-Font& Font::letterSpacing(float v){ mLetterSpacing=v; return *this; }
+Font& Font::cacheText(bool v){
+	mCacheText=v;
+	if(!v) clearTexts();
+	return *this;
+}
 
-Font& Font::lineSpacing(float v){ mLineSpacing=v; return *this; }
+Font& Font::letterSpacing(float v){
+	if(v != mLetterSpacing) clearTexts();
+	mLetterSpacing=v; return *this;
+}
+
+Font& Font::lineSpacing(float v){
+	if(v != mLineSpacing) clearTexts();
+	mLineSpacing=v; return *this;
+}
 
 Font& Font::size(float v){
+	if(v != mSize) clearTexts();
 	mSize = v;
 	mScaleY = v/Glyph::baseline();
 	mScaleX = mScaleY;
@@ -414,7 +521,10 @@ Font& Font::size(float v){
 	return *this;
 }
 
-Font& Font::tabSpaces(unsigned v){ mTabSpaces=v; return *this; }
+Font& Font::tabSpaces(unsigned v){
+	if(v != mTabSpaces) clearTexts();
+	mTabSpaces=v; return *this;
+}
 
 float Font::advance(const char *text) const {
 	return advance(' ') * strlen(text);
@@ -444,4 +554,133 @@ float Font::baseline() const { return Glyph::baseline() * mScaleY; }
 float Font::descent() const { return (Glyph::descent() - Glyph::baseline()) * mScaleY; }
 
 
+
+// Alpha texture of all graphical characters at a particular scale, laid out in
+// a grid of equally sized cells
+struct GlyphAtlas{
+	enum{ Cols=16, Rows=6, Pad=2 };
+
+	Texture2 tex;		// texels, sent to a texture of each context
+	draw::ContextObjects name{draw::ContextObjects::Textures};
+	float ox, oy;		// glyph origin within cell
+	int cellW, cellH;	// cell dimensions, in texels
+
+	GlyphAtlas(float sx, float sy)
+	:	tex(0,0, GL_ALPHA, GL_UNSIGNED_BYTE)
+	{
+		const GlyphRuns& runs = GlyphRuns::get(sx,sy);
+
+		float minX=0, minY=0, maxX=0, maxY=0;
+		for(const Point2& p : runs.verts){
+			if(p.x < minX) minX = p.x;
+			if(p.x > maxX) maxX = p.x;
+			if(p.y < minY) minY = p.y;
+			if(p.y > maxY) maxY = p.y;
+		}
+
+		// glyph origins are on pixel centers like those of stroked text
+		ox = Pad + 0.5f - std::floor(minX);
+		oy = Pad + 0.5f - std::floor(minY);
+		cellW = int(std::ceil(maxX) - std::floor(minX)) + 2*Pad + 1;
+		cellH = int(std::ceil(maxY) - std::floor(minY)) + 2*Pad + 1;
+		int w = pow2(Cols*cellW);
+		int h = pow2(Rows*cellH);
+
+		// stroke glyphs into framebuffer the same way Views do
+		draw::Rasterizer ras(w,h);
+		ras.begin();
+		draw::enter2D(w,h);
+		draw::clearColor(0,0,0,0);
+		draw::clear(GL_COLOR_BUFFER_BIT);
+		draw::color(1,1,1);
+		draw::lineWidth(1);
+		std::vector<Point2> v;
+		for(int c=33; c<127; ++c){
+			v.assign(runs.run(c), runs.run(c) + runs.size(c));
+			for(Point2& p : v){ p.x += cellX(c) + ox; p.y += cellY(c) + oy; }
+			if(!v.empty()) draw::paint(draw::Lines, &v[0], v.size());
+		}
+		ras.end();
+
+		tex.alloc(w,h);
+		unsigned char * a = tex.buffer<unsigned char>();
+		for(int i=0; i<w*h; ++i) a[i] = ras.pixels()[i*4];
+	}
+
+	int cellX(int c) const { return ((c-33) % Cols) * cellW; }
+	int cellY(int c) const { return ((c-33) / Cols) * cellH; }
+
+	// Get texture name, creating texture on first call in the current context
+	unsigned texture(){
+		if(!name.claim()){
+			glGenTextures(1, name.names());
+			glBindTexture(GL_TEXTURE_2D, name.name());
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, tex.width(), tex.height(), 0,
+				GL_ALPHA, GL_UNSIGNED_BYTE, tex.buffer<unsigned char>());
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			glBindTexture(GL_TEXTURE_2D, 0);
+		}
+		return name.name();
+	}
+
+	static int pow2(int v){ int r=1; while(r<v) r<<=1; return r; }
+
+	// Get atlas for scale, shared between all atlas fonts
+	static GlyphAtlas& get(float sx, float sy){
+		static auto& atlases = *new std::unordered_map<unsigned long long, std::unique_ptr<GlyphAtlas>>;
+		unsigned long long key = (unsigned long long)(GlyphRuns::bits(sx)) << 32 | GlyphRuns::bits(sy);
+		auto it = atlases.find(key);
+		if(it == atlases.end()){
+			if(atlases.size() >= 16){ // sizes are animating
+				draw::flushBatch(); // batched text may still use the textures
+				atlases.clear();
+			}
+			it = atlases.emplace(key, std::unique_ptr<GlyphAtlas>(new GlyphAtlas(sx,sy))).first;
+		}
+		return *it->second;
+	}
+};
+
+
+AtlasFont::AtlasFont(float size_)
+:	Font(size_)
+{}
+
+void AtlasFont::render(GraphicsData& g, const char * v, float x, float y, float z) const{
+	if(draw::Backend::current()){
+		Font::render(g, v,x,y,z);
+		return;
+	}
+
+	if(mesh(g, v, x, y)){
+		GlyphAtlas& a = GlyphAtlas::get(scaleX(), size()/Glyph::baseline());
+		draw::paint(draw::Triangles, g, a.texture());
+	}
+}
+
+bool AtlasFont::mesh(GraphicsData& g, const char * v, float x, float y) const{
+	g.reset();
+	if(!v) return false;
+
+	GlyphAtlas& a = GlyphAtlas::get(scaleX(), size()/Glyph::baseline());
+	const float iw = 1.f/a.tex.width();
+	const float ih = 1.f/a.tex.height();
+
+	layout(*this, v, x, y, [&](char c, float dx, float dy){
+		float l = dx - a.ox, t = dy - a.oy;
+		float r = l + a.cellW, b = t + a.cellH;
+		float tl = a.cellX(c)*iw, tt = a.cellY(c)*ih;
+		float tr = tl + a.cellW*iw, tb = tt + a.cellH*ih;
+		g.addVertex2(l,t, r,t, l,b);
+		g.addVertex2(r,t, r,b, l,b);
+		g.addTexCoord2(tl,tt); g.addTexCoord2(tr,tt); g.addTexCoord2(tl,tb);
+		g.addTexCoord2(tr,tt); g.addTexCoord2(tr,tb); g.addTexCoord2(tl,tb);
+	});
+	return true;
+}
+
+
 } // glv::
@@ -1,19 +1,32 @@
 /*	Graphics Library of Views (GLV) - GUI Building Toolkit
 	See COPYRIGHT file for authors and license information */
 
+#include <algorithm>
 #include "glv_core.h"
+#include "glv_profiler.h"
 
 namespace glv{
 
 GLV::GLV(space_t width, space_t height)
-:	View(Rect(width, height)), mFocusedView(this)
+:	View(Rect(width, height)), mFocusedView(this),
+	mTreeRevision(0), mEventRevision(0), mDrawListRevision(0), mDrawListW(0), mDrawListH(0), mDrawListValid(false),
+	mBackBuffer(0, 0, 0, GL_RGB, GL_UNSIGNED_BYTE),
+	mBackBufferBackend(0), mBackBufferW(0), mBackBufferH(0), mBackBufferValid(false),
+	mPartialRedraw(false), mBatchDraws(false), mEventMaskTreeRevision(0), mEventMaskRevision(0),
+	mEventMasksValid(false), mInputObserver(0), mProfiler(0), mQueueInput(false),
+	mContext(draw::newContext())
 {
 	disable(DrawBorder | FocusHighlight);
 //	cloneStyle();
+	for(int i=0; i<2; ++i){
+		mGraphicsData[i].arena(&mFrameArena);
+		mGraphicsData[i].capacities(mFrameCapacities[i]);
+	}
 	instances().push_back(this);
 }
 
 GLV::~GLV(){ //printf("~GLV\n");
+	draw::contextLost(mContext);
 	for(unsigned i=0; i<instances().size(); ++i){
 		if(instances()[i] == this){
 			instances().erase(instances().begin() + i);
@@ -24,23 +37,82 @@ GLV::~GLV(){ //printf("~GLV\n");
 
 void GLV::broadcastEvent(Event::t e){ 
 
-	struct A : TraversalAction{
-		GLV& glv; Event::t event;
-		A(GLV& g, Event::t e): glv(g), event(e){}
-		bool operator()(View * v, int depth) override {
-			glv.doEventCallbacks(*v, event);
-			return true;
+	// the retained frame and cached graphics data do not survive the graphics context
+	switch(e){
+		case Event::WindowCreate:	mBackBufferValid = false; draw::contextLost(mContext); break;
+		case Event::WindowDestroy:	mBackBuffer.destroy(); mBackBufferValid = false; draw::contextLost(mContext); break;
+		default:;
+	}
+
+	// Iterate a copy since callbacks that change subscriptions and broadcast
+	// again rebuild the subscriber list.
+	std::vector<View *> views = subscribers(e), called;
+	unsigned revision = mTreeRevision;
+
+	for(unsigned i=0; i<views.size(); ++i){
+		doEventCallbacks(*views[i], e, true);
+
+		// The tree was modified by a callback, so the remaining Views may be
+		// dangling. Continue with the new subscribers not yet called.
+		if(mTreeRevision != revision){
+			called.insert(called.end(), views.begin(), views.begin() + i + 1);
+			std::sort(called.begin(), called.end());
+			const std::vector<View *>& now = subscribers(e);
+			std::vector<View *> next;
+			for(unsigned j=0; j<now.size(); ++j){
+				if(!std::binary_search(called.begin(), called.end(), now[j])) next.push_back(now[j]);
+			}
+			views.swap(next);
+			i = unsigned(-1);
+			revision = mTreeRevision;
 		}
-	} a(*this, e);
-	
-	traverseDepth(a);
+	}
+}
+
+const std::vector<View *>& GLV::subscribers(Event::t e){
+	const unsigned bit = Event::bit(e);
+	Subscribers& s = mSubscribers[unsigned(e) < 31 ? unsigned(e) : 31];
+
+	if(s.valid && s.treeRevision == mTreeRevision && s.eventRevision == mEventRevision){
+		return s.views;
+	}
+
+	// depth-first, skipping subtrees without handlers or listeners
+	updateEventMasks();
+	s.views.clear();
+	View * v = this;
+	while(v){
+		const bool visit = v->mSubtreeEventMask & bit;
+		if(visit && ((v->mEventHandlerMask | v->mListenMask) & bit)) s.views.push_back(v);
+		if(visit && v->child){
+			v = v->child;
+			continue;
+		}
+		while(v && v != this && !v->sibling) v = v->parent;
+		if(!v || v == this) break;
+		v = v->sibling;
+	}
+
+	s.treeRevision = mTreeRevision;
+	s.eventRevision = mEventRevision;
+	s.valid = true;
+	return s.views;
+}
+
+void GLV::updateEventMasks(){
+	if(!mEventMasksValid || mEventMaskTreeRevision != mTreeRevision || mEventMaskRevision != mEventRevision){
+		updateSubtreeEventMask();
+		mEventMaskTreeRevision = mTreeRevision;
+		mEventMaskRevision = mEventRevision;
+		mEventMasksValid = true;
+	}
 }
 
 
 
 // The bubbling return values from the virtual and function pointer callbacks
 // are ANDed together.
-bool GLV::doEventCallbacks(View& v, Event::t e){
+bool GLV::doEventCallbacks(View& v, Event::t e, bool broadcast){
 //	printf("doEventCallbacks: %s %d\n", v.className(), e);
 
 	// TODO: which is better?
@@ -89,19 +161,19 @@ bool GLV::doEventCallbacks(View& v, Event::t e){
 
 	bool bubble = true;
 
-	if(v.hasEventHandlers(e)){
-		const EventHandlers& hs = v.mEventHandlersMap()[e];
+	if(v.mEventHandlerMask & Event::bit(e)){
 
-		// Execute callbacks in list
-		for(EventHandlers::const_iterator it = hs.begin(); it != hs.end(); ++it){
-			if(*it){
-				bubble = (*it)->onEvent(v, *this);
+		// Execute callbacks in order added
+		for(unsigned i=0; i<v.mEventHandlers.size(); ++i){
+			const View::EventHandlerEntry& entry = v.mEventHandlers[i];
+			if(entry.type == e){
+				bubble = entry.handler->onEvent(v, *this);
 				if(!bubble) break;
 			}
 		}
 	}
 
-	if(bubble) bubble = v.onEvent(e, *this);
+	if(bubble && (!broadcast || v.listening(e))) bubble = v.onEvent(e, *this);
 	
 	return bubble || v.enabled(AlwaysBubble);
 }
@@ -125,29 +197,20 @@ void GLV::drawGLV(unsigned ww, unsigned wh, double dsec){
 #ifdef GLV_OPENGL_ES1
 	// glDrawBuffer is not necessary according to opengles v1.1 spec
 #else
-	glDrawBuffer(GL_BACK);
+	if(!draw::Backend::current()) glDrawBuffer(GL_BACK);
 #endif
 	drawWidgets(ww, wh, dsec);
 }
 
 
 static void drawContext(float tx, float ty, View * v, float& cx, float& cy, View *& c){
-	using namespace glv::draw;
-
 	cx += tx; cy += ty;	// update absolute coordinates of drawing context
-
-	identity();								// clear model matrix (assumed set already)
-
-	// The offsets are necessary so that we draw on the center of pixels
-	// rather than on the boundaries
-//	translate(pixc(cx), pixc(cy));	// offset to center of top-left pixel
-	translate(pix(cx), pix(cy));	// round position to nearest pixel coordinates
-//	translate(cx, cy);
-
 	c = v;
 }
 
 static void computeCrop(std::vector<Rect>& cr, int lvl, space_t ax, space_t ay, View * v){
+	if(lvl >= int(cr.size())) cr.resize(cr.size()*2);
+
 	if(v->enabled(CropChildren)){
 		cr[lvl].set(ax, ay, v->w, v->h);	// set absolute rect
 		
@@ -164,22 +227,22 @@ static void computeCrop(std::vector<Rect>& cr, int lvl, space_t ax, space_t ay,
 	else{ cr[lvl] = cr[lvl-1]; }
 }
 
-// Views are drawn depth-first from leftmost to rightmost sibling
-void GLV::drawWidgets(unsigned int ww, unsigned int wh, double dsec){
-	using namespace draw;
+// Computes scissor box, in window coordinates, of rect in GUI coordinates
+static void scissorBox(const Rect& r, unsigned wh, int& sx, int& sy, int& sw, int& sh){
+	using namespace glv::draw;
+	sx = pix(r.l);
+	sy = wh - (pix(r.t) + pix(r.h)) + 0.99;
+	sw = pix(r.w);
+	sh = r.h + 0.5;
+	if(sy < 0) sy=0;
+}
 
-	// TODO: Perhaps the View tree should be serialized into a separate list
-	//		used for rendering?
-	//		This will permit a user to change the graph structure during a draw 
-	//		callback. Currently if this is attempted, we crash and burn.
+static const Property::t drawListFlags = Visible | CropChildren | CropSelf;
 
-	enter2D(ww, wh);		// initialise the OpenGL renderer for our 2D GUI world
+// Serializes the View tree depth-first from leftmost to rightmost sibling
+void GLV::rebuildDrawList(unsigned int ww, unsigned int wh, const std::vector<View *>& synced){
 
-	// Render all primitives at integer positions, ref: OpenGL Redbook
-	// NOTE: This is a comprise to get almost pixel-perfection for both lines 
-	// (half-integers) and polygons (integers). We'll do it "by hand" due to all
-	// the exceptions and to get exact pixel-perfect accuracy.
-//	translate(0.375f, 0.375f);
+	mDrawList.clear();
 
 	float cx = 0, cy = 0; // drawing context absolute position
 	View * const root = this;
@@ -189,32 +252,17 @@ void GLV::drawWidgets(unsigned int ww, unsigned int wh, double dsec){
 	// view. The intersections also need to be done in absolute coordinates.	
 	std::vector<Rect> cropRects(16, Rect(ww, wh));	// index is hierarchy level
 	int lvl = 0;	// start at root = 0
-	
-	glEnableClientState(GL_VERTEX_ARRAY);
-	//glEnableClientState(GL_COLOR_ARRAY); // note: enabling this messes up glColor, so leave it off
-	//glColorPointer(4, GL_FLOAT, 0, 0);
-
-	// Animate all the views
-	struct AnimateViews : public TraversalAction{
-		AnimateViews(double dt_): dt(dt_){}
-		bool operator()(View * v, int depth) override {
-			if(v->enabled(Animate)) v->onAnimate(dt);
-			return true;
-		}
-		double dt;
-	} animateViews(dsec);
-	traverseDepth(animateViews);
-
-	graphicsData().reset();
-	//if(enabled(Animate)) onAnimate(dsec);
-	doDraw(*this);
-
-	draw::enable(ScissorTest);
 
 	while(true){
 
-		cv->onDataModelSync();		// update state based on attached model variables
-		cv->rectifyGeometry();
+		if(!std::binary_search(synced.begin(), synced.end(), cv)){
+			{	FrameProfiler::Scope s(mProfiler, *cv, FrameProfiler::DataModelSync);
+				cv->onDataModelSync();	// update state based on attached model variables
+			}
+			{	FrameProfiler::Scope s(mProfiler, *cv, FrameProfiler::Geometry);
+				cv->rectifyGeometry();
+			}
+		}
 
 		// find the next view to draw
 
@@ -243,41 +291,261 @@ void GLV::drawWidgets(unsigned int ww, unsigned int wh, double dsec){
 			}
 			else break; // break the loop when the traversal returns to the root
 		}
-		
-		// animate current view
-		//if(cv->enabled(Animate)) cv->onAnimate(dsec);
-		
-		// draw current view
-		if(cv->visible()){
-			Rect r = cropRects[lvl-1];	// cropping region comes from parent context
-			if(cv->enabled(CropSelf)) r.intersection(Rect(cx, cy, cv->w, cv->h), r); // crop my own draw?
-
-			// bypass if drawing area outside of crop region
-			if(r.h<=0.f || r.w <= 0.f) continue;
-
-			int sx = pix(r.l);
-			int sy = wh - (pix(r.t) + pix(r.h)) + 0.99;
-			int sw = pix(r.w);
-			int sh = r.h + 0.5;
-//			if(sx < int(ww) && sy < int(wh)){	// LJP: this might be too paranoid
-//				if(sx < 0) sx=0;
-				if(sy < 0) sy=0;
-//				if(sx+sw > int(ww)) sw = ww - sx;
-//				if(sy+sh > int(wh)) sh = wh - sy;
-				//printf("[%d %d] -> %d %d %d %d\n", ww,wh, sx,sy,sw,sh);
-				scissor(sx, sy, sw, sh);
-
-				graphicsData().reset();
-				//if(cv->enabled(Animate)) cv->onAnimate(dsec);
-				cv->doDraw(*this);
-//			}
+
+		DrawItem item;
+		item.view = cv;
+		item.rect = *cv;
+		item.abs.set(cx, cy, cv->w, cv->h);
+		item.crop = cropRects[lvl-1];	// cropping region comes from parent context
+		if(cv->enabled(CropSelf)) item.crop.intersection(item.abs, item.crop); // crop my own draw?
+		item.depth = lvl;
+		item.flags = cv->mFlags & drawListFlags;
+		mDrawList.push_back(item);
+	}
+
+	mDrawListRoot = *root;
+	mDrawListRevision = mTreeRevision;
+	mDrawListW = ww;
+	mDrawListH = wh;
+	mDrawListValid = true;
+}
+
+bool GLV::updateDrawList(unsigned int ww, unsigned int wh){
+
+	bool stale = !mDrawListValid || mDrawListRevision != mTreeRevision
+		|| mDrawListW != ww || mDrawListH != wh;
+
+	bool rootSynced = false;
+	unsigned numSynced = 0;	// listed Views already synced
+
+	if(!stale){
+		rootSynced = true;
+		{	FrameProfiler::Scope s(mProfiler, *this, FrameProfiler::DataModelSync);
+			onDataModelSync();
+		}
+		{	FrameProfiler::Scope s(mProfiler, *this, FrameProfiler::Geometry);
+			rectifyGeometry();
+		}
+		stale = mDrawListRoot != *this;
+
+		for(; numSynced<mDrawList.size() && !stale; ++numSynced){
+			const DrawItem& item = mDrawList[numSynced];
+			View& v = *item.view;
+			{	FrameProfiler::Scope s(mProfiler, v, FrameProfiler::DataModelSync);
+				v.onDataModelSync();
+			}
+			{	FrameProfiler::Scope s(mProfiler, v, FrameProfiler::Geometry);
+				v.rectifyGeometry();
+			}
+
+			// model syncing might have altered the tree or a view's geometry
+			stale = mDrawListRevision != mTreeRevision
+				|| item.rect != v
+				|| item.flags != (v.mFlags & drawListFlags);
 		}
 	}
 
-	glDisableClientState(GL_VERTEX_ARRAY);
+	if(stale){
+		// Resume syncing from the stale point. The synced Views are only
+		// compared by address since a callback may have deleted them.
+		std::vector<View *> synced;
+		if(rootSynced){
+			synced.reserve(numSynced + 1);
+			synced.push_back(this);
+			for(unsigned i=0; i<numSynced; ++i) synced.push_back(mDrawList[i].view);
+			std::sort(synced.begin(), synced.end());
+		}
+		rebuildDrawList(ww, wh, synced);
+	}
+	return stale;
+}
+
+// Views are drawn depth-first from leftmost to rightmost sibling
+void GLV::drawWidgets(unsigned int ww, unsigned int wh, double dsec){
+	using namespace draw;
+
+	// The View tree is serialized into a draw list that is only rebuilt when
+	// the structure or geometry of the tree changes. Since the draw list is 
+	// replayed, the tree structure may be modified from within a draw 
+	// callback; the remaining Views are then drawn on the next frame.
+
+	if(mProfiler) mProfiler->beginFrame();
+
+	// input is dispatched before animating so that Views see its effects
+	dispatchInput();
+
+	enter2D(ww, wh);		// initialise the OpenGL renderer for our 2D GUI world
+	draw::stats().reset();
+
+	// a software backend has neither client arrays nor a readable back buffer
+	draw::Backend * const backend = draw::Backend::current();
+	const bool gl = !backend;
+	if(gl) draw::context(mContext);	// deletes GL objects released since last frame
+
+	// the last frame is kept in a texture or by the backend's own framebuffer
+	const bool canRetain = gl || backend->retainsFrame();
+
+	// Render all primitives at integer positions, ref: OpenGL Redbook
+	// NOTE: This is a comprise to get almost pixel-perfection for both lines 
+	// (half-integers) and polygons (integers). We'll do it "by hand" due to all
+	// the exceptions and to get exact pixel-perfect accuracy.
+//	translate(0.375f, 0.375f);
+	
+	if(gl) glEnableClientState(GL_VERTEX_ARRAY);
+	//glEnableClientState(GL_COLOR_ARRAY); // note: enabling this messes up glColor, so leave it off
+	//glColorPointer(4, GL_FLOAT, 0, 0);
+
+	// Animate all the views
+	struct AnimateViews : public TraversalAction{
+		AnimateViews(double dt_, FrameProfiler * p): dt(dt_), prof(p){}
+		bool operator()(View * v, int depth) override {
+			if(v->enabled(Animate)){
+				FrameProfiler::Scope s(prof, *v, FrameProfiler::Animate);
+				v->onAnimate(dt);
+			}
+			return true;
+		}
+		double dt;
+		FrameProfiler * prof;
+	} animateViews(dsec, mProfiler);
+	traverseDepth(animateViews);
+
+	const bool rebuilt = updateDrawList(ww, wh);
+	const unsigned revision = mTreeRevision;
+
+	// Determine the region to redraw. A partial redraw covers the union of
+	// all damaged Views and is composited on top of the retained last frame.
+	bool partial = canRetain && mPartialRedraw && mBackBufferValid && !rebuilt && !damaged()
+		&& mBackBufferBackend == backend && mBackBufferW == ww && mBackBufferH == wh;
+	Rect region(ww, wh);
+
+	if(partial){
+		region.set(0,0,0,0);
+		for(unsigned i=0; i<mDrawList.size(); ++i){
+			const DrawItem& item = mDrawList[i];
+			const Rect& r = item.crop;
+			if(!item.view->damaged() || !(item.flags & Visible) || r.h<=0.f || r.w<=0.f) continue;
+			if(region.w > 0.f) region.unionOf(r, region);
+			else region = r;
+		}
+	}
+	
+	if(mPartialRedraw){
+		mDamaged = false;
+		for(unsigned i=0; i<mDrawList.size(); ++i) mDrawList[i].view->mDamaged = false;
+	}
+
+	int sx, sy, sw, sh;
+
+	if(partial && gl){
+		identity();
+		draw::enable(Texture2D);
+		color(1,1,1,1);
+		mBackBuffer.begin();
+		mBackBuffer.draw(0,0, ww,wh);
+		mBackBuffer.end();
+		draw::disable(Texture2D);
+	}
+
+	if(partial){
+		draw::enable(ScissorTest);
+		scissorBox(region, wh, sx, sy, sw, sh);
+		scissor(sx, sy, sw, sh);
+	}
+
+	// nothing new to draw?
+	if(partial && (region.w <= 0.f || region.h <= 0.f)){
+		if(gl) glDisableClientState(GL_VERTEX_ARRAY);
+		draw::disable(ScissorTest);
+		mDrawStats = draw::stats();
+		resetFrameArena();
+		if(mProfiler) mProfiler->endFrame();
+		return;
+	}
+
+	const bool batch = gl && mBatchDraws;
+	if(batch) mBatch.begin();
+
+	// reserve up front so that no View needs to grow the buffers
+	for(int i=0; i<2; ++i) mGraphicsData[i].reserve(mFrameCapacities[i]);
+
+	graphicsData().reset();
+	//if(enabled(Animate)) onAnimate(dsec);
+	doDraw(*this);
+
+	draw::enable(ScissorTest);
+
+	for(unsigned i=0; i<mDrawList.size(); ++i){
+		const DrawItem& item = mDrawList[i];
+		Rect r = item.crop;
+		if(partial) r.intersection(region, r);
+
+		// bypass if invisible or drawing area outside of crop region
+		if(!(item.flags & Visible) || r.h<=0.f || r.w <= 0.f) continue;
+
+		identity();								// clear model matrix (assumed set already)
+
+		// The offsets are necessary so that we draw on the center of pixels
+		// rather than on the boundaries
+//		draw::translate(pixc(item.abs.l), pixc(item.abs.t));	// offset to center of top-left pixel
+		draw::translate(pix(item.abs.l), pix(item.abs.t));	// round position to nearest pixel coordinates
+
+		scissorBox(r, wh, sx, sy, sw, sh);
+		//printf("[%d %d] -> %d %d %d %d\n", ww,wh, sx,sy,sw,sh);
+		scissor(sx, sy, sw, sh);
+
+		graphicsData().reset();
+		item.view->doDraw(*this);
+
+		// tree was modified during draw so remaining items may be dangling
+		if(mTreeRevision != revision) break;
+	}
+
+	if(batch) mBatch.end();
+
+	// retain the frame for subsequent partial redraws
+	if(mPartialRedraw){
+		if(mTreeRevision != revision || !canRetain){
+			mBackBufferValid = false;
+		}
+		else{
+			if(gl){
+				if(!partial){
+					mBackBuffer.create(ww, wh);
+					sx = sy = 0; sw = ww; sh = wh;
+				}
+				else{
+					scissorBox(region, wh, sx, sy, sw, sh);
+				}
+				mBackBuffer.begin();
+				glCopyTexSubImage2D(GL_TEXTURE_2D, 0, sx, sy, sx, sy, sw, sh);
+				mBackBuffer.end();
+			}
+			mBackBufferBackend = backend;
+			mBackBufferW = ww;
+			mBackBufferH = wh;
+			mBackBufferValid = true;
+		}
+	}
+	if(gl) glDisableClientState(GL_VERTEX_ARRAY);
 	//glDisableClientState(GL_COLOR_ARRAY);
 
 	draw::disable(ScissorTest);
+	mDrawStats = draw::stats();
+	resetFrameArena();
+	if(mProfiler) mProfiler->endFrame();
+}
+
+void GLV::resetFrameArena(){
+	for(int i=0; i<2; ++i){
+		int caps[GraphicsData::numBuffers];
+		mGraphicsData[i].capacities(caps);
+		for(int j=0; j<GraphicsData::numBuffers; ++j){
+			if(caps[j] > mFrameCapacities[i][j]) mFrameCapacities[i][j] = caps[j];
+		}
+		mGraphicsData[i].release();
+	}
+	mFrameArena.reset();
 }
 
 std::vector<GLV *>& GLV::instances(){
@@ -288,6 +556,7 @@ std::vector<GLV *>& GLV::instances(){
 bool GLV::propagateEvent(){ //printf("GLV::propagateEvent(): %s\n", Event::getName(eventtype));
 	View * v = mFocusedView;
 	Event::t e = eventType();
+	if(v && v != this) v->damage();	// assume target's appearance may change
 	while(v && doEventCallbacks(*v, e)) v = v->parent;
 	return v != 0;
 }
@@ -380,6 +649,94 @@ void GLV::setMouseWheel(int wheelDelta){
 	mMouse.bufferPos(mMouse.mW[0] + (space_t)wheelDelta, mMouse.mW);
 }
 
+GLV& GLV::queueInput(bool v){
+	mQueueInput = v;
+	if(!v){
+		for(unsigned i=0; i<mInputQueue.size(); ++i) dispatchInput(mInputQueue[i]);
+		mInputQueue.clear();
+	}
+	return *this;
+}
+
+void GLV::postInput(const InputEvent& e){
+	++mInputCounts.received;
+	if(mInputObserver) mInputObserver->onInput(e);
+
+	if(!mQueueInput){
+		dispatchInput(e);
+		return;
+	}
+
+	// Coalesce with last event. Motion events go to the focused View, which
+	// can only change on a mouse down, so consecutive ones share a target.
+	if(!mInputQueue.empty()){
+		InputEvent& last = mInputQueue.back();
+		if(last.type == e.type){
+			bool merged = true;
+			switch(e.type){
+			case Event::MouseMove:
+			case Event::MouseDrag:
+				last.x = e.x; last.y = e.y;
+				break;
+			case Event::MouseWheel:
+				last.wheel += e.wheel;
+				break;
+			default:
+				merged = false;
+			}
+			if(merged){
+				if(e.hasModifiers){
+					for(int i=0; i<5; ++i) last.modifiers[i] = e.modifiers[i];
+					last.hasModifiers = true;
+				}
+				return;
+			}
+		}
+	}
+	mInputQueue.push_back(e);
+}
+
+void GLV::dispatchInput(){
+	// events posted while dispatching are queued for the next frame
+	mInputDispatch.swap(mInputQueue);
+	for(unsigned i=0; i<mInputDispatch.size(); ++i) dispatchInput(mInputDispatch[i]);
+	mInputDispatch.clear();
+
+	mInputStats = mInputCounts;
+	mInputCounts = InputStats();
+}
+
+void GLV::dispatchInput(const InputEvent& e){
+	space_t relx = e.x, rely = e.y;
+
+	switch(e.type){
+	case Event::KeyDown:	setKeyDown(e.key); break;
+	case Event::KeyUp:		setKeyUp(e.key); break;
+	case Event::MouseDown:	setMouseDown(relx, rely, e.button, e.clicks); break;
+	case Event::MouseUp:	setMouseUp(relx, rely, e.button, e.clicks); break;
+	case Event::MouseMove:
+	case Event::MouseDrag:	setMouseMotion(relx, rely, e.type); break;
+	case Event::MouseWheel:	setMouseWheel(e.wheel); break;
+	default:				eventType(e.type);
+	}
+
+	switch(e.type){
+	case Event::MouseDown:
+	case Event::MouseUp:
+	case Event::MouseMove:
+	case Event::MouseDrag:	setMousePos(e.x, e.y, relx, rely); break;
+	default:;
+	}
+
+	if(e.hasModifiers){
+		const bool * m = e.modifiers;
+		setKeyModifiers(m[0], m[1], m[2], m[3], m[4]);
+	}
+
+	++mInputCounts.dispatched;
+	propagateEvent();
+}
+
 bool GLV::valid(const GLV * g){
 	for(unsigned i=0; i<instances().size(); ++i){
 		if(instances()[i] == g) return true;
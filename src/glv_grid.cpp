@@ -52,10 +52,15 @@ void Grid::onAnimate(double dt){
 
 void Grid::onDraw(GLV& g){
 
+	bool moving = mVelW != 0;
 	for(int i=0; i<DIM; ++i){
-		if(!mLockScroll[i] && mVel[i] != 0) interval(i).translate(mVel[i]);
+		if(!mLockScroll[i] && mVel[i] != 0){
+			interval(i).translate(mVel[i]);
+			moving = true;
+		}
 	}
 	if(mVelW != 0) zoomOnMousePos(mVelW, g.mouse());
+	if(moving) damage();	// keep scrolling on the next frame
 
 	using namespace glv::draw;
 	GraphicsData& gd = g.graphicsData();
@@ -1,7 +1,16 @@
 #include "glv_model.h"
 #include <stdio.h>	// sscanf, FILE
 #include <cctype>	// isalnum, isblank
+#include <cstddef>	// max_align_t
+#include <cstdint>	// uint32_t, uint64_t
 #include <cstring>	// strchr, strpbrk
+#include <new>		// placement new
+#ifndef GLV_PLATFORM_WIN
+	#include <fcntl.h>	// open
+	#include <sys/mman.h>	// mmap
+	#include <sys/stat.h>	// fstat
+	#include <unistd.h>	// close
+#endif
 
 //#ifndef WIN32
 //#define	sprintf_s(buffer, buffer_size, stringbuffer, ...) (snprintf(buffer, buffer_size, stringbuffer, __VA_ARGS__))
@@ -212,9 +221,331 @@ static inline int count(const Data& a, const Data& b){
 	return a.size()<b.size() ? a.size() : b.size();
 }
 
+// Numeric kernels
+//
+// Element-wise operations between arrays of the same primitive type with unit
+// stride are done with the widest vector instructions the CPU supports. The
+// vector kernels round exactly as the scalar loops do: mixes are computed in
+// double precision, term by term, without fused multiply-adds.
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+	#define GLV_SIMD_X86
+	#include <immintrin.h>
+	#define GLV_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+namespace{
+
+const int kMaxMix = 8; // maximum number of mixed arrays handled by kernels
+
+template <class T>
+void addScalar(T * dst, const T * src, int n){
+	for(int i=0; i<n; ++i) dst[i] += src[i];
+}
+
+template <class T>
+bool equalScalar(const T * a, const T * b, int n){
+	for(int i=0; i<n; ++i){ if(a[i] != b[i]) return false; }
+	return true;
+}
+
+template <class T>
+void mixScalar(T * dst, const T * const * src, const double * c, int m, int n){
+	for(int i=0; i<n; ++i){
+		double v0 = src[0][i];
+		double r = v0*c[0];
+		bool eq = true;
+		for(int k=1; k<m; ++k){
+			double v = src[k][i];
+			r += v*c[k];
+			eq &= (v == v0);
+		}
+		dst[i] = T(eq ? v0 : r);
+	}
+}
+
+
+#ifdef GLV_SIMD_X86
+
+// SSE2 ___
+
+GLV_TARGET("sse2")
+inline __m128d mixSSE2(const __m128d * v, const __m128d * c, int m){
+	__m128d r = _mm_mul_pd(v[0], c[0]);
+	__m128d eq = _mm_cmpeq_pd(v[0], v[0]);
+	for(int k=1; k<m; ++k){
+		r = _mm_add_pd(r, _mm_mul_pd(v[k], c[k]));
+		eq = _mm_and_pd(eq, _mm_cmpeq_pd(v[k], v[0]));
+	}
+	// v0 == v0 is false for NaN, but then so is the mix
+	return _mm_or_pd(_mm_and_pd(eq, v[0]), _mm_andnot_pd(eq, r));
+}
+
+GLV_TARGET("sse2")
+void mixSSE2(double * dst, const double * const * src, const double * c, int m, int n){
+	__m128d cv[kMaxMix], v[kMaxMix];
+	for(int k=0; k<m; ++k) cv[k] = _mm_set1_pd(c[k]);
+	int i=0;
+	for(; i<=n-2; i+=2){
+		for(int k=0; k<m; ++k) v[k] = _mm_loadu_pd(src[k]+i);
+		_mm_storeu_pd(dst+i, mixSSE2(v, cv, m));
+	}
+	const double * s[kMaxMix];
+	for(int k=0; k<m; ++k) s[k] = src[k]+i;
+	mixScalar(dst+i, s, c, m, n-i);
+}
+
+GLV_TARGET("sse2")
+void mixSSE2(float * dst, const float * const * src, const double * c, int m, int n){
+	__m128d cv[kMaxMix], lo[kMaxMix], hi[kMaxMix];
+	for(int k=0; k<m; ++k) cv[k] = _mm_set1_pd(c[k]);
+	int i=0;
+	for(; i<=n-4; i+=4){
+		for(int k=0; k<m; ++k){
+			__m128 x = _mm_loadu_ps(src[k]+i);
+			lo[k] = _mm_cvtps_pd(x);
+			hi[k] = _mm_cvtps_pd(_mm_movehl_ps(x,x));
+		}
+		__m128 rlo = _mm_cvtpd_ps(mixSSE2(lo, cv, m));
+		__m128 rhi = _mm_cvtpd_ps(mixSSE2(hi, cv, m));
+		_mm_storeu_ps(dst+i, _mm_movelh_ps(rlo, rhi));
+	}
+	const float * s[kMaxMix];
+	for(int k=0; k<m; ++k) s[k] = src[k]+i;
+	mixScalar(dst+i, s, c, m, n-i);
+}
+
+GLV_TARGET("sse2")
+void addSSE2(float * dst, const float * src, int n){
+	int i=0;
+	for(; i<=n-4; i+=4) _mm_storeu_ps(dst+i, _mm_add_ps(_mm_loadu_ps(dst+i), _mm_loadu_ps(src+i)));
+	addScalar(dst+i, src+i, n-i);
+}
+
+GLV_TARGET("sse2")
+void addSSE2(double * dst, const double * src, int n){
+	int i=0;
+	for(; i<=n-2; i+=2) _mm_storeu_pd(dst+i, _mm_add_pd(_mm_loadu_pd(dst+i), _mm_loadu_pd(src+i)));
+	addScalar(dst+i, src+i, n-i);
+}
+
+GLV_TARGET("sse2")
+void addSSE2(int * dst, const int * src, int n){
+	int i=0;
+	for(; i<=n-4; i+=4){
+		__m128i a = _mm_loadu_si128((const __m128i *)(dst+i));
+		__m128i b = _mm_loadu_si128((const __m128i *)(src+i));
+		_mm_storeu_si128((__m128i *)(dst+i), _mm_add_epi32(a,b));
+	}
+	addScalar(dst+i, src+i, n-i);
+}
+
+GLV_TARGET("sse2")
+bool equalSSE2(const float * a, const float * b, int n){
+	int i=0;
+	for(; i<=n-4; i+=4){
+		if(_mm_movemask_ps(_mm_cmpeq_ps(_mm_loadu_ps(a+i), _mm_loadu_ps(b+i))) != 0xf) return false;
+	}
+	return equalScalar(a+i, b+i, n-i);
+}
+
+GLV_TARGET("sse2")
+bool equalSSE2(const double * a, const double * b, int n){
+	int i=0;
+	for(; i<=n-2; i+=2){
+		if(_mm_movemask_pd(_mm_cmpeq_pd(_mm_loadu_pd(a+i), _mm_loadu_pd(b+i))) != 0x3) return false;
+	}
+	return equalScalar(a+i, b+i, n-i);
+}
+
+
+// AVX2 ___
+
+GLV_TARGET("avx2")
+inline __m256d mixAVX2(const __m256d * v, const __m256d * c, int m){
+	__m256d r = _mm256_mul_pd(v[0], c[0]);
+	__m256d eq = _mm256_cmp_pd(v[0], v[0], _CMP_EQ_OQ);
+	for(int k=1; k<m; ++k){
+		r = _mm256_add_pd(r, _mm256_mul_pd(v[k], c[k]));
+		eq = _mm256_and_pd(eq, _mm256_cmp_pd(v[k], v[0], _CMP_EQ_OQ));
+	}
+	return _mm256_blendv_pd(r, v[0], eq);
+}
+
+GLV_TARGET("avx2")
+void mixAVX2(double * dst, const double * const * src, const double * c, int m, int n){
+	__m256d cv[kMaxMix], v[kMaxMix];
+	for(int k=0; k<m; ++k) cv[k] = _mm256_set1_pd(c[k]);
+	int i=0;
+	for(; i<=n-4; i+=4){
+		for(int k=0; k<m; ++k) v[k] = _mm256_loadu_pd(src[k]+i);
+		_mm256_storeu_pd(dst+i, mixAVX2(v, cv, m));
+	}
+	const double * s[kMaxMix];
+	for(int k=0; k<m; ++k) s[k] = src[k]+i;
+	mixScalar(dst+i, s, c, m, n-i);
+}
+
+GLV_TARGET("avx2")
+void mixAVX2(float * dst, const float * const * src, const double * c, int m, int n){
+	__m256d cv[kMaxMix], lo[kMaxMix], hi[kMaxMix];
+	for(int k=0; k<m; ++k) cv[k] = _mm256_set1_pd(c[k]);
+	int i=0;
+	for(; i<=n-8; i+=8){
+		for(int k=0; k<m; ++k){
+			lo[k] = _mm256_cvtps_pd(_mm_loadu_ps(src[k]+i));
+			hi[k] = _mm256_cvtps_pd(_mm_loadu_ps(src[k]+i+4));
+		}
+		_mm_storeu_ps(dst+i  , _mm256_cvtpd_ps(mixAVX2(lo, cv, m)));
+		_mm_storeu_ps(dst+i+4, _mm256_cvtpd_ps(mixAVX2(hi, cv, m)));
+	}
+	const float * s[kMaxMix];
+	for(int k=0; k<m; ++k) s[k] = src[k]+i;
+	mixSSE2(dst+i, s, c, m, n-i);
+}
+
+GLV_TARGET("avx2")
+void addAVX2(float * dst, const float * src, int n){
+	int i=0;
+	for(; i<=n-8; i+=8) _mm256_storeu_ps(dst+i, _mm256_add_ps(_mm256_loadu_ps(dst+i), _mm256_loadu_ps(src+i)));
+	addScalar(dst+i, src+i, n-i);
+}
+
+GLV_TARGET("avx2")
+void addAVX2(double * dst, const double * src, int n){
+	int i=0;
+	for(; i<=n-4; i+=4) _mm256_storeu_pd(dst+i, _mm256_add_pd(_mm256_loadu_pd(dst+i), _mm256_loadu_pd(src+i)));
+	addScalar(dst+i, src+i, n-i);
+}
+
+GLV_TARGET("avx2")
+void addAVX2(int * dst, const int * src, int n){
+	int i=0;
+	for(; i<=n-8; i+=8){
+		__m256i a = _mm256_loadu_si256((const __m256i *)(dst+i));
+		__m256i b = _mm256_loadu_si256((const __m256i *)(src+i));
+		_mm256_storeu_si256((__m256i *)(dst+i), _mm256_add_epi32(a,b));
+	}
+	addScalar(dst+i, src+i, n-i);
+}
+
+GLV_TARGET("avx2")
+bool equalAVX2(const float * a, const float * b, int n){
+	int i=0;
+	for(; i<=n-8; i+=8){
+		__m256 e = _mm256_cmp_ps(_mm256_loadu_ps(a+i), _mm256_loadu_ps(b+i), _CMP_EQ_OQ);
+		if(_mm256_movemask_ps(e) != 0xff) return false;
+	}
+	return equalScalar(a+i, b+i, n-i);
+}
+
+GLV_TARGET("avx2")
+bool equalAVX2(const double * a, const double * b, int n){
+	int i=0;
+	for(; i<=n-4; i+=4){
+		__m256d e = _mm256_cmp_pd(_mm256_loadu_pd(a+i), _mm256_loadu_pd(b+i), _CMP_EQ_OQ);
+		if(_mm256_movemask_pd(e) != 0xf) return false;
+	}
+	return equalScalar(a+i, b+i, n-i);
+}
+
+#endif // GLV_SIMD_X86
+
+
+// Table of kernels for one instruction set
+struct Kernels{
+	void (*addF)(float *, const float *, int);
+	void (*addD)(double *, const double *, int);
+	void (*addI)(int *, const int *, int);
+	bool (*equalF)(const float *, const float *, int);
+	bool (*equalD)(const double *, const double *, int);
+	void (*mixF)(float *, const float * const *, const double *, int, int);
+	void (*mixD)(double *, const double * const *, const double *, int, int);
+	Data::SIMD simd;
+};
+
+Kernels kernelsFor(Data::SIMD s){
+	#ifdef GLV_SIMD_X86
+	__builtin_cpu_init();
+	if(s >= Data::SIMD_AVX2 && __builtin_cpu_supports("avx2")){
+		return { addAVX2, addAVX2, addAVX2, equalAVX2, equalAVX2, mixAVX2, mixAVX2, Data::SIMD_AVX2 };
+	}
+	if(s >= Data::SIMD_SSE2 && __builtin_cpu_supports("sse2")){
+		return { addSSE2, addSSE2, addSSE2, equalSSE2, equalSSE2, mixSSE2, mixSSE2, Data::SIMD_SSE2 };
+	}
+	#endif
+	return {
+		addScalar<float>, addScalar<double>, addScalar<int>,
+		equalScalar<float>, equalScalar<double>,
+		mixScalar<float>, mixScalar<double>, Data::SIMD_NONE
+	};
+}
+
+Kernels& kernels(){
+	static Kernels k = kernelsFor(Data::SIMD_AVX2);
+	return k;
+}
+
+// Returns whether arrays have unit stride and the given type
+inline bool contiguous(const Data& d, Data::Type t){
+	return d.type() == t && (d.stride() == 1 || d.size() <= 1);
+}
+
+} // anonymous::
+
+Data::SIMD Data::simd(){ return kernels().simd; }
+
+Data::SIMD Data::simd(SIMD max){
+	kernels() = kernelsFor(max);
+	return simd();
+}
+
+bool Data::addKernel(Data& dst, const Data& src, int n){
+	const Type t = dst.type();
+	if(!contiguous(src, t) || !contiguous(dst, t)) return false;
+	switch(t){
+	case FLOAT:	kernels().addF(dst.elems<float>(), src.elems<float>(), n); return true;
+	case DOUBLE:kernels().addD(dst.elems<double>(), src.elems<double>(), n); return true;
+	case INT:	kernels().addI(dst.elems<int>(), src.elems<int>(), n); return true;
+	default:	return false;
+	}
+}
+
+bool Data::equalKernel(const Data& a, const Data& b, int n, bool& res){
+	const Type t = a.type();
+	if(!contiguous(a, t) || !contiguous(b, t)) return false;
+	switch(t){
+	case FLOAT:	res = kernels().equalF(a.elems<float>(), b.elems<float>(), n); return true;
+	case DOUBLE:res = kernels().equalD(a.elems<double>(), b.elems<double>(), n); return true;
+	case INT:	res = 0 == memcmp(a.elems<int>(), b.elems<int>(), n*sizeof(int)); return true;
+	default:	return false;
+	}
+}
+
+bool Data::mixKernel(Data& dst, const Data * const * src, const double * c, int m, int n){
+	const Type t = dst.type();
+	if(m < 1 || m > kMaxMix || !contiguous(dst, t)) return false;
+	for(int k=0; k<m; ++k){ if(!contiguous(*src[k], t)) return false; }
+	switch(t){
+	case FLOAT:{
+		const float * s[kMaxMix];
+		for(int k=0; k<m; ++k) s[k] = src[k]->elems<float>();
+		kernels().mixF(dst.elems<float>(), s, c, m, n);
+		} return true;
+	case DOUBLE:{
+		const double * s[kMaxMix];
+		for(int k=0; k<m; ++k) s[k] = src[k]->elems<double>();
+		kernels().mixD(dst.elems<double>(), s, c, m, n);
+		} return true;
+	default: return false;
+	}
+}
+
+
 //#define PDEBUG printf("%p %s\t", this, __func__); print(); printf("\n")
 #define PDEBUG
 /*
+	Block * mBlock;				// header of owned elements or 0 if external
 	pointer mData;				// pointer to first element of source data
 	pointer mElems;				// pointer to first element in this slice
 	int mStride;				// stride factor
@@ -223,22 +554,22 @@ static inline int count(const Data& a, const Data& b){
 */
 
 Data::Data()
-:	mData(0), mElems(0), mStride(1), mType(Data::NONE)
+:	mBlock(0), mData(0), mElems(0), mStride(1), mType(Data::NONE)
 {
 	shapeAll(0);
 	PDEBUG;
 }
 
 Data::Data(Data& v)
-:	mData(0), mElems(0), mStride(1), mType(Data::NONE)
+:	mBlock(0), mData(0), mElems(0), mStride(1), mType(Data::NONE)
 { shapeAll(0); *this = v; PDEBUG; }
 
 Data::Data(const Data& v)
-:	mData(0), mElems(0), mStride(1), mType(Data::NONE)
+:	mBlock(0), mData(0), mElems(0), mStride(1), mType(Data::NONE)
 { shapeAll(0); *this = v; PDEBUG; }
 
 Data::Data(Data::Type type, int n1, int n2, int n3, int n4)
-:	mData(0), mElems(0), mStride(1), mType(type)
+:	mBlock(0), mData(0), mElems(0), mStride(1), mType(type)
 {
 	int s[] = {n1,n2,n3,n4};
 	shape(s,4);
@@ -253,7 +584,7 @@ Data::~Data(){
 
 Data& Data::operator= (const Data& v){
 	if(&v != this){
-		setRaw(v.mData, v.offset(), v.stride(), v.type());
+		setRaw(v.mData, v.mBlock, v.offset(), v.stride(), v.type());
 		for(int i=0;i<maxDim();++i) mSizes[i]=v.mSizes[i];
 	}
 	return *this;
@@ -261,6 +592,9 @@ Data& Data::operator= (const Data& v){
 
 bool Data::operator==(const Data& v) const {
 	if(hasData() && v.hasData()){
+		bool res;
+		if(equalKernel(*this, v, count(*this,v), res)) return res;
+
 		// TODO: how do we compare numbers and strings?
 
 		#define OP(t1, t2)\
@@ -292,6 +626,7 @@ bool Data::operator==(const Data& v) const {
 }
 
 Data& Data::operator+=(const Data& v){
+	if(hasData() && v.hasData() && addKernel(*this, v, count(*this,v))) return *this;
 
 	#define OP(t1, t2)\
 	for(int i=0; i<count(*this,v); ++i){ elem<t1>(i) += v.elem<t2>(i); } break
@@ -329,6 +664,11 @@ Data& Data::assign(const Data& v, int idx){
 		int nd= size()-idx;				// number of destination elements to assign
 		int n = nd < v.size() ? nd : v.size();
 
+		if(type() == v.type() && isNumerical() && contiguous(*this, type()) && contiguous(v, type())){
+			if(n > 0) memmove(elems<char>() + idx*sizeType(), v.elems<char>(), n*sizeType());
+			return *this;
+		}
+
 		#define OP(t1, t2)\
 		for(int i=0; i<n; ++i){ elem<t1>(i+idx) = v.elem<t2>(i); } break
 
@@ -421,17 +761,8 @@ bool Data::isZero() const{
 
 void Data::clear(){
 PDEBUG;
-	if(release(mData)){
-		switch(type()){
-		case Data::BOOL:	delete[] data<bool>(); break;
-		case Data::INT:		delete[] data<int>(); break;
-		case Data::FLOAT:	delete[] data<float>(); break;
-		case Data::DOUBLE:	delete[] data<double>(); break;
-		case Data::STRING:	delete[] data<std::string>(); break;
-		default:;
-		}
-//		::free(mData);
-	}
+	if(mBlock) releaseBlock(mBlock);
+	mBlock=0;
 	mData=0;
 	mElems=0;
 	mStride=1;
@@ -442,13 +773,14 @@ PDEBUG;
 
 void Data::clone(){
 	if(hasData()){
-		int cnt = references(mData);
+		int cnt = references();
 		
 		// cnt == 0		data points to external, unmanaged data
 		// cnt  > 1		data points to another Data's cloned data
 		// cnt == 1		data points to my own cloned data
-		// allocate new memory if not sole owner of data
-		if(cnt!=1){
+		// allocate new memory if not sole owner of data or if data is
+		// in foreign memory, e.g., a mapped file
+		if(cnt!=1 || mBlock->free){
 			Data old(*this);
 			realloc(type());
 			assign(old);
@@ -502,15 +834,9 @@ int Data::realloc(Data::Type t, const int * sizes, int n){
 	if(size()){
 		mType  = t;
 		mStride= 1;
-		switch(type()){
-		case Data::BOOL:	mData = pointer(new bool[size()]); break;
-		case Data::INT:		mData = pointer(new int[size()]); break;
-		case Data::FLOAT:	mData = pointer(new float[size()]); break;
-		case Data::DOUBLE:	mData = pointer(new double[size()]); break;
-		case Data::STRING:	mData = pointer(new std::string[size()]); break;
-		default:			goto end;
-		}
-		acquire(mData);
+		mBlock = allocBlock(type(), size());
+		if(!mBlock) goto end;
+		mData = blockElems(mBlock);
 		offset(0);
 //		if(hasData() && isNumerical()) assignAll(0); // REV0
 
@@ -572,16 +898,66 @@ PDEBUG;
 	return numBytes;
 }
 
-void Data::setRaw(void * dt, int off, int stride, Type ty){
-	// increment reference count first to avoid problems when dt == mData
-	incrementCount(pointer(dt));
+void Data::setRaw(void * dt, Block * b, int off, int stride, Type ty){
+	// increment reference count first to avoid problems when b == mBlock
+	if(b) b->refs.fetch_add(1, std::memory_order_relaxed);
 	clear();
+	mBlock = b;
 	mData  = pointer(dt);
 	mStride= stride;
 	mType  = ty;
 	offset(off);
 }
 
+Data::Block * Data::allocBlock(Type t, int n){
+	int bytes;
+	switch(t){
+	case Data::BOOL:	bytes = sizeof(bool); break;
+	case Data::INT:		bytes = sizeof(int); break;
+	case Data::FLOAT:	bytes = sizeof(float); break;
+	case Data::DOUBLE:	bytes = sizeof(double); break;
+	case Data::STRING:	bytes = sizeof(std::string); break;
+	default:			return 0;
+	}
+	Block * b = new (::operator new(blockHeaderBytes() + n*bytes)) Block;
+	b->refs.store(1, std::memory_order_relaxed);
+	b->type = t;
+	b->size = n;
+	b->free = 0;
+	if(Data::STRING == t){
+		std::string * s = (std::string *)blockElems(b);
+		for(int i=0; i<n; ++i) new (s+i) std::string;
+	}
+	return b;
+}
+
+void Data::releaseBlock(Block * b){
+	if(b->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+	if(b->free){ b->free(b); return; }
+	if(Data::STRING == b->type){
+		std::string * s = (std::string *)blockElems(b);
+		for(int i=0; i<b->size; ++i) s[i].~basic_string();
+	}
+	b->~Block();
+	::operator delete(b);
+}
+
+// Elements follow the header, padded so that they are suitably aligned
+int Data::blockHeaderBytes(){
+	static const int A = alignof(std::max_align_t);
+	return (sizeof(Block) + A-1)/A*A;
+}
+
+Data::pointer Data::blockElems(Block * b){
+	return pointer(b) + blockHeaderBytes();
+}
+
+int Data::references(const void * elems){
+	if(!elems) return 0;
+	const Block * b = (const Block *)((const char *)elems - blockHeaderBytes());
+	return b->refs.load(std::memory_order_relaxed);
+}
+
 // TODO: conform sizes to current size
 Data& Data::shape(const int * sizes, int n){
 	if(n){
@@ -696,6 +1072,14 @@ bool ModelManager::defaultFilePath(std::string& s) const {
 	return false;
 }
 
+bool ModelManager::defaultBinaryFilePath(std::string& s) const {
+	if(!defaultFilePath(s)) return false;
+	auto dot = s.find_last_of("./");
+	if(std::string::npos != dot && '.' == s[dot]) s.erase(dot);
+	s += ".glvs";
+	return true;
+}
+
 ModelManager& ModelManager::filePath(const std::string& name, const std::string& dir){
 	mFileName=name;
 	return fileDir(dir);
@@ -771,6 +1155,344 @@ void ModelManager::printSnapshots() const {
 //};
 
 
+// Binary snapshot files
+//
+// All numbers are little-endian.
+//
+// Header	"GLVSNAP\0", u32 version, u32 number of snapshots, u64 file size
+// Index	for each snapshot:	str name, u32 number of entries
+//			for each entry:		str name, u32 type, i32 sizes[4], u64 offset
+// Arrays	elements of each entry at 'offset' bytes from the start of the file,
+//			aligned to 16 bytes; bools are u8, strings are str
+//
+// str		u32 length followed by characters without terminator
+
+namespace{
+
+const char kSnapMagic[8] = {'G','L','V','S','N','A','P','\0'};
+const uint32_t kSnapVersion = 1;
+const int kSnapAlign = 16;
+const int kSnapHeaderBytes = 8+4+4+8;
+const int kSnapDims = 4;
+
+bool littleEndian(){
+	const int one = 1;
+	return *(const char *)&one;
+}
+
+template <class T>
+void putLE(std::string& dst, T v){
+	char c[sizeof(T)];
+	memcpy(c, &v, sizeof(T));
+	if(littleEndian()) dst.append(c, sizeof(T));
+	else for(int i=sizeof(T)-1; i>=0; --i) dst += c[i];
+}
+
+template <class T>
+T getLE(const char * src){
+	char c[sizeof(T)];
+	if(littleEndian()) memcpy(c, src, sizeof(T));
+	else for(unsigned i=0; i<sizeof(T); ++i) c[i] = src[sizeof(T)-1-i];
+	T v;
+	memcpy(&v, c, sizeof(T));
+	return v;
+}
+
+void putStr(std::string& dst, const std::string& v){
+	putLE<uint32_t>(dst, v.size());
+	dst += v;
+}
+
+// Write elements as stored type S
+template <class T, class S>
+void putElems(std::string& dst, const Data& d){
+	if(littleEndian() && sizeof(T) == sizeof(S) && (d.stride() == 1 || d.size() <= 1)){
+		dst.append((const char *)d.elems<T>(), d.size()*sizeof(T));
+	}
+	else{
+		for(int i=0; i<d.size(); ++i) putLE<S>(dst, S(d.elem<T>(i)));
+	}
+}
+
+// Bounds-checked reader of file contents
+struct SnapReader{
+	const char * bytes;
+	uint64_t size, pos;
+	bool ok;
+
+	SnapReader(const char * b, uint64_t s): bytes(b), size(s), pos(0), ok(true){}
+
+	bool has(uint64_t n){ return ok = ok && n <= size-pos; }
+
+	template <class T>
+	T get(){
+		if(!has(sizeof(T))) return T(0);
+		T v = getLE<T>(bytes+pos);
+		pos += sizeof(T);
+		return v;
+	}
+
+	std::string str(){
+		uint32_t n = get<uint32_t>();
+		if(!has(n)) return "";
+		pos += n;
+		return std::string(bytes+pos-n, n);
+	}
+
+	// Skip strings, checking that each one lies within the file
+	bool skipStrs(uint64_t count){
+		for(uint64_t i=0; i<count && ok; ++i){
+			uint32_t n = get<uint32_t>();
+			if(has(n)) pos += n;
+		}
+		return ok;
+	}
+};
+
+// Decode elements stored as type S
+template <class T, class S>
+void getElems(Data& d, const char * src){
+	T * e = d.elems<T>();
+	for(int i=0; i<d.size(); ++i) e[i] = T(getLE<S>(src + i*sizeof(S)));
+}
+
+} // anonymous::
+
+
+Data::Block * Data::mapFile(const char * path, const char *& bytes, size_t& size){
+	struct FileBlock : public Block{
+		void * addr;
+		size_t len;
+		bool mapped;
+	};
+
+	FileBlock * b = new FileBlock;
+	b->refs.store(1, std::memory_order_relaxed);
+	b->type = NONE;
+	b->size = 0;
+	b->addr = 0;
+	b->len = 0;
+	b->mapped = false;
+	b->free = [](Block * blk){
+		FileBlock * f = static_cast<FileBlock *>(blk);
+		#ifndef GLV_PLATFORM_WIN
+		if(f->mapped) munmap(f->addr, f->len);
+		else
+		#endif
+		::operator delete(f->addr);
+		delete f;
+	};
+
+	#ifndef GLV_PLATFORM_WIN
+	// Pages are mapped private and writable so that modifying elements
+	// in place copies the touched pages rather than changing the file.
+	int fd = open(path, O_RDONLY);
+	if(fd >= 0){
+		struct stat st;
+		if(0 == fstat(fd, &st) && st.st_size > 0){
+			void * a = mmap(0, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+			if(MAP_FAILED != a){
+				b->addr = a;
+				b->len = st.st_size;
+				b->mapped = true;
+			}
+		}
+		close(fd);
+	}
+	#endif
+
+	if(!b->mapped){
+		FILE * fp = fopen(path, "rb");
+		if(fp){
+			fseek(fp, 0, SEEK_END);
+			long n = ftell(fp);
+			fseek(fp, 0, SEEK_SET);
+			if(n > 0){
+				b->addr = ::operator new(n);
+				b->len = fread(b->addr, 1, n, fp);
+			}
+			fclose(fp);
+		}
+	}
+
+	if(!b->len){
+		releaseBlock(b);
+		return 0;
+	}
+	bytes = (const char *)b->addr;
+	size = b->len;
+	return b;
+}
+
+
+int ModelManager::snapshotsToBinaryFile(const std::string& path_in) const {
+	std::string path = path_in;
+	if(path.empty()){
+		if(!defaultBinaryFilePath(path)) return 0;
+	}
+
+	// Arrays start after the index, so its size is needed first
+	uint64_t indexBytes = 0;
+	for(const auto& ss : mSnapshots){
+		indexBytes += 4 + ss.first.size() + 4;
+		for(const auto& e : ss.second) indexBytes += 4 + e.first.size() + 4 + 4*kSnapDims + 8;
+	}
+	const uint64_t arraysBeg = (kSnapHeaderBytes + indexBytes + kSnapAlign-1)/kSnapAlign*kSnapAlign;
+
+	std::string index, arrays;
+	index.reserve(arraysBeg);
+
+	for(const auto& ss : mSnapshots){
+		putStr(index, ss.first);
+		putLE<uint32_t>(index, ss.second.size());
+
+		for(const auto& e : ss.second){
+			const Data& d = e.second;
+			arrays.resize((arrays.size() + kSnapAlign-1)/kSnapAlign*kSnapAlign, '\0');
+
+			putStr(index, e.first);
+			putLE<uint32_t>(index, d.type());
+			for(int i=0; i<kSnapDims; ++i) putLE<int32_t>(index, d.hasData() ? d.size(i) : 0);
+			putLE<uint64_t>(index, arraysBeg + arrays.size());
+
+			if(!d.hasData()) continue;
+			switch(d.type()){
+			case Data::BOOL:	putElems<bool, uint8_t>(arrays, d); break;
+			case Data::INT:		putElems<int, int32_t>(arrays, d); break;
+			case Data::FLOAT:	putElems<float, float>(arrays, d); break;
+			case Data::DOUBLE:	putElems<double, double>(arrays, d); break;
+			case Data::STRING:
+				for(int i=0; i<d.size(); ++i) putStr(arrays, d.elem<std::string>(i));
+				break;
+			default:;
+			}
+		}
+	}
+
+	std::string header(kSnapMagic, sizeof(kSnapMagic));
+	putLE<uint32_t>(header, kSnapVersion);
+	putLE<uint32_t>(header, mSnapshots.size());
+	putLE<uint64_t>(header, arraysBeg + arrays.size());
+	index.insert(0, header);
+	index.resize(arraysBeg, '\0');
+
+	int r=0;
+	FILE * fp = fopen(path.c_str(), "wb");
+	if(fp){
+		r  = fwrite(index.data(), 1, index.size(), fp);
+		r += fwrite(arrays.data(), 1, arrays.size(), fp);
+		fclose(fp);
+	}
+	return r;
+}
+
+
+int ModelManager::snapshotsFromBinaryFile(const std::string& path_in, bool add){
+	std::string path = path_in;
+	if(path.empty()){
+		if(!defaultBinaryFilePath(path)) return 0;
+	}
+
+	const char * bytes;
+	size_t size;
+	Data::Block * file = Data::mapFile(path.c_str(), bytes, size);
+	if(!file) return 0;
+
+	SnapReader rd(bytes, size);
+	Snapshots snapshots;
+
+	// Elements can be referenced in place if they are stored as in memory
+	const bool inPlace = littleEndian() && sizeof(int) == 4;
+
+	if(rd.has(kSnapHeaderBytes) && 0 == memcmp(bytes, kSnapMagic, sizeof(kSnapMagic))){
+		rd.pos = sizeof(kSnapMagic);
+		uint32_t version = rd.get<uint32_t>();
+		uint32_t numSnapshots = rd.get<uint32_t>();
+		rd.ok &= (version <= kSnapVersion) && (rd.get<uint64_t>() == size);
+
+		for(uint32_t j=0; j<numSnapshots && rd.ok; ++j){
+			Snapshot& snapshot = snapshots[rd.str()];
+			uint32_t numEntries = rd.get<uint32_t>();
+
+			for(uint32_t k=0; k<numEntries && rd.ok; ++k){
+				std::string name = rd.str();
+				Data::Type type = Data::Type(rd.get<uint32_t>());
+				int sizes[kSnapDims];
+				uint64_t n = 1;
+				for(int i=0; i<kSnapDims; ++i){
+					sizes[i] = rd.get<int32_t>();
+					rd.ok &= sizes[i] >= 0;
+					n *= rd.ok ? sizes[i] : 0;
+					rd.ok &= n <= 0x7fffffff;
+				}
+				uint64_t offset = rd.get<uint64_t>();
+				if(!rd.ok || type > Data::STRING){ rd.ok = false; break; }
+
+				Data& d = snapshot[name];
+				if(0 == n){
+					d = Data(type, sizes[0], sizes[1], sizes[2], sizes[3]);
+					continue;
+				}
+
+				int bytesPer = 0;
+				switch(type){
+				case Data::BOOL:	bytesPer = 1; break;
+				case Data::INT:		bytesPer = 4; break;
+				case Data::FLOAT:	bytesPer = 4; break;
+				case Data::DOUBLE:	bytesPer = 8; break;
+				default:;
+				}
+
+				if(bytesPer){
+					if(offset > size || n*bytesPer > size-offset){ rd.ok = false; break; }
+					const char * src = bytes + offset;
+
+					if(inPlace && Data::BOOL != type && 0 == offset % kSnapAlign){
+						d.setRaw(const_cast<char *>(src), file, 0, 1, type);
+						d.shape(sizes, kSnapDims);
+						continue;
+					}
+
+					d = Data(type, sizes[0], sizes[1], sizes[2], sizes[3]);
+					switch(type){
+					case Data::BOOL:	getElems<bool, uint8_t>(d, src); break;
+					case Data::INT:		getElems<int, int32_t>(d, src); break;
+					case Data::FLOAT:	getElems<float, float>(d, src); break;
+					case Data::DOUBLE:	getElems<double, double>(d, src); break;
+					default:;
+					}
+				}
+				else{ // strings, each with a 4-byte length prefix
+					if(offset > size || n*4 > size-offset){ rd.ok = false; break; }
+					SnapReader sr(bytes, size);
+					sr.pos = offset;
+					if(!sr.skipStrs(n)){ rd.ok = false; break; }
+					sr.pos = offset;
+					d = Data(type, sizes[0], sizes[1], sizes[2], sizes[3]);
+					std::string * e = d.elems<std::string>();
+					for(int i=0; i<d.size() && sr.ok; ++i) e[i] = sr.str();
+					rd.ok &= sr.ok;
+				}
+			}
+		}
+	}
+	else{
+		rd.ok = false;
+	}
+
+	Data::releaseBlock(file);
+	if(!rd.ok) return 0;
+
+	if(!add) mSnapshots.swap(snapshots);
+	else{
+		for(auto& ss : snapshots){
+			for(auto& e : ss.second) mSnapshots[ss.first][e.first] = e.second;
+		}
+	}
+	return size;
+}
+
+
 int ModelManager::snapshotsToFile(const std::string& path_in) const {
 	std::string s;
 	if(!snapshotsToString(s)) return 0;
@@ -798,7 +1520,16 @@ int ModelManager::snapshotsFromFile(const std::string& path_in, bool add){
 	int r=0;
 	FILE * fp = fopen(path.c_str(), "r");
 	if(fp){
-		
+
+		char magic[sizeof(kSnapMagic)];
+		if(fread(magic, 1, sizeof(magic), fp) == sizeof(magic)
+			&& 0 == memcmp(magic, kSnapMagic, sizeof(magic))
+		){
+			fclose(fp);
+			return snapshotsFromBinaryFile(path, add);
+		}
+		rewind(fp);
+
 		char buf[512];
 		std::string s;
 		while(!feof(fp)){
@@ -1080,6 +1811,25 @@ void ModelManager::saveSnapshot(const std::string& name){
 }
 
 
+unsigned long long ModelManager::stateHash() const {
+	// 64-bit FNV-1a
+	unsigned long long h = 14695981039346656037ULL;
+	auto add = [&h](const std::string& s){
+		for(unsigned char c : s){ h ^= c; h *= 1099511628211ULL; }
+		h ^= 0xff; h *= 1099511628211ULL; // terminator so that "ab","c" != "a","bc"
+	};
+	for(const auto& it : mState){
+		Data temp;
+		add(it.first); add(toString(it.second->getData(temp)));
+	}
+	for(const auto& it : mConstState){
+		Data temp;
+		add(it.first); add(toString(it.second->getData(temp)));
+	}
+	return h;
+}
+
+
 bool ModelManager::loadSnapshot(int i){
 	for(auto& ss : mSnapshots){
 		if(i-- == 0) return loadSnapshot(ss.first);
@@ -9,8 +9,6 @@ Notifier::Notifier()
 :	mHandlers(0)
 {}
 
-// Non-virtual unless someone will delete a derived-class object via
-// a Notifier pointer...
 Notifier::~Notifier(){ delete[] mHandlers; }
 
 void Notifier::attach(Callback cb, Update::t n, void * rcvr){
@@ -34,6 +32,8 @@ void Notifier::detach(Callback cb, Update::t n, void * rcvr){
 
 void Notifier::notify(void * sender, Update::t n, void * data){
 
+	onNotify(sender, n, data);
+
 	if(!hasHandlers() || handlers()[n].empty()) return;
 
 	// call handlers in FIFO order
@@ -2,7 +2,13 @@
 	See COPYRIGHT file for authors and license information */
 
 #include <float.h>
+#include <limits.h>
 #include <string.h>
+#include <cmath>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
 #include "glv_util.h"
 #include "glv_plots.h"
 
@@ -58,13 +64,15 @@ Surface x	(1, 1, n, m)	((v11, v21, v31), (v12, v22, v32))
 */
 
 Plottable::Plottable(const Plottable& src){
+	mVisiblePixels[0] = mVisiblePixels[1] = 0;
 	*this = src;
 }
 
 Plottable::Plottable(int prim, float stroke)
 :	mPrim(prim), mStroke(stroke), mBlendMode(TRANSLUCENT), mLineStipple(-1),
-	mDrawUnder(false), mUseStyleColor(true), mActive(true)
+	mDrawUnder(false), mUseStyleColor(true), mActive(true), mConcurrentMap(true)
 {
+	mVisiblePixels[0] = mVisiblePixels[1] = 0;
 	updateRegion(0,0,-1,-1);
 	add(*this);
 }
@@ -119,20 +127,11 @@ Plottable& Plottable::updateRegion(int x, int y, int w, int h){
 
 void Plottable::doPlot(GraphicsData& gd, const Data& d){
 	if(!d.hasData() || !active()) return;
-	draw::color(color());
-	draw::stroke(stroke());
-	glHint(GL_LINE_SMOOTH_HINT, GL_NICEST);
-//	glHint(GL_LINE_SMOOTH_HINT, GL_FASTEST);
-	draw::enable(draw::PointSmooth);
-	draw::enable(draw::LineSmooth);
-
-	bool doLineStipple = (-1 != mLineStipple);
-
-	if(doLineStipple){
-		draw::lineStipple(1, mLineStipple);
-		draw::lineStippling(true);
-	}
+	doMap(gd, d);
+	doDraw(gd, d);
+}
 
+void Plottable::doMap(GraphicsData& gd, const Data& d){
 	int ux = mUpdateRegion[0];
 	int uy = mUpdateRegion[1];
 	int uw = mUpdateRegion[2];
@@ -150,24 +149,40 @@ void Plottable::doPlot(GraphicsData& gd, const Data& d){
 		ind.reset();
 		gmap->onMap(gd, d, ind);
 	}
+}
+
+void Plottable::doDraw(GraphicsData& gd, const Data& d){
+	draw::color(color());
+	draw::stroke(stroke());
+	if(!draw::Backend::current()) glHint(GL_LINE_SMOOTH_HINT, GL_NICEST);
+//	glHint(GL_LINE_SMOOTH_HINT, GL_FASTEST);
+	draw::enable(draw::PointSmooth);
+	draw::enable(draw::LineSmooth);
+
+	bool doLineStipple = (-1 != mLineStipple);
+
+	if(doLineStipple){
+		draw::lineStipple(1, mLineStipple);
+		draw::lineStippling(true);
+	}
 
 	switch(mBlendMode){
 		case TRANSLUCENT: break;
 		case ADDITIVE:
-			glBlendEquation(GL_FUNC_ADD);
-			glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+			draw::blendEquation(GL_FUNC_ADD);
+			draw::blendFunc(GL_SRC_ALPHA, GL_ONE);
 			break;
 		case SUBTRACTIVE:
-			glBlendEquation(GL_FUNC_REVERSE_SUBTRACT);
-			glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+			draw::blendEquation(GL_FUNC_REVERSE_SUBTRACT);
+			draw::blendFunc(GL_SRC_ALPHA, GL_ONE);
 			break;
 		case SCREEN:
-			glBlendEquation(GL_FUNC_ADD);
-			glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_COLOR);
+			draw::blendEquation(GL_FUNC_ADD);
+			draw::blendFunc(GL_ONE, GL_ONE_MINUS_SRC_COLOR);
 			break;
 		case MULTIPLICATIVE:
-			glBlendEquation(GL_FUNC_ADD);
-			glBlendFunc(GL_DST_COLOR, GL_ZERO);
+			draw::blendEquation(GL_FUNC_ADD);
+			draw::blendFunc(GL_DST_COLOR, GL_ZERO);
 			break;
 		default:;
 	}
@@ -192,11 +207,16 @@ void Plottable::doPlot(GraphicsData& gd, const Data& d){
 
 
 PlotDensity::PlotDensity(const Color& c, float hueSpread, int ipol)
-:	Plottable(draw::Triangles, 1, c), mTex(0,0, GL_RGBA, GL_FLOAT),
-	mHueSpread(hueSpread), mIpol(ipol)
+:	Plottable(draw::Triangles, 1, c), mTex(0,0, GL_RGBA, GL_UNSIGNED_BYTE),
+	mHueSpread(hueSpread), mIpol(ipol),
+	mMapHueSpread(0), mMappedElems(0), mMappedType(0), mMappedStride(0),
+	mHinting(false)
 {
 	mRegion[0].endpoints(-1, 1);
 	mRegion[1].endpoints(-1, 1);
+	mTexSize[0] = mTexSize[1] = 0;
+	mHint[0] = mHint[1] = mHint[2] = mHint[3] = 0;
+	mUpload[0] = mUpload[1] = mUpload[2] = mUpload[3] = 0;
 //	add(defaultColorMap());
 }
 
@@ -204,52 +224,126 @@ PlotDensity& PlotDensity::plotRegion(const Interval<double>& vx, const Interval<
 	mRegion[0] = vx; mRegion[1] = vy; return *this;
 }
 
+// Merge rectangle x0,y0,x1,y1 into another, which is empty if x0>=x1
+static void mergeRect(int * dst, int x0, int y0, int x1, int y1){
+	if(x0 >= x1 || y0 >= y1) return;
+	if(dst[0] >= dst[2]){
+		dst[0]=x0; dst[1]=y0; dst[2]=x1; dst[3]=y1;
+	}
+	else{
+		dst[0] = glv::min(dst[0],x0); dst[1] = glv::min(dst[1],y0);
+		dst[2] = glv::max(dst[2],x1); dst[3] = glv::max(dst[3],y1);
+	}
+}
+
 PlotDensity& PlotDensity::updateRegion(int x, int y, int w, int h){
-	Plottable::updateRegion(x,y,w,h);
-	mTex.updateRegion(x,y,w,h);
+	if(w < 0 || h < 0){
+		mHinting = false;
+		mHint[0] = mHint[2] = 0;
+		Plottable::updateRegion(x,y,w,h);
+	}
+	else{
+		mHinting = true;
+		mergeRect(mHint, x, y, x+w, y+h);
+		Plottable::updateRegion(mHint[0], mHint[1], mHint[2]-mHint[0], mHint[3]-mHint[1]);
+	}
 	return *this;
 }
 
 void PlotDensity::onMap(GraphicsData& gd, const Data& d, const Indexer& i){
 
-	int N0 = d.size(0);	// number of "internal" dimensions
+	const int N0 = d.size(0);	// number of "internal" dimensions
+	const int W = d.size(1), H = d.size(2);
+	const Color& col = gd.colors()[0];
+	bool all = false;
+
+	// colormap of values in [-1,1] for single component data
+	if(mColorMap.empty() || mHueSpread != mMapHueSpread
+		|| col.r != mMapColor.r || col.g != mMapColor.g || col.b != mMapColor.b || col.a != mMapColor.a
+	){
+		HSV hsv = col;
+		Color col1 = HSV(hsv).rotateHue( mHueSpread);
+		Color col2 = HSV(hsv).rotateHue(-mHueSpread);
+		mColorMap.resize(1024);
+		for(unsigned k=0; k<mColorMap.size(); ++k){
+			float w0 = k*2.f/(mColorMap.size()-1) - 1.f;
+			Color c((w0 > 0 ? col1*w0 : col2*-w0), col.a);
+			mColorMap[k] = c;
+		}
+
+		// Each channel of HSV(h,s,v) is v*(1 - s*f) where f only depends on h
+		Color full = HSV(hsv.h, 1, 1);
+		mHueFactors[0] = 1.f - full.r;
+		mHueFactors[1] = 1.f - full.g;
+		mHueFactors[2] = 1.f - full.b;
 
-	Color col = gd.colors()[0];
-	HSV hsv = col;
+		mMapColor = col;
+		mMapHueSpread = mHueSpread;
+		all = true;
+	}
 
-	Color col1 = HSV(hsv).rotateHue( mHueSpread);
-	Color col2 = HSV(hsv).rotateHue(-mHueSpread);
+	if(W != mTexSize[0] || H != mTexSize[1]){
+		mTexSize[0] = W; mTexSize[1] = H;
+		mTexels.assign(W*H, Color8(0,0,0,0));
+		all = true;
+	}
 
-	switch(N0){
-	case 1:
-		while(i()){
-			float w0 = d.at<float>(0,i[0],i[1],i[2]);
+	if(d.elems<char>() != mMappedElems || int(d.type()) != mMappedType || d.stride() != mMappedStride){
+		mMappedElems = d.elems<char>();
+		mMappedType = d.type();
+		mMappedStride = d.stride();
+		all = true;
+	}
 
-			Color c((w0 > 0 ? col1*w0 : col2*-w0), col.a);
-			
-			//Color c(col * w0, col.a);			
-			gd.addColor(c);
-		}
-		break;
+	if(!all && mHinting && mHint[0] >= mHint[2]) return;
+
+	int sizes[] = {W, H, d.size(3)};
+	Indexer iall(sizes);
+	const Indexer& ind = all ? iall : i;
+	const float hs = HSV(col).s, hv = HSV(col).v;
+	int x0=W, y0=H, x1=0, y1=0;
+
+	// resolve element type once for all samples
+	d.visit([&](auto v){
+		while(ind()){
+			int ix = ind[0], iy = ind[1];
+			if(ix < 0 || ix >= W || iy < 0 || iy >= H) continue;
+			Color8& t = mTexels[iy*W + ix];
+
+			switch(N0){
+			case 1:{
+				float w0 = v(0,ix,iy,ind[2]);
+				w0 = w0 < -1.f ? -1.f : (w0 > 1.f ? 1.f : (w0 == w0 ? w0 : 0.f));
+				t = mColorMap[int((w0 + 1.f) * 0.5f * (mColorMap.size()-1) + 0.5f)];
+				}
+				break;
+
+			case 2:{
+				float val = hv * v(0,ix,iy,ind[2]);
+				float sat = hs * v(1,ix,iy,ind[2]);
+				t.r = Color8::component(val * (1.f - sat*mHueFactors[0]));
+				t.g = Color8::component(val * (1.f - sat*mHueFactors[1]));
+				t.b = Color8::component(val * (1.f - sat*mHueFactors[2]));
+				t.a = 255;
+				}
+				break;
 
-	case 2:
-		while(i()){
-			float w0 = d.at<float>(0,i[0],i[1],i[2]);
-			float w1 = d.at<float>(1,i[0],i[1],i[2]);
-			Color c = HSV(hsv.h, hsv.s*w1, hsv.v*w0);
-			gd.addColor(c);
-		}
-		break;
+			default:
+				t.r = Color8::component(v(0,ix,iy,ind[2]));
+				t.g = Color8::component(v(1,ix,iy,ind[2]));
+				t.b = Color8::component(v(2,ix,iy,ind[2]));
+				t.a = 255;
+			}
 
-	default:
-		while(i()){
-			float w0 = d.at<float>(0,i[0],i[1],i[2]);
-			float w1 = d.at<float>(1,i[0],i[1],i[2]);
-			float w2 = d.at<float>(2,i[0],i[1],i[2]);
-			Color c = Color(w0, w1, w2);
-			gd.addColor(c);
+			if(ix < x0) x0 = ix;
+			if(ix >= x1) x1 = ix+1;
+			if(iy < y0) y0 = iy;
+			if(iy >= y1) y1 = iy+1;
 		}
-	}
+	});
+
+	mergeRect(mUpload, x0, y0, x1, y1);
+	mHint[0] = mHint[2] = 0;
 }
 
 void PlotDensity::onContextCreate(){
@@ -271,15 +365,36 @@ void PlotDensity::onContextDestroy(){
 //			double a = atan2(w1,w0)/(-2*M_PI); if(a<0) a=1+a;
 //			Color c = HSV(a, 1, m);
 
+bool PlotDensity::texelsFromColors(const GraphicsData& b, const Data& d){
+	const int W = d.size(1), H = d.size(2);
+	if(W*H <= 0 || b.colors().size() < W*H) return false;
+
+	if(W != mTexSize[0] || H != mTexSize[1]){
+		mTexSize[0] = W; mTexSize[1] = H;
+		mTexels.resize(W*H);
+	}
+	toColor8(&mTexels[0], &b.colors()[0], W*H);
+	mergeRect(mUpload, 0, 0, W, H);
+	mMappedElems = 0; // color all texels again once the colors are gone
+	return true;
+}
+
 void PlotDensity::onDraw(GraphicsData& b, const Data& d){
-	// (re)creates texture on GPU only when size changes
-	mTex.create(d.size(1), d.size(2), NULL);
+	texelsFromColors(b, d);
+	if(mTexels.empty()) return;
+
+	// (re)creates texture on GPU from all texels only when size changes
+	mTex.create(mTexSize[0], mTexSize[1], &mTexels[0]);
 
 	mTex.magFilter(mIpol ? GL_LINEAR : GL_NEAREST);
 	draw::enable(draw::Texture2D);
 	draw::color(1,1,1,1);
 	mTex.begin();
-	mTex.send(&b.colors()[0]);
+	if(mUpload[0] < mUpload[2] && !draw::Backend::current()){
+		mTex.updateRegion(mUpload[0], mUpload[1], mUpload[2]-mUpload[0], mUpload[3]-mUpload[1]);
+		mTex.send(&mTexels[mUpload[1]*mTexSize[0] + mUpload[0]]);
+		mUpload[0] = mUpload[2] = 0;
+	}
 	mTex.draw(mRegion[0].min(), mRegion[1].max(), mRegion[0].max(), mRegion[1].min());
 	mTex.end();
 	draw::disable(draw::Texture2D);
@@ -287,19 +402,86 @@ void PlotDensity::onDraw(GraphicsData& b, const Data& d){
 
 
 PlotFunction1D::PlotFunction1D(const Color& c, float stroke, int prim, PathStyle path)
-:	Plottable(prim, stroke,c), mPathStyle(path), mDomainOffset(0)
+:	Plottable(prim, stroke,c), mPathStyle(path), mDomainOffset(0), mDecimate(false),
+	mPyramidElems(0), mPyramidSize(0), mPyramidType(0), mPyramidStride(0)
 {
+	mDirty[0] = mDirty[1] = mDirty[2] = mDirty[3] = 0;
+}
+
+PlotFunction1D& PlotFunction1D::updateRegion(int x, int y, int w, int h){
+	Plottable::updateRegion(x,y,w,h);
+	int r[4] = { x, w<0 ? INT_MAX : x+w, y, h<0 ? INT_MAX : y+h };
+	for(int k=0; k<4; k+=2){
+		if(mDirty[k] >= mDirty[k+1]){
+			mDirty[k] = r[k]; mDirty[k+1] = r[k+1];
+		}
+		else{
+			mDirty[k] = glv::min(mDirty[k], r[k]); mDirty[k+1] = glv::max(mDirty[k+1], r[k+1]);
+		}
+	}
+	return *this;
+}
+
+// Recompute extrema of blocks of pyramid overlapping samples [a,b)
+template <class Levels, class F>
+static void updatePyramid(Levels& L, int a, int b, F val){
+	if(L.empty() || a >= b) return;
+
+	int b0 = a>>3, b1 = glv::min((b+7)>>3, int(L[0].size()));
+	for(int j=b0; j<b1; ++j){
+		float lo = val(j<<3), hi = lo;
+		for(int s=(j<<3)+1; s<(j+1)<<3; ++s){
+			float v = val(s);
+			if(v < lo) lo = v;
+			if(v > hi) hi = v;
+		}
+		L[0][j].min = lo; L[0][j].max = hi;
+	}
+
+	for(unsigned k=1; k<L.size(); ++k){
+		b0 >>= 1; b1 = glv::min((b1+1)>>1, int(L[k].size()));
+		for(int j=b0; j<b1; ++j){
+			const auto& c1 = L[k-1][2*j];
+			const auto& c2 = L[k-1][2*j+1];
+			L[k][j].min = c1.min < c2.min ? c1.min : c2.min;
+			L[k][j].max = c1.max > c2.max ? c1.max : c2.max;
+		}
+	}
+}
+
+// Get extrema of samples [a,b) from largest aligned blocks of pyramid
+template <class Levels, class F>
+static void queryPyramid(float& lo, float& hi, const Levels& L, int a, int b, F val){
+	lo = FLT_MAX; hi = -FLT_MAX;
+	auto take = [&](int k, int j){
+		if(k < 3){
+			for(int s=j<<k; s<(j+1)<<k; ++s){
+				float v = val(s);
+				if(v < lo) lo = v;
+				if(v > hi) hi = v;
+			}
+		}
+		else{
+			const auto& m = L[k-3][j];
+			if(m.min < lo) lo = m.min;
+			if(m.max > hi) hi = m.max;
+		}
+	};
+	for(int k=0; a<b; ++k, a>>=1, b>>=1){
+		if(a&1) take(k, a++);
+		if(b&1) take(k, --b);
+	}
 }
 
-template <class R>
-void getFX(float& x, float& y, const Data& d, const Indexer& i, int offset){
+template <class View>
+void getFX(float& x, float& y, const View& v, const Indexer& i, int offset){
 	x = i[0] + offset;
-	y = d.elem<R>(0, i[0]);
+	y = v(0, i[0]);
 }
 
-template <class R>
-void getFY(float& x, float& y, const Data& d, const Indexer& i, int offset){
-	x = d.elem<R>(0, 0, i[1]);
+template <class View>
+void getFY(float& x, float& y, const View& v, const Indexer& i, int offset){
+	x = v(0, 0, i[1]);
 	y = i[1] + offset;
 }
 
@@ -325,47 +507,108 @@ void PlotFunction1D::onMap(GraphicsData& g, const Data& d, const Indexer& i){
 	// N1 == 1,	domain along y, f(y) = ...
 	// N2 == 1,	domain along x, f(x) = ...
 
-	#define PLOT(Type)\
-	switch(mPathStyle){\
-		case PlotFunction1D::DIRECT:\
-			if(1==N2){\
-				while(i()){\
-					float x,y; getFX<Type>(x,y, d,i, mDomainOffset);\
-					g.addVertex(x, y);\
-				}\
-			}\
-			else if(1==N1){\
-				while(i()){\
-					float x,y; getFY<Type>(x,y, d,i, mDomainOffset);\
-					g.addVertex(x, y);\
-				}\
-			}\
-			break;\
-		case PlotFunction1D::ZIGZAG:\
-			if(1==N2){\
-				while(i()){\
-					float x,y; getFX<Type>(x,y, d,i, mDomainOffset);\
-					g.addVertex(x, 0);\
-					g.addVertex(x, y);\
-				}\
-			}\
-			else if(1==N1){\
-				while(i()){\
-					float x,y; getFY<Type>(x,y, d,i, mDomainOffset);\
-					g.addVertex(0, y);\
-					g.addVertex(x, y);\
-				}\
-			}\
-			break;\
-		default:;\
-	}\
-	
-	switch(d.type()){
-	case Data::FLOAT:	PLOT(float);	break;
-	case Data::DOUBLE:	PLOT(double);	break;
-	case Data::INT:		PLOT(int);		break;
-	default:;
+	if(mDecimate && (1==N1 || 1==N2)){
+		const int ax = 1==N2 ? 0 : 1;	// plot axis of domain
+		const int N = ax ? N2 : N1;
+
+		// rebuild pyramid if storage changed, otherwise update changed region
+		int a = mDirty[ax*2], b = mDirty[ax*2+1];
+		if(d.elems<char>() != mPyramidElems || N != mPyramidSize
+			|| int(d.type()) != mPyramidType || d.stride() != mPyramidStride
+		){
+			mPyramidElems = d.elems<char>();
+			mPyramidSize = N;
+			mPyramidType = d.type();
+			mPyramidStride = d.stride();
+			mPyramid.clear();
+			for(int k=3; N>>k; ++k) mPyramid.emplace_back(N>>k);
+			a = 0; b = N;
+		}
+		mDirty[0] = mDirty[1] = mDirty[2] = mDirty[3] = 0;
+
+		auto addVertex = [&](float dom, float val){
+			if(ax)	g.addVertex(val, dom);
+			else	g.addVertex(dom, val);
+		};
+
+		d.visit([&](auto v){
+			auto val = [&](int j){ return float(ax ? v(0,0,j) : v(0,j)); };
+
+			updatePyramid(mPyramid, glv::max(a,0), glv::min(b,N), val);
+
+			// visible samples, plus one beyond each edge to continue path
+			const Interval<double>& iv = visibleInterval(ax);
+			const float pixels = visiblePixels(ax);
+			int s0 = glv::clip(int(std::floor(iv.min() - mDomainOffset)), N);
+			int s1 = glv::clip(int(std::ceil (iv.max() - mDomainOffset)) + 1, N);
+
+			if(pixels <= 0 || s1-s0 <= 2*pixels){
+				for(int j=s0; j<s1; ++j){
+					if(ZIGZAG == mPathStyle) addVertex(j + mDomainOffset, 0);
+					addVertex(j + mDomainOffset, val(j));
+				}
+				return;
+			}
+
+			// one column of extrema per pixel
+			const double dx = iv.diameter() / pixels;
+			for(int c=0; c<int(std::ceil(pixels)); ++c){
+				double x0 = iv.min() + c*dx - mDomainOffset;
+				int j0 = glv::clip(int(std::ceil(x0)), N);
+				int j1 = glv::clip(int(std::ceil(x0 + dx)), N);
+				if(j0 >= j1) continue;
+				float lo, hi;
+				queryPyramid(lo, hi, mPyramid, j0, j1, val);
+				if(lo > hi) continue; // all NaN
+				float x = x0 + 0.5*dx + mDomainOffset;
+				if(ZIGZAG == mPathStyle){
+					addVertex(x, 0); addVertex(x, hi);
+					addVertex(x, 0); addVertex(x, lo);
+				}
+				else{
+					addVertex(x, lo); addVertex(x, hi);
+				}
+			}
+		});
+		return;
 	}
+
+	// resolve element type once for all samples
+	d.visit([&](auto v){
+		switch(mPathStyle){
+			case PlotFunction1D::DIRECT:
+				if(1==N2){
+					while(i()){
+						float x,y; getFX(x,y, v,i, mDomainOffset);
+						g.addVertex(x, y);
+					}
+				}
+				else if(1==N1){
+					while(i()){
+						float x,y; getFY(x,y, v,i, mDomainOffset);
+						g.addVertex(x, y);
+					}
+				}
+				break;
+			case PlotFunction1D::ZIGZAG:
+				if(1==N2){
+					while(i()){
+						float x,y; getFX(x,y, v,i, mDomainOffset);
+						g.addVertex(x, 0);
+						g.addVertex(x, y);
+					}
+				}
+				else if(1==N1){
+					while(i()){
+						float x,y; getFY(x,y, v,i, mDomainOffset);
+						g.addVertex(0, y);
+						g.addVertex(x, y);
+					}
+				}
+				break;
+			default:;
+		}
+	});
 }
 
 
@@ -377,11 +620,13 @@ PlotFunction2D::PlotFunction2D(const Color& c)
 
 void PlotFunction2D::onMap(GraphicsData& g, const Data& d, const Indexer& i){
 	if(d.size(0) < 2) return;
-	while(i()){
-		auto x = d.at<float>(0, i[0], i[1]);
-		auto y = d.at<float>(1, i[0], i[1]);
-		g.addVertex(x, y);
-	}
+	d.visit([&](auto v){
+		while(i()){
+			float x = v(0, i[0], i[1]);
+			float y = v(1, i[0], i[1]);
+			g.addVertex(x, y);
+		}
+	});
 }
 
 
@@ -406,8 +651,96 @@ struct EvPlotDestroyContext : public EventHandler{
 	}
 } evPlotDestroyContext;
 
+namespace{
+
+// Worker threads that run indexed jobs together with the calling thread
+class MapWorkers{
+public:
+
+	static MapWorkers& get(){
+		static MapWorkers * w = new MapWorkers; // never joined
+		return *w;
+	}
+
+	int threads() const { return mLimit; }
+
+	// Set number of worker threads, spawning more as needed
+	void threads(int n){
+		std::lock_guard<std::mutex> lock(mMutex);
+		n = n < 0 ? 0 : n;
+		try{
+			for(; mSpawned < n; ++mSpawned){
+				int index = mSpawned;
+				std::thread([this, index]{ loop(index); }).detach();
+			}
+		}
+		catch(...){ // threads unavailable
+			n = mSpawned;
+		}
+		mLimit = n;
+	}
+
+	// Call f(i) for i in [0,n) and return when all calls have finished
+	void run(int n, const std::function<void(int)>& f){
+		if(mLimit == 0 || n < 2){
+			for(int i=0; i<n; ++i) f(i);
+			return;
+		}
+		std::lock_guard<std::mutex> runLock(mRunMutex);
+		std::unique_lock<std::mutex> lock(mMutex);
+		mJob = &f;
+		mNext = 0;
+		mJobs = mPending = n;
+		++mGeneration;
+		mWake.notify_all();
+		work(lock);
+		mDone.wait(lock, [this]{ return 0 == mPending; });
+		mJob = nullptr;
+	}
+
+private:
+	std::mutex mMutex, mRunMutex;
+	std::condition_variable mWake, mDone;
+	const std::function<void(int)> * mJob = nullptr;
+	int mNext = 0, mJobs = 0, mPending = 0;
+	unsigned mGeneration = 0;
+	int mSpawned = 0;
+	std::atomic<int> mLimit{0};
+
+	MapWorkers(){
+		int n = std::thread::hardware_concurrency();
+		threads(n > 0 ? n-1 : 1);
+	}
+
+	// Claim and run jobs until none are left; lock must be held
+	void work(std::unique_lock<std::mutex>& lock){
+		while(mNext < mJobs){
+			int i = mNext++;
+			lock.unlock();
+			(*mJob)(i);
+			lock.lock();
+			if(0 == --mPending) mDone.notify_all();
+		}
+	}
+
+	void loop(int index){
+		std::unique_lock<std::mutex> lock(mMutex);
+		unsigned gen = mGeneration;
+		for(;;){
+			mWake.wait(lock, [&]{ return gen != mGeneration; });
+			gen = mGeneration;
+			if(index < mLimit) work(lock);
+		}
+	}
+};
+
+} // {}
+
+void Plot::mapThreads(int n){ MapWorkers::get().threads(n); }
+int Plot::mapThreads(){ return MapWorkers::get().threads(); }
+
 Plot::Plot(const Rect& r)
-:	Grid(r)
+:	Grid(r), mParallelMap(false)
 {
 	data().type(Data::FLOAT);
 	addHandler(Event::WindowCreate, evPlotCreateContext);
@@ -429,19 +762,62 @@ Plot::Plot(const Rect& r, Plottable& p1, Plottable& p2)
 
 void Plot::onDraw(GLV& g){
 
-	auto& gd = g.graphicsData();
 	draw::color(colors().fore);
 
-	{ pushGrid();
-		for(auto& plottable : plottables()){
-			auto& p = *plottable;
-			if(p.active() && p.drawUnderGrid()){
-				gd.reset();
-				gd.colors()[0] = p.color();
-				p.doPlot(gd, p.data().hasData() ? p.data() : data());
+	for(auto& plottable : plottables()){
+		plottable->mVisible[0] = interval(0);
+		plottable->mVisible[1] = interval(1);
+		plottable->mVisiblePixels[0] = w;
+		plottable->mVisiblePixels[1] = h;
+	}
+
+	auto plotData = [this](Plottable& p) -> const Data& {
+		return p.data().hasData() ? p.data() : data();
+	};
+
+	// each Plottable has its own graphics data so unchanged geometry stays on the GPU
+	mMapped.resize(plottables().size());
+	for(unsigned i=0; i<plottables().size(); ++i){
+		mMapped[i].cache(true).reset();
+		mMapped[i].colors()[0] = plottables()[i]->color();
+	}
+
+	// map all Plottables up front, before any drawing
+	if(mParallelMap){
+		std::vector<int> jobs;
+
+		for(unsigned i=0; i<plottables().size(); ++i){
+			auto& p = *plottables()[i];
+			if(p.active() && plotData(p).hasData() && p.concurrentMap()) jobs.push_back(i);
+		}
+
+		MapWorkers::get().run(jobs.size(), [&](int j){
+			auto& p = *plottables()[jobs[j]];
+			p.doMap(mMapped[jobs[j]], plotData(p));
+		});
+
+		for(unsigned i=0; i<plottables().size(); ++i){
+			auto& p = *plottables()[i];
+			if(p.active() && plotData(p).hasData() && !p.concurrentMap()) p.doMap(mMapped[i], plotData(p));
+		}
+	}
+
+	auto plot = [&](bool under){
+		for(unsigned i=0; i<plottables().size(); ++i){
+			auto& p = *plottables()[i];
+			if(p.active() && p.drawUnderGrid() == under){
+				if(mParallelMap){
+					if(plotData(p).hasData()) p.doDraw(mMapped[i], plotData(p));
+				}
+				else{
+					p.doPlot(mMapped[i], plotData(p));
+				}
 			}
 		}
+	};
 
+	{ pushGrid();
+		plot(true);
 	popGrid(); }
 
 	Grid::onDraw(g);
@@ -450,14 +826,7 @@ void Plot::onDraw(GLV& g){
 
 	// push into grid space and call attached plottables
 	{ pushGrid();
-		for(auto& plottable : plottables()){
-			auto& p = *plottable;
-			if(p.active() && !p.drawUnderGrid()){
-				gd.reset();
-				gd.colors()[0] = p.color();
-				p.doPlot(gd, p.data().hasData() ? p.data() : data());
-			}
-		}
+		plot(false);
 	popGrid(); }
 }
 
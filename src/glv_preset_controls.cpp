@@ -252,10 +252,10 @@ PathView::PathView(space_t width)
 	enable(CropChildren);
 	disable(DrawGrid);
 
-	mDur.l = seqRight();
-	mCrv.l = mDur.right();
-	mSmt.l = mCrv.right();
-	mName.l= mSmt.right()+8;
+	mDur.left(seqRight());
+	mCrv.left(mDur.right());
+	mSmt.left(mCrv.right());
+	mName.left(mSmt.right()+8);
 	
 	mDur.disable(DrawBorder | DrawBack);
 	mCrv.disable(DrawBorder | DrawBack);
@@ -302,6 +302,7 @@ PathView& PathView::modelManager(ModelManager& v){
 
 void PathView::onAnimate(double dsec){
 	if(mPlaying && mPath.size()>0){
+		damage();	// position moves while playing
 
 		double max = mPath.size()-1;
 
@@ -565,10 +566,10 @@ bool PathView::onEvent(Event::t e, GLV& g){
 
 void PathView::onCellChange(int iOld, int iNew){
 	float y = iNew * dy();
-	mDur.t = getY(iNew);
-	mCrv.t = getY(iNew);
-	mSmt.t = getY(iNew);
-	mName.t= y;
+	mDur.top(getY(iNew));
+	mCrv.top(getY(iNew));
+	mSmt.top(getY(iNew));
+	mName.top(y);
 
 	Keyframe& kf = mPath[iNew];
 
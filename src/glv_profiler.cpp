@@ -0,0 +1,261 @@
+/*	Graphics Library of Views (GLV) - GUI Building Toolkit
+	See COPYRIGHT file for authors and license information */
+
+#include <algorithm>
+#include <stdio.h>
+#include "glv_profiler.h"
+
+namespace glv{
+
+const char * FrameProfiler::phaseName(Phase p){
+	switch(p){
+	case Animate:		return "Animate";
+	case DataModelSync:	return "DataModelSync";
+	case Geometry:		return "Geometry";
+	case DrawHandlers:	return "DrawHandlers";
+	case Draw:			return "Draw";
+	default:			return "";
+	}
+}
+
+FrameProfiler::FrameProfiler(int frames)
+:	mCurrent(0), mGLV(0)
+{
+	capacity(frames);
+}
+
+FrameProfiler::~FrameProfiler(){ detach(); }
+
+FrameProfiler& FrameProfiler::attach(GLV& g){
+	detach();
+	mGLV = &g;
+	g.profiler(this);
+	return *this;
+}
+
+FrameProfiler& FrameProfiler::detach(){
+	if(mGLV && GLV::valid(mGLV) && mGLV->profiler() == this) mGLV->profiler(0);
+	mGLV = 0;
+	mCurrent = 0;
+	return *this;
+}
+
+FrameProfiler& FrameProfiler::clear(){
+	mCurrent = 0;
+	mNext = mCount = 0;
+	mNumber = 0;
+	mEpoch = clock::now();
+	return *this;
+}
+
+FrameProfiler& FrameProfiler::capacity(int frames){
+	mFrames.resize((frames > 0 ? frames : 1) + 1);
+	return clear();
+}
+
+const FrameProfiler::Frame& FrameProfiler::frame(int i) const {
+	int n = mFrames.size();
+	return mFrames[((mNext - 1 - i) % n + n) % n];
+}
+
+double FrameProfiler::since(clock::time_point t) const {
+	return std::chrono::duration<double>(t - mEpoch).count();
+}
+
+void FrameProfiler::beginFrame(){
+	mCurrent = &mFrames[mNext];
+	mCurrent->number = mNumber;
+	mCurrent->views.clear();
+	mCurrent->samples.clear();
+	mIndex.clear();
+	mFrameStart = clock::now();
+	mCurrent->start = since(mFrameStart);
+}
+
+void FrameProfiler::endFrame(){
+	if(!mCurrent) return;
+	mCurrent->duration = std::chrono::duration<double>(clock::now() - mFrameStart).count();
+	mCurrent = 0;
+	mNext = (mNext + 1) % mFrames.size();
+	if(mCount < capacity()) ++mCount;
+	++mNumber;
+}
+
+void FrameProfiler::beginScope(Scope& s, const View& v, Phase ph){
+	auto it = mIndex.find(&v);
+	if(it == mIndex.end()){
+		it = mIndex.emplace(&v, int(mCurrent->views.size())).first;
+		mCurrent->views.emplace_back();
+		ViewTiming& t = mCurrent->views.back();
+		t.view = &v;
+		t.className = v.className();
+		t.name = v.name();
+	}
+	s.mView = it->second;
+	s.mPhase = ph;
+	s.mPainted = draw::stats().painted;
+	s.mStart = clock::now();
+}
+
+void FrameProfiler::endScope(Scope& s){
+	clock::time_point end = clock::now();
+	if(!mCurrent) return;	// frame ended within scope
+	double dur = std::chrono::duration<double>(end - s.mStart).count();
+	ViewTiming& t = mCurrent->views[s.mView];
+	t.seconds[s.mPhase] += dur;
+	if(Draw == s.mPhase) t.vertices += draw::stats().painted - s.mPainted;
+	Sample smp = { s.mView, s.mPhase, since(s.mStart), dur };
+	mCurrent->samples.push_back(smp);
+}
+
+FrameProfiler::ViewTiming FrameProfiler::query(const std::string& classOrName, int frames) const {
+	ViewTiming r;
+	if(frames <= 0 || frames > mCount) frames = mCount;
+	bool matched = false;
+	for(int i=0; i<frames; ++i){
+		for(const ViewTiming& t : frame(i).views){
+			if(classOrName != t.className && classOrName != t.name) continue;
+			if(!matched){
+				r.view = t.view;
+				r.className = t.className;
+				r.name = t.name;
+				matched = true;
+			}
+			else if(r.view != t.view) r.view = 0;
+			for(int k=0; k<NumPhases; ++k) r.seconds[k] += t.seconds[k];
+			r.vertices += t.vertices;
+		}
+	}
+	return r;
+}
+
+static void appendJSONString(std::string& s, const char * v){
+	s += '"';
+	for(; *v; ++v){
+		unsigned char c = *v;
+		if('"' == c || '\\' == c){ s += '\\'; s += c; }
+		else if(c < 0x20){
+			char buf[8];
+			snprintf(buf, sizeof buf, "\\u%04x", c);
+			s += buf;
+		}
+		else s += c;
+	}
+	s += '"';
+}
+
+std::string FrameProfiler::chromeTrace() const {
+	std::string s = "{\"traceEvents\":[";
+	char buf[128];
+	bool first = true;
+
+	// complete events with times in microseconds
+	auto event = [&](const char * name, const char * cat, double start, double dur, int tid){
+		if(!first) s += ",";
+		first = false;
+		s += "\n{\"name\":";
+		appendJSONString(s, name);
+		snprintf(buf, sizeof buf, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d",
+			cat, start*1e6, dur*1e6, tid);
+		s += buf;
+	};
+
+	std::string name;
+	for(int i=mCount-1; i>=0; --i){
+		const Frame& f = frame(i);
+		char frameName[32];
+		snprintf(frameName, sizeof frameName, "Frame %u", f.number);
+		event(frameName, "Frame", f.start, f.duration, 1);
+		s += "}";
+
+		for(const Sample& smp : f.samples){
+			const ViewTiming& t = f.views[smp.view];
+			name = t.className;
+			if(!t.name.empty()){ name += " "; name += t.name; }
+			event(name.c_str(), phaseName(smp.phase), smp.start, smp.duration, 1);
+			if(Draw == smp.phase){
+				snprintf(buf, sizeof buf, ",\"args\":{\"vertices\":%u}", t.vertices);
+				s += buf;
+			}
+			s += "}";
+		}
+	}
+
+	s += "\n],\"displayTimeUnit\":\"ms\"}\n";
+	return s;
+}
+
+bool FrameProfiler::writeChromeTrace(const std::string& path) const {
+	FILE * fp = fopen(path.c_str(), "w");
+	if(!fp) return false;
+	std::string s = chromeTrace();
+	bool ok = fwrite(s.data(), 1, s.size(), fp) == s.size();
+	return (0 == fclose(fp)) && ok;
+}
+
+
+
+ProfilerView::ProfilerView(const FrameProfiler& p, const Rect& r, int rows)
+:	View(r), mProfiler(p), mRows(rows)
+{}
+
+void ProfilerView::onDraw(GLV& g){
+	using namespace glv::draw;
+
+	const FrameProfiler& p = mProfiler;
+	const int N = p.capacity();
+	const float chartH = h * 0.5f;
+	GraphicsData& gd = g.graphicsData();
+
+	// scale so that a frame at 60 Hz fills half the chart
+	double maxDur = 2./60;
+	for(int i=0; i<p.frames(); ++i) maxDur = std::max(maxDur, p.frame(i).duration);
+
+	// frame times, newest at the right
+	const float bw = w / N;
+	for(int i=0; i<p.frames(); ++i){
+		float x = w - (i + 0.5f) * bw;
+		float y = chartH * (1.f - float(p.frame(i).duration / maxDur));
+		gd.addVertex(x, chartH);
+		gd.addVertex(x, y);
+	}
+	color(colors().fore);
+	lineWidth(bw > 1 ? bw : 1);
+	paint(Lines, gd);
+
+	gd.reset();
+	float y60 = chartH * (1.f - float(1./60 / maxDur));
+	gd.addVertex(0, y60);
+	gd.addVertex(w, y60);
+	color(colors().border);
+	lineWidth(1);
+	paint(Lines, gd);
+
+	if(!p.frames()) return;
+
+	// slowest Views of last frame
+	const FrameProfiler::Frame& f = p.frame();
+	std::vector<const FrameProfiler::ViewTiming *> views;
+	for(auto& t : f.views) views.push_back(&t);
+	int rows = std::min<int>(mRows, views.size());
+	std::partial_sort(views.begin(), views.begin() + rows, views.end(),
+		[](const FrameProfiler::ViewTiming * a, const FrameProfiler::ViewTiming * b){
+			return a->total() > b->total();
+		}
+	);
+
+	char buf[128];
+	snprintf(buf, sizeof buf, "frame %.2f ms", f.duration*1e3);
+	std::string s = buf;
+	for(int i=0; i<rows; ++i){
+		const FrameProfiler::ViewTiming& t = *views[i];
+		snprintf(buf, sizeof buf, "\n%.2f ms %s %s", t.total()*1e3, t.className, t.name.c_str());
+		s += buf;
+	}
+
+	gd.reset();
+	color(colors().text);
+	font().render(gd, s.c_str(), 2, chartH + 2);
+}
+
+} // glv::
@@ -0,0 +1,411 @@
+/*	Graphics Library of Views (GLV) - GUI Building Toolkit
+	See COPYRIGHT file for authors and license information */
+
+#include <algorithm>
+#include <cmath>
+#include <stdio.h>
+#include "glv_rasterizer.h"
+
+namespace glv{
+namespace draw{
+
+// Get blend factor for one component
+static float blendFactor(int f, int i, const Color& s, const Color& d){
+	switch(f){
+	case GL_ZERO:					return 0;
+	case GL_ONE:					return 1;
+	case GL_SRC_COLOR:				return s[i];
+	case GL_ONE_MINUS_SRC_COLOR:	return 1-s[i];
+	case GL_DST_COLOR:				return d[i];
+	case GL_ONE_MINUS_DST_COLOR:	return 1-d[i];
+	case GL_SRC_ALPHA:				return s.a;
+	case GL_ONE_MINUS_SRC_ALPHA:	return 1-s.a;
+	case GL_DST_ALPHA:				return d.a;
+	case GL_ONE_MINUS_DST_ALPHA:	return 1-d.a;
+	case GL_SRC_ALPHA_SATURATE:		return i<3 ? std::min(s.a, 1-d.a) : 1;
+	default:						return 1;
+	}
+}
+
+static unsigned char toByte(float v){
+	return v<=0.f ? 0 : v>=1.f ? 255 : (unsigned char)(v*255.f + 0.5f);
+}
+
+static Color lerp(const Color& a, const Color& b, float f){
+	return Color(a.r+(b.r-a.r)*f, a.g+(b.g-a.g)*f, a.b+(b.b-a.b)*f, a.a+(b.a-a.a)*f);
+}
+
+// Fraction of 4x4 samples of pixel (x,y) inside a shape
+template <class Inside>
+static float coverage(int x, int y, const Inside& inside){
+	int n=0;
+	for(int j=0; j<4; ++j){
+	for(int i=0; i<4; ++i){
+		n += inside(x + (i+0.5f)*0.25f, y + (j+0.5f)*0.25f);
+	}}
+	return n/16.f;
+}
+
+// First pixel index whose center is at or beyond v
+static int firstCenter(float v){ return (int)std::ceil(v - 0.5f); }
+
+
+Rasterizer::Rasterizer(int w, int h)
+:	mPrev(0), mW(0), mH(0), mActive(false)
+{
+	resize(w,h);
+}
+
+Rasterizer::~Rasterizer(){
+	if(mActive) end();
+}
+
+Rasterizer& Rasterizer::begin(){
+	if(!mActive){
+		mPrev = Backend::current();
+		Backend::current() = this;
+		mActive = true;
+	}
+	return *this;
+}
+
+Rasterizer& Rasterizer::end(){
+	if(mActive){
+		Backend::current() = mPrev;
+		mPrev = 0;
+		mActive = false;
+	}
+	return *this;
+}
+
+Rasterizer& Rasterizer::resize(int w, int h){
+	if(w<0) w=0;
+	if(h<0) h=0;
+	mW=w; mH=h;
+	mPixels.assign(w*h*4, 0);
+	viewport(0,0,w,h);
+	scissor(0,0,w,h);
+	return *this;
+}
+
+bool Rasterizer::clipBox(int& l, int& b, int& r, int& t) const {
+	l = std::max(0, mViewport[0]);
+	b = std::max(0, mViewport[1]);
+	r = std::min(mW, mViewport[0] + mViewport[2]);
+	t = std::min(mH, mViewport[1] + mViewport[3]);
+	if(enabled(ScissorTest)){
+		l = std::max(l, mScissor[0]);
+		b = std::max(b, mScissor[1]);
+		r = std::min(r, mScissor[0] + mScissor[2]);
+		t = std::min(t, mScissor[1] + mScissor[3]);
+	}
+	return l<r && b<t;
+}
+
+void Rasterizer::clear(int mask){
+	if(!(mask & GL_COLOR_BUFFER_BIT)) return;
+
+	// clearing ignores the viewport, but not the scissor
+	int l=0, b=0, r=mW, t=mH;
+	if(enabled(ScissorTest)){
+		l = std::max(l, mScissor[0]);
+		b = std::max(b, mScissor[1]);
+		r = std::min(r, mScissor[0] + mScissor[2]);
+		t = std::min(t, mScissor[1] + mScissor[3]);
+	}
+
+	unsigned char c[4];
+	for(int i=0; i<4; ++i) c[i] = toByte(mClearColor[i]);
+
+	for(int y=b; y<t; ++y){
+		unsigned char * row = &mPixels[(mH-1-y)*mW*4];
+		for(int x=l; x<r; ++x){
+			for(int i=0; i<4; ++i) row[x*4+i] = c[i];
+		}
+	}
+}
+
+void Rasterizer::fragment(int x, int y, const Color& c, float cov){
+	unsigned char * p = &mPixels[((mH-1-y)*mW + x)*4];
+	Color s = c;
+	s.a *= cov;
+
+	if(enabled(Blend)){
+		static const float inv255 = 1.f/255.f;
+		Color d(p[0]*inv255, p[1]*inv255, p[2]*inv255, p[3]*inv255);
+		for(int i=0; i<4; ++i){
+			float sf = s[i] * blendFactor(mBlendSrc, i, s, d);
+			float df = d[i] * blendFactor(mBlendDst, i, s, d);
+			float v;
+			switch(mBlendEq){
+			case GL_FUNC_SUBTRACT:			v = sf - df; break;
+			case GL_FUNC_REVERSE_SUBTRACT:	v = df - sf; break;
+			case GL_MIN:					v = std::min(s[i], d[i]); break;
+			case GL_MAX:					v = std::max(s[i], d[i]); break;
+			default:						v = sf + df;
+			}
+			p[i] = toByte(v);
+		}
+	}
+	else{
+		for(int i=0; i<4; ++i) p[i] = toByte(s[i]);
+	}
+}
+
+void Rasterizer::point(float x, float y, const Color& c, int l, int b, int r, int t){
+	float s = std::max(mPointSize, 1.f);
+	float h = s*0.5f;
+
+	if(enabled(PointSmooth)){
+		int x0 = std::max(l, (int)std::floor(x-h)), x1 = std::min(r, (int)std::ceil(x+h));
+		int y0 = std::max(b, (int)std::floor(y-h)), y1 = std::min(t, (int)std::ceil(y+h));
+		float hh = h*h;
+		auto inside = [&](float px, float py){ return (px-x)*(px-x) + (py-y)*(py-y) <= hh; };
+		for(int j=y0; j<y1; ++j){
+		for(int i=x0; i<x1; ++i){
+			float cov = coverage(i,j, inside);
+			if(cov > 0.f) fragment(i,j, c, cov);
+		}}
+	}
+	else{
+		s = std::floor(s + 0.5f); h = s*0.5f;
+		int x0 = std::max(l, firstCenter(x-h)), x1 = std::min(r, firstCenter(x+h));
+		int y0 = std::max(b, firstCenter(y-h)), y1 = std::min(t, firstCenter(y+h));
+		for(int j=y0; j<y1; ++j){
+		for(int i=x0; i<x1; ++i){
+			fragment(i,j, c);
+		}}
+	}
+}
+
+void Rasterizer::line(
+	float x0, float y0, float x1, float y1, const Color& c0, const Color& c1,
+	int l, int b, int r, int t
+){
+	float dx = x1-x0, dy = y1-y0;
+	float len = std::sqrt(dx*dx + dy*dy);
+	if(len == 0.f) return;
+	float w = std::max(mLineWidth, 1.f);
+
+	if(enabled(LineSmooth)){
+		// coverage of a rectangle of the line's width centered on the segment
+		float ux = dx/len, uy = dy/len;
+		float h = w*0.5f;
+		int bx0 = std::max(l, (int)std::floor(std::min(x0,x1) - h));
+		int bx1 = std::min(r, (int)std::ceil (std::max(x0,x1) + h));
+		int by0 = std::max(b, (int)std::floor(std::min(y0,y1) - h));
+		int by1 = std::min(t, (int)std::ceil (std::max(y0,y1) + h));
+		auto inside = [&](float px, float py){
+			float ax = px-x0, ay = py-y0;
+			float u = ax*ux + ay*uy;
+			float v = ax*uy - ay*ux;
+			return u>=0.f && u<=len && v>=-h && v<=h;
+		};
+		for(int j=by0; j<by1; ++j){
+		for(int i=bx0; i<bx1; ++i){
+			float cov = coverage(i,j, inside);
+			if(cov > 0.f){
+				float f = ((i+0.5f-x0)*ux + (j+0.5f-y0)*uy)/len;
+				fragment(i,j, lerp(c0,c1, std::min(std::max(f,0.f),1.f)), cov);
+			}
+		}}
+		return;
+	}
+
+	// aliased line: step along major axis, excluding the last endpoint
+	w = std::floor(w + 0.5f);
+	bool xMajor = std::fabs(dx) >= std::fabs(dy);
+	float a0 = xMajor ? x0 : y0, a1 = xMajor ? x1 : y1;
+	float m0 = xMajor ? y0 : x0, m1 = xMajor ? y1 : x1;
+	int lo = xMajor ? l : b, hi = xMajor ? r : t;
+	int dir, i0, i1;
+	if(a1 > a0){
+		dir = 1;
+		i0 = std::max(firstCenter(a0), lo);
+		i1 = std::min(firstCenter(a1), hi);
+		if(i0 >= i1) return;
+	}
+	else{
+		dir =-1;
+		i0 = std::min((int)std::floor(a0 - 0.5f), hi-1);
+		i1 = std::max((int)std::floor(a1 - 0.5f), lo-1);
+		if(i0 <= i1) return;
+	}
+	float slope = (m1-m0)/(a1-a0);
+
+	for(int i=i0; i!=i1; i+=dir){
+		float f = (i+0.5f - a0)/(a1-a0);
+		float m = m0 + (i+0.5f - a0)*slope;
+		Color c = lerp(c0,c1,f);
+		int k0 = firstCenter(m - w*0.5f);
+		for(int k=k0; k<k0+int(w); ++k){
+			int x = xMajor ? i : k;
+			int y = xMajor ? k : i;
+			if(x>=l && x<r && y>=b && y<t) fragment(x,y, c);
+		}
+	}
+}
+
+void Rasterizer::triangle(const float * xs, const float * ys, const Color * cs, int l, int b, int r, int t){
+	int v0=0, v1=1, v2=2;
+	float area = (xs[1]-xs[0])*(ys[2]-ys[0]) - (ys[1]-ys[0])*(xs[2]-xs[0]);
+	if(area == 0.f) return;
+	if(area < 0.f){ std::swap(v1,v2); area = -area; }	// make counter-clockwise
+
+	const int vs[3] = {v0, v1, v2};
+	float ex[3], ey[3];	// edge vectors
+	bool topLeft[3];
+	for(int e=0; e<3; ++e){
+		int a = vs[e], c = vs[(e+1)%3];
+		ex[e] = xs[c]-xs[a];
+		ey[e] = ys[c]-ys[a];
+		topLeft[e] = ey[e] < 0.f || (ey[e] == 0.f && ex[e] < 0.f);
+	}
+
+	int x0 = std::max(l, firstCenter(std::min(xs[0], std::min(xs[1], xs[2]))));
+	int x1 = std::min(r, firstCenter(std::max(xs[0], std::max(xs[1], xs[2]))) + 1);
+	int y0 = std::max(b, firstCenter(std::min(ys[0], std::min(ys[1], ys[2]))));
+	int y1 = std::min(t, firstCenter(std::max(ys[0], std::max(ys[1], ys[2]))) + 1);
+
+	for(int j=y0; j<y1; ++j){
+		float py = j+0.5f;
+		for(int i=x0; i<x1; ++i){
+			float px = i+0.5f;
+			float w[3];
+			bool in = true;
+			for(int e=0; e<3 && in; ++e){
+				int a = vs[e];
+				w[e] = ex[e]*(py-ys[a]) - ey[e]*(px-xs[a]);
+				in = w[e] > 0.f || (w[e] == 0.f && topLeft[e]);
+			}
+			if(!in) continue;
+
+			// edge e is opposite of vertex vs[(e+2)%3]
+			float b0 = w[1]/area, b1 = w[2]/area, b2 = w[0]/area;
+			const Color& c0 = cs[vs[0]], & c1 = cs[vs[1]], & c2 = cs[vs[2]];
+			fragment(i,j, Color(
+				c0.r*b0 + c1.r*b1 + c2.r*b2,
+				c0.g*b0 + c1.g*b1 + c2.g*b2,
+				c0.b*b0 + c1.b*b1 + c2.b*b2,
+				c0.a*b0 + c1.a*b1 + c2.a*b2
+			));
+		}
+	}
+}
+
+void Rasterizer::paint(int prim, const float * verts, int dim, const Color * cols, const index_t * indices, int num){
+	int type = independent(prim, indices, num, mSeq);
+	if(type < 0 || mSeq.empty()) return;
+
+	int l,b,r,t;
+	if(!clipBox(l,b,r,t)) return;
+
+	++stats().calls; stats().vertices += num;
+
+	float xs[3], ys[3];
+	Color cs[3];
+	int n = Points == type ? 1 : Lines == type ? 2 : 3;
+
+	for(unsigned k=0; k+n<=mSeq.size(); k+=n){
+		for(int i=0; i<n; ++i){
+			index_t j = mSeq[k+i];
+			toWindow(verts + j*dim, dim, xs[i], ys[i]);
+			cs[i] = cols ? cols[j] : mColor;
+		}
+		switch(type){
+		case Points:	point(xs[0], ys[0], cs[0], l,b,r,t); break;
+		case Lines:		line(xs[0], ys[0], xs[1], ys[1], cs[0], cs[1], l,b,r,t); break;
+		default:		triangle(xs, ys, cs, l,b,r,t);
+		}
+	}
+}
+
+bool Rasterizer::writePPM(const char * path) const {
+	FILE * fp = fopen(path, "wb");
+	if(!fp) return false;
+	fprintf(fp, "P6\n%d %d\n255\n", mW, mH);
+	for(int i=0; i<mW*mH; ++i) fwrite(&mPixels[i*4], 1, 3, fp);
+	return 0 == fclose(fp);
+}
+
+
+// PNG encoding
+
+static unsigned long crc32(unsigned long crc, const unsigned char * buf, unsigned len){
+	static unsigned long table[256];
+	static bool init = false;
+	if(!init){
+		for(unsigned long n=0; n<256; ++n){
+			unsigned long c = n;
+			for(int k=0; k<8; ++k) c = c&1 ? 0xedb88320UL ^ (c>>1) : c>>1;
+			table[n] = c;
+		}
+		init = true;
+	}
+	crc ^= 0xffffffffUL;
+	for(unsigned i=0; i<len; ++i) crc = table[(crc ^ buf[i]) & 0xff] ^ (crc >> 8);
+	return crc ^ 0xffffffffUL;
+}
+
+static void putBE32(std::vector<unsigned char>& v, unsigned long x){
+	v.push_back(x>>24); v.push_back(x>>16); v.push_back(x>>8); v.push_back(x);
+}
+
+static void writeChunk(FILE * fp, const char * type, const std::vector<unsigned char>& data){
+	std::vector<unsigned char> c;
+	putBE32(c, data.size());
+	c.insert(c.end(), type, type+4);
+	c.insert(c.end(), data.begin(), data.end());
+	putBE32(c, crc32(0, &c[4], c.size()-4));
+	fwrite(&c[0], 1, c.size(), fp);
+}
+
+bool Rasterizer::writePNG(const char * path) const {
+	FILE * fp = fopen(path, "wb");
+	if(!fp) return false;
+
+	static const unsigned char sig[] = {137,80,78,71,13,10,26,10};
+	fwrite(sig, 1, sizeof(sig), fp);
+
+	std::vector<unsigned char> hdr;
+	putBE32(hdr, mW); putBE32(hdr, mH);
+	hdr.push_back(8);	// bit depth
+	hdr.push_back(6);	// RGBA
+	hdr.push_back(0); hdr.push_back(0); hdr.push_back(0);
+	writeChunk(fp, "IHDR", hdr);
+
+	// scanlines prefixed with filter type 'none'
+	std::vector<unsigned char> raw;
+	raw.reserve((mW*4+1)*mH);
+	for(int j=0; j<mH; ++j){
+		raw.push_back(0);
+		if(mW) raw.insert(raw.end(), &mPixels[j*mW*4], &mPixels[j*mW*4] + mW*4);
+	}
+
+	// zlib stream of stored (uncompressed) deflate blocks
+	std::vector<unsigned char> z;
+	z.push_back(0x78); z.push_back(0x01);
+	unsigned pos = 0;
+	do{
+		unsigned n = std::min<unsigned>(raw.size()-pos, 65535);
+		z.push_back(pos+n == raw.size());
+		z.push_back(n & 0xff); z.push_back(n >> 8);
+		z.push_back(~n & 0xff); z.push_back((~n >> 8) & 0xff);
+		z.insert(z.end(), raw.begin()+pos, raw.begin()+pos+n);
+		pos += n;
+	} while(pos < raw.size());
+
+	unsigned long s1=1, s2=0;
+	for(unsigned i=0; i<raw.size(); ++i){
+		s1 = (s1 + raw[i]) % 65521;
+		s2 = (s2 + s1) % 65521;
+	}
+	putBE32(z, (s2<<16) | s1);
+	writeChunk(fp, "IDAT", z);
+
+	writeChunk(fp, "IEND", std::vector<unsigned char>());
+	return 0 == fclose(fp);
+}
+
+} // draw::
+} // glv::
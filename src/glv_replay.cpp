@@ -0,0 +1,242 @@
+/*	Graphics Library of Views (GLV) - GUI Building Toolkit
+	See COPYRIGHT file for authors and license information */
+
+#include <cmath>
+#include <stdio.h>
+#include <thread>
+#include "glv_replay.h"
+
+namespace glv{
+
+void LatencyHistogram::add(double sec){
+	double ns = sec * 1e9;
+	int i = 0;
+	if(ns >= 1){
+		i = int(std::ceil(std::log2(ns)));
+		if(i >= NumBuckets) i = NumBuckets-1;
+	}
+	++mBuckets[i];
+	if(!mCount || sec < mMin) mMin = sec;
+	if(!mCount || sec > mMax) mMax = sec;
+	mTotal += sec;
+	++mCount;
+}
+
+void LatencyHistogram::clear(){
+	for(auto& b : mBuckets) b = 0;
+	mCount = 0;
+	mMin = mMax = mTotal = 0;
+}
+
+double LatencyHistogram::percentile(double frac) const {
+	if(!mCount) return 0;
+	double n = frac * mCount;
+	unsigned sum = 0;
+	for(int i=0; i<NumBuckets; ++i){
+		sum += mBuckets[i];
+		if(sum >= n) return std::ldexp(1., i) * 1e-9;
+	}
+	return mMax;
+}
+
+void LatencyHistogram::print() const {
+	printf("%u events, mean %.3g s, min %.3g s, max %.3g s\n", mCount, mean(), mMin, mMax);
+	for(int i=0; i<NumBuckets; ++i){
+		if(mBuckets[i]) printf("< %12.0f ns: %u\n", std::ldexp(1., i), mBuckets[i]);
+	}
+}
+
+
+
+// Log format: magic "GLVI", version byte, then for each event:
+//	varint		microseconds since previous event
+//	varint		event type
+//	byte		flags: modifier keys (bits 0-4), whether modifiers are known (5),
+//				whether position changed (6), whether button, clicks, key
+//				and wheel follow (7)
+//	zigzag		x and y difference from previous position, if changed
+//	zigzag		button, clicks, key and wheel, if present
+static const char logMagic[] = "GLVI";
+static const char logVersion = 1;
+
+static void putVarint(std::string& s, unsigned long long v){
+	while(v >= 0x80){ s += char((v & 0x7f) | 0x80); v >>= 7; }
+	s += char(v);
+}
+
+static void putZigzag(std::string& s, long long v){
+	putVarint(s, (static_cast<unsigned long long>(v) << 1) ^ (v < 0 ? ~0ULL : 0));
+}
+
+static bool getVarint(const std::string& s, size_t& i, unsigned long long& v){
+	v = 0;
+	for(int shift=0; i<s.size() && shift<64; shift+=7){
+		unsigned char c = s[i++];
+		v |= static_cast<unsigned long long>(c & 0x7f) << shift;
+		if(!(c & 0x80)) return true;
+	}
+	return false;
+}
+
+static bool getZigzag(const std::string& s, size_t& i, long long& v){
+	unsigned long long u;
+	if(!getVarint(s, i, u)) return false;
+	v = static_cast<long long>(u >> 1) ^ -static_cast<long long>(u & 1);
+	return true;
+}
+
+
+InputRecorder::InputRecorder()
+:	mGLV(0), mCount(0), mX(0), mY(0)
+{
+	clear();
+}
+
+InputRecorder::~InputRecorder(){ detach(); }
+
+InputRecorder& InputRecorder::attach(GLV& g){
+	detach();
+	mGLV = &g;
+	g.inputObserver(this);
+	if(!mCount) mLast = clock::now();
+	return *this;
+}
+
+InputRecorder& InputRecorder::detach(){
+	if(mGLV && GLV::valid(mGLV) && mGLV->inputObserver() == this) mGLV->inputObserver(0);
+	mGLV = 0;
+	return *this;
+}
+
+InputRecorder& InputRecorder::clear(){
+	mLog.assign(logMagic, 4);
+	mLog += logVersion;
+	mCount = mX = mY = 0;
+	mLast = clock::now();
+	return *this;
+}
+
+void InputRecorder::onInput(const InputEvent& e){
+	clock::time_point now = clock::now();
+	auto us = std::chrono::duration_cast<std::chrono::microseconds>(now - mLast).count();
+	mLast = now;
+
+	const bool moved = e.x != mX || e.y != mY;
+	const bool extra = e.button || e.clicks || e.key || e.wheel;
+	int flags = 0;
+	for(int i=0; i<5; ++i) flags |= int(e.modifiers[i]) << i;
+	flags |= int(e.hasModifiers) << 5 | int(moved) << 6 | int(extra) << 7;
+
+	putVarint(mLog, us > 0 ? us : 0);
+	putVarint(mLog, e.type);
+	mLog += char(flags);
+	if(moved){
+		putZigzag(mLog, e.x - mX);
+		putZigzag(mLog, e.y - mY);
+		mX = e.x; mY = e.y;
+	}
+	if(extra){
+		putZigzag(mLog, e.button);
+		putZigzag(mLog, e.clicks);
+		putZigzag(mLog, e.key);
+		putZigzag(mLog, e.wheel);
+	}
+	++mCount;
+}
+
+bool InputRecorder::writeFile(const std::string& path) const {
+	FILE * fp = fopen(path.c_str(), "wb");
+	if(!fp) return false;
+	bool ok = fwrite(mLog.data(), 1, mLog.size(), fp) == mLog.size();
+	return (0 == fclose(fp)) && ok;
+}
+
+
+
+InputReplay::InputReplay(const std::string& v): mLog(v){}
+
+InputReplay& InputReplay::log(const std::string& v){ mLog = v; return *this; }
+
+bool InputReplay::readFile(const std::string& path){
+	FILE * fp = fopen(path.c_str(), "rb");
+	if(!fp) return false;
+	std::string s;
+	char buf[4096];
+	size_t n;
+	while((n = fread(buf, 1, sizeof buf, fp)) > 0) s.append(buf, n);
+	fclose(fp);
+	mLog.swap(s);
+	return true;
+}
+
+bool InputReplay::events(std::vector<InputEvent>& events, std::vector<double> * times) const {
+	events.clear();
+	if(times) times->clear();
+	if(mLog.size() < 5 || mLog.compare(0, 4, logMagic) || mLog[4] != logVersion) return false;
+
+	size_t i = 5;
+	int x = 0, y = 0;
+	double t = 0;
+	while(i < mLog.size()){
+		unsigned long long us, type;
+		if(!getVarint(mLog, i, us) || !getVarint(mLog, i, type) || i >= mLog.size()) return false;
+		int flags = (unsigned char)mLog[i++];
+
+		InputEvent e(static_cast<Event::t>(type));
+		for(int k=0; k<5; ++k) e.modifiers[k] = flags & (1<<k);
+		e.hasModifiers = flags & (1<<5);
+		if(flags & (1<<6)){
+			long long dx, dy;
+			if(!getZigzag(mLog, i, dx) || !getZigzag(mLog, i, dy)) return false;
+			x += dx; y += dy;
+		}
+		e.x = x; e.y = y;
+		if(flags & (1<<7)){
+			long long v[4];
+			for(auto& vk : v) if(!getZigzag(mLog, i, vk)) return false;
+			e.button = v[0]; e.clicks = v[1]; e.key = v[2]; e.wheel = v[3];
+		}
+
+		t += us * 1e-6;
+		events.push_back(e);
+		if(times) times->push_back(t);
+	}
+	return true;
+}
+
+int InputReplay::run(GLV& g, bool realTime){
+	typedef std::chrono::steady_clock clock;
+
+	mLatency.clear();
+	mSeconds = 0;
+	mStateHash = 0;
+	std::vector<InputEvent> evs;
+	std::vector<double> times;
+	if(!events(evs, &times)) return -1;
+
+	const bool queue = g.queueInput();
+	g.queueInput(false);
+
+	const clock::time_point start = clock::now();
+	for(unsigned i=0; i<evs.size(); ++i){
+		if(realTime){
+			std::this_thread::sleep_until(start + std::chrono::duration_cast<clock::duration>(
+				std::chrono::duration<double>(times[i])));
+		}
+		clock::time_point t0 = clock::now();
+		g.postInput(evs[i]);
+		mLatency.add(std::chrono::duration<double>(clock::now() - t0).count());
+	}
+	mSeconds = std::chrono::duration<double>(clock::now() - start).count();
+
+	g.queueInput(queue);
+
+	ModelManager mm;
+	mm.copyModels(g.modelManager());
+	g.addModels(mm);
+	mStateHash = mm.stateHash();
+
+	return evs.size();
+}
+
+} // glv::
@@ -41,14 +41,29 @@ TimeScope::TimeScope(const glv::Rect& r, int frames, int chans)
 	//add(mPlot1D);
 }
 
-TimeScope::~TimeScope(){
-	delete[] mSamples;
-	mSamples = nullptr;
+TimeScope& TimeScope::sync(bool v){
+	mSync = v ? SYNC_FIND : SYNC_OFF;
+	return *this;
 }
 
 
-TimeScope& TimeScope::sync(bool v){
-	mSync = v ? SYNC_FIND : SYNC_OFF;
+// Keep the audio thread away from the queue. Blocks arriving meanwhile are
+// dropped, so only the caller may wait here, never the audio thread.
+void TimeScope::suspend(){
+	mSuspended = true;
+	while(mProducing){}
+}
+
+void TimeScope::resume(){
+	mSuspended = false;
+}
+
+
+TimeScope& TimeScope::historyDepth(int v){
+	suspend();
+	mHistory = v > 1 ? v : 1;
+	mQueue.resize(mHistory * mFrames * mChans);
+	resume();
 	return *this;
 }
 
@@ -57,9 +72,7 @@ void TimeScope::resize(int frames, int chans){
 
 	if(0 == frames || 0 == chans) return;
 
-	while(mLocked){} // wait for locks on data (from audio thread)
-
-	mLocked = true;
+	suspend();
 
 	range(-1, frames+1, 0); // offset by 1 so wave isn't hidden by borders
 	major(frames, 0);
@@ -82,85 +95,97 @@ void TimeScope::resize(int frames, int chans){
 	for(int i=0; i<chans; ++i){
 		mGraphs[i].data() = data().slice(frames*i, frames).shape(1, frames);
 	}
-	
-	delete[] mSamples;
-	mSamples = new float[frames*chans];
 
-	mLocked = false;
+	mFrames = frames;
+	mChans = chans;
+	mSamples.assign(frames*chans, 0.f);
+	mBlock.assign(frames*chans, 0.f);
+	mChunk.assign(frames*chans, 0.f);
+	mPrevFrame.assign(chans, 0.f);
+	mQueue.resize(mHistory * frames * chans);
+	mFill = 0;
+
+	resume();
 }
 
 
 void TimeScope::update(const float * buf, int bufFrames, int bufChans, bool interleaved){
 
 	if(!enabled(glv::Animate)) return;
-	if(!data().hasData() || !mSamples) return;
-	if(mLocked) return; // if data is locked, then just return without blocking
-
-	mLocked = true;
-
-	// copy new audio data into internal buffer
-	const int left = frames() - mFill;
-	int Nf = left < bufFrames ? left : bufFrames;
-	const int Nc = bufChans <= channels() ? bufChans : channels();
-
-	int M = interleaved ? bufChans : 1;
-
-	// search for sync point
-	if(SYNC_FIND == mSync){
-		//float maxSlope = 0;
-		for(int i=1; i<Nf-1; ++i){
-			float prev = buf[(i-1)*M];
-			float curr = buf[(i  )*M];
-			//float next = buf[i+1];
-			if(prev <= 0.f && curr > 0.f){
-				//float slope = curr - prev;
-				//float slope = -prev;
-				//float slope = (next-curr)-(curr-prev); slope *= slope;
-				//float slope = (next-prev)*0.5; slope *= slope;
-				//if(slope > maxSlope){
-				//	maxSlope = slope;
-					mSync = i-1; // sync point
-				//}
-				break;
+
+	mProducing = true;
+
+	if(mSuspended || !mFrames){
+		if(mFrames) mDropped.fetch_add(1, std::memory_order_relaxed);
+		mProducing = false;
+		return;
+	}
+
+	const int Nc = mChans;
+	const int Ncopy = bufChans <= Nc ? bufChans : Nc;
+
+	// only the newest frames of blocks larger than the queue can be kept
+	const int maxFrames = mQueue.capacity() / Nc;
+	const int first = bufFrames > maxFrames ? bufFrames - maxFrames : 0;
+
+	// drop whole blocks rather than tearing them
+	if(mQueue.writable() < (bufFrames - first) * Nc){
+		mDropped.fetch_add(1, std::memory_order_relaxed);
+		mProducing = false;
+		return;
+	}
+
+	// queue interleaved frames with the scope's channel count
+	for(int f0=first; f0<bufFrames; f0+=mFrames){
+		const int Nf = bufFrames-f0 < mFrames ? bufFrames-f0 : mFrames;
+		for(int j=0; j<Nf; ++j){
+			float * frame = &mBlock[j*Nc];
+			for(int i=0; i<Ncopy; ++i){
+				frame[i] = interleaved ? buf[(f0+j)*bufChans + i] : buf[i*bufFrames + f0 + j];
 			}
+			for(int i=Ncopy; i<Nc; ++i) frame[i] = 0.f;
 		}
-		if(SYNC_FIND == mSync) goto end;	// no sync found, so bail...
+		mQueue.write(&mBlock[0], Nf*Nc);
 	}
 
-	{
-		bool foundSync = mSync >= 0;
-		int less = foundSync ? mSync : 0;
+	mProducing = false;
+}
+
+
+void TimeScope::onAnimate(double dsec){
+	Plot::onAnimate(dsec);
 
-		if(interleaved){
-			for(int i=0; i<Nc; ++i){
-				for(int j=0; j<(Nf-less); ++j){
-					mSamples[frames()*i + j + mFill] = buf[i + (j+less)*bufChans];
+	const int Nc = mChans, Nf = mFrames;
+	if(!Nf) return;
+
+	// append a frame to plot samples, copying to draw buffer when full
+	auto put = [&](const float * frame){
+		for(int i=0; i<Nc; ++i) mSamples[Nf*i + mFill] = frame[i];
+		if(++mFill == Nf){
+			data().assignFromArray(&mSamples[0], Nf*Nc);
+			damage();
+			mFill = 0;
+			if(mSync > SYNC_OFF) mSync = SYNC_FIND;
+		}
+	};
+
+	int n;
+	while((n = mQueue.read(&mChunk[0], Nf*Nc) / Nc) > 0){
+		for(int j=0; j<n; ++j){
+			const float * frame = &mChunk[j*Nc];
+
+			// search for sync point, starting plot at the sample before it
+			if(SYNC_FIND == mSync){
+				if(mPrevFrame[0] <= 0.f && frame[0] > 0.f){
+					mSync = SYNC_WAIT;
+					put(&mPrevFrame[0]);
 				}
 			}
-		} else {
-			for(int i=0; i<Nc; ++i){
-				std::memcpy(
-					mSamples + frames()*i + mFill,
-					buf + bufFrames*i + less,
-					(Nf-less)*sizeof(*mSamples)
-				);
-			}
-		}
-		mFill += bufFrames - less;
-		if(foundSync) mSync = SYNC_WAIT;
-	}
 
-	// Is our sample buffer is full? If so, copy to draw buffer...
-	// Note that this is more or less thread-safe since we are merely assigning
-	// floating point values.
-	if(mFill >= frames()){
-		data().assignFromArray(mSamples, samples());
-		mFill = 0;
-		if(mSync > SYNC_OFF) mSync = SYNC_FIND;
+			if(SYNC_FIND != mSync) put(frame);
+			std::memcpy(&mPrevFrame[0], frame, Nc*sizeof(float));
+		}
 	}
-	
-	end:
-	mLocked = false;
 }
 
 
@@ -2,6 +2,7 @@
 	See COPYRIGHT file for authors and license information */
 
 #include "glv_texture.h"
+#include "glv_draw.h"
 #include <stdlib.h>
 
 namespace glv{
@@ -99,8 +100,8 @@ void Texture2::dealloc(){
 	}
 }
   
-void Texture2::begin() const { glBindTexture(GL_TEXTURE_2D, (GLuint)id()); }
-void Texture2::end() const { glBindTexture(GL_TEXTURE_2D, 0); }
+void Texture2::begin() const { if(!draw::Backend::current()) glBindTexture(GL_TEXTURE_2D, (GLuint)id()); }
+void Texture2::end() const { if(!draw::Backend::current()) glBindTexture(GL_TEXTURE_2D, 0); }
 
 Texture2& Texture2::bind(){ begin(); return *this; }
 
@@ -117,6 +118,7 @@ Texture2& Texture2::create(GLsizei width, GLsizei height, GLvoid * pixs){
 Texture2& Texture2::create(){ create(w,h, mPixels); return *this; }
 
 Texture2& Texture2::recreate(){
+	if(draw::Backend::current()) return *this;
 	destroy();
 	glGenTextures(1, &mID); //printf("%i\n", mID);
 	bind();
@@ -138,6 +140,9 @@ Texture2& Texture2::draw(
 	float ql, float qt, float qr, float qb,
 	float tl, float tt, float tr, float tb
 ){
+	if(draw::Backend::current()) return *this;
+	draw::flushBatch();
+
 	int Nv=4;
 	float verts[] = { ql,qt, ql,qb, qr,qt, qr,qb };
 	float texcs[] = { tl,tt, tl,tb, tr,tt, tr,tb };
@@ -150,6 +155,7 @@ Texture2& Texture2::draw(
 	glDrawArrays(GL_TRIANGLE_STRIP, 0, Nv);
 	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
 //	glDisableClientState(GL_VERTEX_ARRAY);
+	++draw::stats().calls; draw::stats().vertices += Nv; draw::stats().painted += Nv;
 	return *this;
 
 }
@@ -166,6 +172,7 @@ Texture2& Texture2::send(const GLvoid * pixels){
 							GLsizei width, GLsizei height,
 							GLenum format, GLenum type,
 							const GLvoid *pixels ) */
+	if(draw::Backend::current()) return *this;
 	sendParams();
 
 	int tx = mUpdateRegion[0];
@@ -159,8 +159,10 @@ bool TextView::onAssignData(Data& d, int ind1, int ind2){
 
 void TextView::onAnimate(double dsec){
 	Widget::onAnimate(dsec);
+	const bool on = mBlink < 0.5;
 	mBlink += dsec * 0.8;
 	if(mBlink >= 1) mBlink-=1;
+	if(enabled(Focused) && on != (mBlink < 0.5)) damage();	// cursor blinked
 }
 
 void TextView::onDraw(GLV& g){
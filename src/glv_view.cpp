@@ -2,16 +2,26 @@
 	See COPYRIGHT file for authors and license information */
 
 #include <algorithm>
+#include <cmath>
 #include <ctype.h>		// isalnum
 #include "glv_core.h"
+#include "glv_profiler.h"
 
 namespace glv{
 
+// Application and window events are only broadcast to onEvent() on request
+static unsigned defaultListenMask(){
+	using namespace Event;
+	return ~(bit(Quit) | bit(WindowCreate) | bit(WindowDestroy) | bit(WindowResize) | bit(WindowShow) | bit(WindowHide));
+}
+
 #define VIEW_INIT\
 	Notifier(), SmartObject<View>(),\
 	parent(0), child(0), sibling(0), \
+	mEventHandlerMask(0), mListenMask(defaultListenMask()), mSubtreeEventMask(~0u), \
 	mFlags(Visible | DrawBack | DrawBorder | CropSelf | FocusHighlight | FocusToTop | HitTest | Controllable | Animate), \
-	mStyle(&(Style::standard())), mAnchorX(0), mAnchorY(0), mStretchX(0), mStretchY(0)
+	mStyle(&(Style::standard())), mAnchorX(0), mAnchorY(0), mStretchX(0), mStretchY(0), \
+	mDamaged(true)
 
 View::View(const Rect& rect, Place::t anch)
 :	Rect(rect), VIEW_INIT
@@ -79,6 +89,10 @@ View& View::add(View& newChild){
 		while(lastChild->sibling) lastChild = lastChild->sibling;
 		lastChild->sibling = &newChild;
 	}
+
+	if(mSpatialIndex.created()) mSpatialIndex().insert(newChild);
+
+	treeModified();
 	return *this;
 }
 
@@ -97,6 +111,8 @@ void View::remove(){
 	// note that this doesn't delete the view, it just removes it from the hierarchy
 	if(parent && parent->child){	// sanity check: don't try to remove a window or an unattached view
 
+		if(parent->mSpatialIndex.created()) parent->mSpatialIndex().remove(*this);
+
 		// re-patch parent's child?
 		if(parent->child == this){
 			// I'm my parent's first child 
@@ -119,6 +135,7 @@ void View::remove(){
 			}
 		}
 		
+		parent->treeModified();
 		parent=0; sibling=0; // no more parent or sibling, but child is still valid
 	}
 
@@ -127,6 +144,13 @@ void View::remove(){
 }
 
 
+void View::treeModified(){
+	for(View * v = this; v; v = v->parent){
+		if(GLV * g = dynamic_cast<GLV *>(v)) ++g->mTreeRevision;
+	}
+}
+
+
 void View::makeLastSibling(){
 	if(parent && sibling){
 //		View * p = parent;
@@ -236,9 +260,11 @@ View& View::addHandler(DrawHandler& v){
 }
 
 View& View::addHandler(Event::t e, EventHandler& h){
-	mEventHandlersMap(); // create map, if not already created
 	if(!hasEventHandler(e, h)){
-		mEventHandlersMap()[e].push_back(&h);
+		EventHandlerEntry entry = { e, &h };
+		mEventHandlers.push_back(entry);
+		mEventHandlerMask |= Event::bit(e);
+		eventsModified();
 	}
 	return *this;
 }
@@ -253,34 +279,60 @@ void View::removeHandler(DrawHandler& v){
 
 void View::removeHandler(Event::t e, EventHandler& h){
 	if(hasEventHandlers(e)){
-		EventHandlers& hs = mEventHandlersMap()[e];
-		EventHandlers::iterator it = hs.begin();
-		while(it != hs.end()){
-			if(*it == &h) hs.erase(it++);
-			else ++it;
+		unsigned mask = 0, j = 0;
+		for(unsigned i=0; i<mEventHandlers.size(); ++i){
+			const EventHandlerEntry& entry = mEventHandlers[i];
+			if(entry.type == e && entry.handler == &h) continue;
+			mask |= Event::bit(entry.type);
+			mEventHandlers[j++] = entry;
 		}
+		mEventHandlers.resize(j);
+		mEventHandlerMask = mask;
+		eventsModified();
 	}
 }
 
 bool View::hasEventHandler(Event::t e, const EventHandler& h) const {
 	if(hasEventHandlers(e)){
-		const EventHandlers& hs = mEventHandlersMap().find(e)->second;
-		return find(hs.begin(), hs.end(), &h) != hs.end();
+		for(unsigned i=0; i<mEventHandlers.size(); ++i){
+			const EventHandlerEntry& entry = mEventHandlers[i];
+			if(entry.type == e && entry.handler == &h) return true;
+		}
 	}
 	return false;
 }
 
 bool View::hasEventHandlers(Event::t e) const {
-	return mEventHandlersMap.created() && 0!=mEventHandlersMap().count(e);
+	return 0 != numEventHandlers(e);
 }
 
 int View::numEventHandlers(Event::t e) const {
-	if(hasEventHandlers(e)){
-		const EventHandlersMap& handlers = mEventHandlersMap();
-		const EventHandlersMap::const_iterator it = handlers.find(e);
-		return it != handlers.end() ? it->second.size() : 0;
+	int n = 0;
+	if(mEventHandlerMask & Event::bit(e)){
+		for(unsigned i=0; i<mEventHandlers.size(); ++i) n += mEventHandlers[i].type == e;
 	}
-	return 0;
+	return n;
+}
+
+View& View::listen(Event::t e, bool v){
+	unsigned mask = v ? mListenMask | Event::bit(e) : mListenMask & ~Event::bit(e);
+	if(mask != mListenMask){
+		mListenMask = mask;
+		eventsModified();
+	}
+	return *this;
+}
+
+void View::eventsModified(){
+	for(View * v = this; v; v = v->parent){
+		if(GLV * g = dynamic_cast<GLV *>(v)) ++g->mEventRevision;
+	}
+}
+
+unsigned View::updateSubtreeEventMask(){
+	unsigned mask = mEventHandlerMask | mListenMask;
+	for(View * v = child; v; v = v->sibling) mask |= v->updateSubtreeEventMask();
+	return mSubtreeEventMask = mask;
 }
 
 
@@ -340,10 +392,11 @@ void View::constrainWithinParent(){
 //		t = t < 0 ? 0 : t > (parent->h - h) ? (parent->h - h) : t;
 
 		space_t d = w < 20 ? w : 20;	// allow this many pixels to remain on a side
-		l = l < d - w ? d - w : l > parent->w - d ? parent->w - d : l;
+		space_t nl = l < d - w ? d - w : l > parent->w - d ? parent->w - d : l;
 		
 		d = h < 20 ? h : 20;
-		t = t < d - h ? d - h : t > parent->h - d ? parent->h - d : t;
+		space_t nt = t < d - h ? d - h : t > parent->h - d ? parent->h - d : t;
+		pos(nl, nt);	// keeps parent's spatial index up to date
 	}
 	rectifyGeometry();
 }
@@ -352,6 +405,8 @@ void View::constrainWithinParent(){
 void View::doDraw(GLV& g){
 	using namespace glv::draw;
 
+	FrameProfiler::Scope profile(g.profiler(), *this, FrameProfiler::Draw);
+
 	if(enabled(DrawBack)){
 		color(colors().back);
 		rectangle(0,0, w,h);
@@ -365,13 +420,16 @@ void View::doDraw(GLV& g){
 	}
 
 	bool drawNext = true;
-	DrawHandlers::iterator it = mDrawHandlers.begin();
-	while(it != mDrawHandlers.end()){
-		DrawHandlers::iterator itnext = ++it; --it;
-		g.graphicsData().reset();
-		drawNext = (*it)->onDraw(*this, g);
-		if(!drawNext) break;
-		it = itnext;
+	if(!mDrawHandlers.empty()){
+		FrameProfiler::Scope profileHandlers(g.profiler(), *this, FrameProfiler::DrawHandlers);
+		DrawHandlers::iterator it = mDrawHandlers.begin();
+		while(it != mDrawHandlers.end()){
+			DrawHandlers::iterator itnext = ++it; --it;
+			g.graphicsData().reset();
+			drawNext = (*it)->onDraw(*this, g);
+			if(!drawNext) break;
+			it = itnext;
+		}
 	}
 
 	if(drawNext){
@@ -420,7 +478,13 @@ View * View::findTarget(space_t &x, space_t &y){
 		View * match = 0;
 		
 		space_t cx = rx, cy = ry;
-		
+
+		// Use index of siblings if there is one
+		if(n->mSpatialIndex.created()){
+			match = n->mSpatialIndex().find(x,y);
+			sib = 0;
+		}
+
 		// Iterate through siblings
 		while(sib){
 			if(sib->visible() && sib->containsPoint(x,y)){
@@ -480,8 +544,7 @@ void View::fit(bool moveChildren){
 		if(moveChildren){
 			View * v = child;
 			while(v){
-				v->l -= r.l;
-				v->t -= r.t;
+				v->translate(-r.l, -r.t);
 				v = v->sibling;
 			}
 			extent(r.width(), r.height());
@@ -503,11 +566,19 @@ void View::focused(bool b){
 			v = v->parent;
 		} while(v && v->parent);
 	}
+	damage();
 	notify(this, Update::Focus);
 }
 
 
 Font& View::font(){
+	// switch to the kind of font requested by the style, keeping its settings
+	bool atlas = style().atlasFont;
+	if(atlas != (mFont.created() && dynamic_cast<AtlasFont *>(&mFont()))){
+		Font * f = atlas ? new AtlasFont : new Font;
+		if(mFont.created()) *f = mFont();
+		mFont.set(f);
+	}
 	return mFont();
 }
 
@@ -580,7 +651,14 @@ View& View::name(const std::string& v){
 }
 
 
+void View::onNotify(void * sender, Update::t type, void * data){
+	if(Update::Value == type) damage();
+}
+
+
 void View::onResizeRect(space_t dx, space_t dy){
+	if(parent && parent->mSpatialIndex.created()) parent->mSpatialIndex().update(*this);
+	damage();
 	onResize(dx,dy);
 	// Move/resize anchored children
 	// This will recursively call onResize's through the entire descendency tree
@@ -592,6 +670,10 @@ void View::onResizeRect(space_t dx, space_t dy){
 }
 
 
+void View::onMoveRect(space_t dx, space_t dy){
+	if(parent && parent->mSpatialIndex.created()) parent->mSpatialIndex().update(*this);
+}
+
 View& View::pos(Place::t p){ return pos(p,0,0); }
 
 View& View::pos(Place::t p, space_t x, space_t y){
@@ -726,13 +808,19 @@ bool View::showing() const {
 }
 
 
+View& View::spatialIndex(bool v){
+	if(v) mSpatialIndex().build(*this);
+	else mSpatialIndex.clear();
+	return *this;
+}
+
 View& View::stretch(space_t mx, space_t my){ mStretchX=mx; mStretchY=my; return *this; }
 
 
 View& View::style(Style * style){
 	mStyle->smartDelete();
 	mStyle = style;
-	return *this;
+	return damage();
 }
 
 
@@ -837,4 +925,144 @@ Rect View::visibleRegion() const {
 	return r;
 }
 
+
+SpatialIndex::SpatialIndex()
+:	mParent(0), mCellW(0), mCellH(0), mOrder(0), mBuiltSize(0)
+{}
+
+void SpatialIndex::build(View& parent){
+	mEntries.clear();
+	mCells.clear();
+	mLarge.clear();
+	mParent = &parent;
+	mOrder = 0;
+
+	// Cells are the average size of the children
+	space_t sw=0, sh=0;
+	int n=0;
+	for(View * v = parent.child; v; v = v->sibling){
+		if(v->w > 0 && v->h > 0 && v->w < 1e30 && v->h < 1e30){
+			sw += v->w; sh += v->h; ++n;
+		}
+	}
+	mCellW = n ? sw/n : 0;
+	mCellH = n ? sh/n : 0;
+	mBuiltSize = n;
+
+	for(View * v = parent.child; v; v = v->sibling){
+		Entry& e = mEntries[v];
+		e.order = ++mOrder;
+		bin(*v, e);
+	}
+}
+
+void SpatialIndex::insert(View& v){
+	// Rebuild when the number of children has grown enough that the
+	// average child size may have changed
+	if(mParent && ((0 == mCellW && v.w > 0 && v.h > 0) || int(mEntries.size()) >= 2*mBuiltSize + 16)){
+		build(*mParent);
+		return;
+	}
+	Entry& e = mEntries[&v];
+	e.order = ++mOrder;
+	bin(v, e);
+}
+
+void SpatialIndex::remove(View& v){
+	auto it = mEntries.find(&v);
+	if(it != mEntries.end()){
+		unbin(v, it->second);
+		mEntries.erase(it);
+	}
+}
+
+void SpatialIndex::update(View& v){
+	auto it = mEntries.find(&v);
+	if(it != mEntries.end()){
+		Entry e = it->second;
+		cellRange(v, e);
+		const Entry& o = it->second;
+		if(e.x0!=o.x0 || e.y0!=o.y0 || e.x1!=o.x1 || e.y1!=o.y1){
+			unbin(v, o);
+			bin(v, it->second);
+		}
+	}
+}
+
+View * SpatialIndex::find(space_t x, space_t y) const {
+	View * match = 0;
+	unsigned order = 0;
+
+	auto test = [&](const Bin& b){
+		for(const auto& p : b){
+			if(p.first > order && p.second->visible() && p.second->containsPoint(x,y)){
+				match = p.second;
+				order = p.first;
+			}
+		}
+	};
+
+	test(mLarge);
+
+	if(mCellW > 0){
+		space_t cx = std::floor(x/mCellW), cy = std::floor(y/mCellH);
+		if(std::abs(cx) < 1e9 && std::abs(cy) < 1e9){
+			auto it = mCells.find(key(int(cx), int(cy)));
+			if(it != mCells.end()) test(it->second);
+		}
+	}
+	return match;
+}
+
+// Get cells covered by View; returns false if it belongs in the large list
+bool SpatialIndex::cellRange(const View& v, Entry& e) const {
+	e.x0 = e.y0 = 0;
+	e.x1 = e.y1 = -1;
+	if(mCellW <= 0) return false;
+
+	// Right and bottom edges are inclusive, as in Rect::containsPoint
+	space_t x0 = std::floor(v.left()/mCellW), x1 = std::floor(v.right() /mCellW);
+	space_t y0 = std::floor(v.top() /mCellH), y1 = std::floor(v.bottom()/mCellH);
+	if(!(std::abs(x0) < 1e9 && std::abs(x1) < 1e9 && std::abs(y0) < 1e9 && std::abs(y1) < 1e9)) return false;
+	if((x1-x0+1)*(y1-y0+1) > 64) return false;
+
+	e.x0 = x0; e.x1 = x1;
+	e.y0 = y0; e.y1 = y1;
+	return true;
+}
+
+void SpatialIndex::bin(View& v, Entry& e){
+	if(cellRange(v, e)){
+		for(int j=e.y0; j<=e.y1; ++j){
+		for(int i=e.x0; i<=e.x1; ++i){
+			mCells[key(i,j)].emplace_back(e.order, &v);
+		}}
+	}
+	else{
+		mLarge.emplace_back(e.order, &v);
+	}
+}
+
+void SpatialIndex::unbin(View& v, const Entry& e){
+	auto erase = [&](Bin& b){
+		for(auto& p : b){
+			if(p.second == &v){ p = b.back(); b.pop_back(); break; }
+		}
+	};
+
+	if(e.x1 < e.x0){
+		erase(mLarge);
+	}
+	else{
+		for(int j=e.y0; j<=e.y1; ++j){
+		for(int i=e.x0; i<=e.x1; ++i){
+			auto it = mCells.find(key(i,j));
+			if(it != mCells.end()){
+				erase(it->second);
+				if(it->second.empty()) mCells.erase(it);
+			}
+		}}
+	}
+}
+
 } // glv::
@@ -42,6 +42,8 @@ void View3D::onDraw(GLV& g){
 	if(ax > top->w || ay > top->h) return;
 
 
+	flushBatch();
+
 	// Create viewport just at widget location
 	viewport((int)ax, (int)ay, (int)w, (int)h);
 
@@ -77,7 +79,7 @@ void View3D::onDraw(GLV& g){
 	
 	push(ModelView);
 	identity();
-	glMultMatrixf(modelView());
+	multMatrix(modelView());
 
 	// Do all 3D drawing
 	onDraw3D(g);
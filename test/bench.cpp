@@ -0,0 +1,574 @@
+/*	Graphics Library of Views (GLV) - GUI Building Toolkit
+	See COPYRIGHT file for authors and license information */
+
+/*
+Microbenchmarks of core hot paths
+
+Run with 'make bench'. No window or OpenGL context is needed; drawing
+commands go to a backend that discards them, unless a benchmark rasterizes
+them in software.
+
+Usage: bench [-o file] [-t seconds] [filter]
+
+	-o file		write JSON results to file instead of stdout
+	-t seconds	minimum duration of each timing sample (default 0.02)
+	filter		only run benchmarks whose name contains this string
+
+Each benchmark is timed over several samples. The JSON output lists, for each
+benchmark and parameter set, the median and minimum time per operation in
+nanoseconds. Progress is printed to stderr.
+*/
+
+#include "glv.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace glv;
+
+volatile double sink; // defeats dead code elimination of results
+
+
+class Bench{
+public:
+
+	typedef std::vector<std::pair<std::string, double>> Params;
+
+	Bench(double sampleSec, const char * filter)
+	:	mSampleSec(sampleSec), mFilter(filter ? filter : ""){}
+
+	/// Returns whether the named benchmark is selected by the filter
+	bool selected(const std::string& name) const {
+		return mFilter.empty() || name.find(mFilter) != std::string::npos;
+	}
+
+	/// Time function, adding result for the given name and parameters
+	template <class F>
+	void run(const std::string& name, const Params& params, F f){
+		if(!selected(name)) return;
+
+		// find number of iterations filling one sample
+		long iters = 1;
+		for(;;){
+			double t = time(f, iters);
+			if(t >= mSampleSec || iters >= (1L<<30)) break;
+			double grow = t > 0 ? mSampleSec*1.2 / t : 16;
+			iters = long(iters * std::min(std::max(grow, 2.), 16.));
+		}
+
+		const int numSamples = 5;
+		double ns[numSamples];
+		for(auto& v : ns) v = time(f, iters) * 1e9 / iters;
+		std::sort(ns, ns+numSamples);
+
+		Result r = { name, params, iters, ns[numSamples/2], ns[0] };
+		mResults.push_back(r);
+
+		fprintf(stderr, "%-24s", name.c_str());
+		for(auto& p : params) fprintf(stderr, " %s=%g", p.first.c_str(), p.second);
+		fprintf(stderr, "\t%12.1f ns\n", r.median);
+	}
+
+	/// Write results as JSON
+	void writeJSON(FILE * fp) const {
+		const char * simd[] = {"none", "sse2", "avx2"};
+		fprintf(fp, "{\n");
+		fprintf(fp, "\t\"suite\": \"glv\",\n");
+		fprintf(fp, "\t\"platform\": \"%s\",\n", GLV_PLATFORM);
+		fprintf(fp, "\t\"simd\": \"%s\",\n", simd[Data::simd()]);
+		fprintf(fp, "\t\"sample_seconds\": %g,\n", mSampleSec);
+		fprintf(fp, "\t\"results\": [");
+		for(unsigned i=0; i<mResults.size(); ++i){
+			const Result& r = mResults[i];
+			fprintf(fp, "%s\n\t\t{\"name\": \"%s\", \"params\": {", i ? "," : "", r.name.c_str());
+			for(unsigned j=0; j<r.params.size(); ++j){
+				fprintf(fp, "%s\"%s\": %g", j ? ", " : "", r.params[j].first.c_str(), r.params[j].second);
+			}
+			fprintf(fp, "}, \"iterations\": %ld, \"ns_per_op\": %.2f, \"ns_per_op_min\": %.2f}",
+				r.iters, r.median, r.min);
+		}
+		fprintf(fp, "\n\t]\n}\n");
+	}
+
+private:
+	struct Result{
+		std::string name;
+		Params params;
+		long iters;
+		double median, min;
+	};
+
+	double mSampleSec;
+	std::string mFilter;
+	std::vector<Result> mResults;
+
+	template <class F>
+	static double time(F& f, long iters){
+		auto t0 = std::chrono::steady_clock::now();
+		for(long i=0; i<iters; ++i) f();
+		auto t1 = std::chrono::steady_clock::now();
+		return std::chrono::duration<double>(t1-t0).count();
+	}
+};
+
+
+// Drawing backend that discards all commands
+struct NullBackend : public draw::Backend{
+	void paint(int prim, const float * verts, int dim, const Color * cols, const index_t * indices, int num) override {}
+};
+
+
+// Build tree of n Views; each View tiles its area with up to 8 children
+void buildTree(View& root, int n){
+	std::vector<View *> level(1, &root);
+	int count = 1;
+	while(count < n){
+		std::vector<View *> next;
+		for(View * p : level){
+			const space_t w = p->w/4, h = p->h/2;
+			for(int i=0; i<8 && count<n; ++i, ++count){
+				View * v = new View(Rect((i%4)*w, (i/4)*h, w, h));
+				*p << v;
+				next.push_back(v);
+			}
+		}
+		level.swap(next);
+	}
+}
+
+
+void benchViews(Bench& b){
+	if(!b.selected("traverseDepth") && !b.selected("findTarget") && !b.selected("broadcastEvent")) return;
+
+	for(int n=100; n<=100000; n*=10){
+		GLV root(1e6, 1e6);
+		buildTree(root, n);
+		Bench::Params p = {{"nodes", double(n)}};
+
+		struct Count : public View::TraversalAction{
+			int n = 0;
+			bool operator()(View * v, int depth){ ++n; return true; }
+		};
+		b.run("traverseDepth", p, [&]{
+			Count c; root.traverseDepth(c); sink = c.n;
+		});
+
+		// fixed sequence of pseudo-random points
+		std::vector<space_t> pts(512);
+		unsigned s = 1;
+		for(auto& v : pts){ s = s*1664525 + 1013904223; v = (s>>8) % 1000000; }
+		int i = 0;
+		b.run("findTarget", p, [&]{
+			space_t x = pts[i], y = pts[i+1];
+			i = (i+2) & 511;
+			sink = root.findTarget(x, y)->l;
+		});
+	}
+
+	// flat grid of children, as in a large panel of widgets
+	for(int n=100; n<=100000; n*=10){
+		GLV root(1000, 1000);
+		const int cols = int(std::sqrt(double(n)));
+		const space_t d = 1000./cols;
+		for(int i=0; i<n; ++i) root << new View(Rect((i%cols)*d, (i/cols)*d, d, d));
+
+		std::vector<space_t> pts(512);
+		unsigned s = 1;
+		for(auto& v : pts){ s = s*1664525 + 1013904223; v = (s>>8) % 1000; }
+
+		for(int indexed=0; indexed<2; ++indexed){
+			root.spatialIndex(indexed);
+			int i = 0;
+			b.run("findTarget/flat", {{"children", double(n)}, {"indexed", double(indexed)}}, [&]{
+				space_t x = pts[i], y = pts[i+1];
+				i = (i+2) & 511;
+				sink = root.findTarget(x, y)->l;
+			});
+		}
+	}
+
+	// window events broadcast to a tree with a handler on one View in 100
+	for(int n=100; n<=100000; n*=10){
+		GLV root(1e6, 1e6);
+		buildTree(root, n);
+		struct Handler : public EventHandler{
+			bool onEvent(View& v, GLV& g) override { sink = sink + 1; return true; }
+		} h;
+		struct Handle : public View::TraversalAction{
+			EventHandler& h; int n = 0;
+			Handle(EventHandler& v): h(v){}
+			bool operator()(View * v, int depth){
+				if(0 == n++ % 100) v->addHandler(Event::WindowCreate, h);
+				return true;
+			}
+		} handle(h);
+		root.traverseDepth(handle);
+
+		// Views listening to the event in onEvent() or only through handlers
+		for(int listen=1; listen>=0; --listen){
+			struct Listen : public View::TraversalAction{
+				bool v;
+				Listen(bool l): v(l){}
+				bool operator()(View * w, int depth){ w->listen(Event::WindowCreate, v); return true; }
+			} l(listen);
+			root.traverseDepth(l);
+			b.run("broadcastEvent", {{"nodes", double(n)}, {"listen", double(listen)}}, [&]{
+				root.broadcastEvent(Event::WindowCreate);
+			});
+		}
+
+		// the tree of another GLV changing between broadcasts
+		GLV other;
+		View extra;
+		b.run("broadcastEvent/otherTree", {{"nodes", double(n)}}, [&]{
+			other << extra;
+			extra.remove();
+			root.broadcastEvent(Event::WindowCreate);
+		});
+	}
+}
+
+
+void benchInput(Bench& b){
+	if(!b.selected("GLV::postInput") && !b.selected("InputReplay::run")) return;
+
+	// a frame of 100 drag events over a deep tree of Views
+	GLV root(1000, 1000);
+	buildTree(root, 10000);
+	View * target = &root;
+	while(target->child) target = target->child;
+	const int x = target->l + 1, y = target->t + 1;
+
+	for(int queue=0; queue<2; ++queue){
+		root.queueInput(queue);
+		InputEvent down(Event::MouseDown);
+		down.x = x; down.y = y;
+		root.postInput(down);
+		root.dispatchInput();
+		b.run("GLV::postInput", {{"events", 100}, {"queue", double(queue)}}, [&]{
+			InputEvent e(Event::MouseDrag);
+			for(int i=0; i<100; ++i){
+				e.x = x + (i&1); e.y = y;
+				root.postInput(e);
+			}
+			root.dispatchInput();
+		});
+	}
+
+	// the same frame recorded and replayed without queueing
+	root.queueInput(false);
+	InputRecorder rec;
+	rec.attach(root);
+	InputEvent e(Event::MouseDrag);
+	for(int i=0; i<100; ++i){
+		e.x = x + (i&1); e.y = y;
+		root.postInput(e);
+	}
+	rec.detach();
+	InputReplay replay(rec.log());
+	b.run("InputReplay::run", {{"events", 100}, {"bytes", double(rec.log().size())}}, [&]{
+		sink = replay.run(root);
+	});
+}
+
+void benchFrame(Bench& b){
+	if(!b.selected("GLV::drawWidgets")) return;
+
+	// a full frame of a tree of Views, with and without profiling
+	GLV root(1000, 1000);
+	buildTree(root, 1000);
+	FrameProfiler prof;
+	for(int profile=0; profile<2; ++profile){
+		if(profile) prof.attach(root);
+		b.run("GLV::drawWidgets", {{"nodes", 1000}, {"profile", double(profile)}}, [&]{
+			root.drawWidgets(1000, 1000, 0.01);
+		});
+	}
+}
+
+void benchData(Bench& b){
+	const int N = 4096;
+	Data src[4];
+	const Data * D[4];
+	for(int k=0; k<4; ++k){
+		src[k] = Data(Data::FLOAT, N);
+		for(int i=0; i<N; ++i) src[k].assign(double(i*(k+1)) / N, i);
+		D[k] = &src[k];
+	}
+	Bench::Params p = {{"size", double(N)}};
+
+	b.run("Data::copy", p, [&]{ Data d = src[0]; sink = d.size(); });
+	b.run("Data::slice", p, [&]{ sink = src[0].slice(N/4, N/2).size(); });
+	b.run("Data::clone", p, [&]{ Data d = src[0]; d.clone(); sink = d.size(); });
+
+	// kernels for each instruction set
+	const Data::SIMD best = Data::simd();
+	for(int s=Data::SIMD_NONE; s<=best; ++s){
+		Data::simd(Data::SIMD(s));
+		Bench::Params ps = {{"size", double(N)}, {"simd", double(s)}};
+		double c[] = {0.25, 0.25, 0.25, 0.25};
+		Data dst(Data::FLOAT, N), same = src[1];
+		same.clone();
+		b.run("Data::mix2", ps, [&]{ dst.mix<2>(D, c); });
+		b.run("Data::mix4", ps, [&]{ dst.mix<4>(D, c); });
+		b.run("Data::add", ps, [&]{ dst += src[0]; });
+		b.run("Data::equal", ps, [&]{ sink = (same == src[1]); });
+	}
+	Data::simd(best);
+}
+
+
+void benchSnapshots(Bench& b){
+	if(!b.selected("snapshot")) return;
+
+	// 32 arrays and 32 scalars
+	const int M = 32, N = 256;
+	std::vector<float> arrays(M*N);
+	std::vector<double> scalars(M);
+	ModelManager mm;
+	for(int i=0; i<M; ++i){
+		mm.addVar("array" + std::to_string(i), &arrays[i*N], N);
+		mm.addVar("scalar" + std::to_string(i), scalars[i]);
+	}
+	const char * names[] = {"a", "b", "c", "d"};
+	for(int k=0; k<4; ++k){
+		for(unsigned i=0; i<arrays.size(); ++i) arrays[i] = float(i*(k+1)) / arrays.size();
+		for(int i=0; i<M; ++i) scalars[i] = i*k;
+		mm.saveSnapshot(names[k]);
+	}
+	Bench::Params p = {{"models", 2.*M}, {"array_size", double(N)}};
+
+	b.run("snapshot::save", p, [&]{ mm.saveSnapshot("e"); });
+	b.run("snapshot::load", p, [&]{ mm.loadSnapshot("a"); });
+	b.run("snapshot::mix2", p, [&]{ mm.loadSnapshot("a", "b", 0.3, 0.7); });
+	b.run("snapshot::mix4", p, [&]{ mm.loadSnapshot("a", "b", "c", "d", 0.1, 0.2, 0.3, 0.4); });
+
+	std::string text;
+	b.run("snapshot::toString", p, [&]{ mm.snapshotsToString(text); });
+	b.run("snapshot::fromString", p, [&]{ ModelManager m; m.snapshotsFromString(text); });
+
+	const char * path = "bench_snapshots.glvs";
+	b.run("snapshot::toBinaryFile", p, [&]{ sink = mm.snapshotsToBinaryFile(path); });
+	b.run("snapshot::fromBinaryFile", p, [&]{ ModelManager m; sink = m.snapshotsFromBinaryFile(path); });
+	remove(path);
+}
+
+
+void benchFont(Bench& b){
+	Font font(12);
+	GraphicsData gd;
+	const char * line = "The quick brown fox jumps over the lazy dog 0123456789";
+	std::string para;
+	for(int i=0; i<16; ++i){ para += line; para += "\n"; }
+
+	for(int cached=0; cached<2; ++cached){
+		font.cacheText(cached);
+		b.run("Font::render", {{"chars", double(strlen(line))}, {"cached", double(cached)}}, [&]{ font.render(gd, line); });
+		b.run("Font::render", {{"chars", double(para.size())}, {"cached", double(cached)}}, [&]{ font.render(gd, para.c_str()); });
+	}
+}
+
+
+void benchPaint(Bench& b){
+	{
+		const int n = 1<<16;
+		std::vector<Color> cs(n);
+		std::vector<Color8> c8s(n);
+		for(int i=0; i<n; ++i) cs[i] = HSV(i/double(n));
+		b.run("toColor8", {{"colors", double(n)}}, [&]{ toColor8(&c8s[0], &cs[0], n); });
+		b.run("toColor", {{"colors", double(n)}}, [&]{ toColor(&cs[0], &c8s[0], n); });
+	}
+
+	// scratch buffers grown from empty, drawing from the heap and from an arena
+	{
+		const int n = 4096;
+		FrameArena arena;
+		for(int useArena=0; useArena<2; ++useArena){
+			b.run("Buffer::append", {{"elements", double(n)}, {"arena", double(useArena)}}, [&]{
+				{
+					Buffer<Point2> buf;
+					if(useArena) buf.arena(&arena);
+					for(int i=0; i<n; ++i) buf.append(Point2(i, i));
+					sink = buf[n-1].x;
+				}
+				arena.reset();
+			});
+		}
+	}
+
+	// static geometry rasterized without a cache, with a hashed cache and with a stamped cache
+	for(int n=1<<10; n<=1<<18; n<<=4){
+		GraphicsData gd;
+		for(int i=0; i<n; ++i) gd.addVertex(i%1000, i/1000);
+		draw::Rasterizer ras(1000, n/1000 + 1);
+		ras.begin();
+		draw::enter2D(ras.width(), ras.height());
+		for(int mode=0; mode<3; ++mode){
+			gd.cache(mode > 0).stamp(mode > 1);
+			b.run("draw::paint/cache", {{"vertices", double(n)}, {"mode", double(mode)}}, [&]{
+				draw::paint(draw::Points, gd);
+			});
+		}
+		ras.end();
+	}
+}
+
+
+void benchPlots(Bench& b){
+	GraphicsData gd;
+
+	for(int n=1024; n<=65536; n*=8){
+		Data d(Data::FLOAT, 1, n);
+		for(int i=0; i<n; ++i) d.assign(sin(i*0.01), 0, i);
+		PlotFunction1D plot;
+		int sizes[] = {n, 1, 1};
+		b.run("PlotFunction1D::onMap", {{"points", double(n)}}, [&]{
+			Indexer ind(sizes); gd.reset(); plot.onMap(gd, d, ind);
+		});
+	}
+
+	// panning across a long recording in a plot 1000 pixels wide
+	struct Panned : public PlotFunction1D{
+		void view(double min, double max, float pixels){
+			mVisible[0].endpoints(min, max); mVisiblePixels[0] = pixels;
+		}
+	};
+	for(int n=1<<16; n<=1<<22; n<<=3){
+		Data d(Data::FLOAT, 1, n);
+		for(int i=0; i<n; ++i) d.assign(sin(i*0.01), 0, i);
+		int sizes[] = {n, 1, 1};
+		for(int decimate=0; decimate<2; ++decimate){
+			Panned plot;
+			plot.decimate(decimate);
+			int x = 0;
+			b.run("PlotFunction1D::onMap/pan", {{"points", double(n)}, {"decimate", double(decimate)}}, [&]{
+				plot.view(x, x + n/2, 1000);
+				x = (x + n/1000) % (n/2);
+				Indexer ind(sizes); gd.reset(); plot.onMap(gd, d, ind);
+			});
+		}
+	}
+
+	for(int n=64; n<=512; n*=2){
+		Data d(Data::FLOAT, 1, n, n);
+		for(int i=0; i<d.size(); ++i) d.assign(sin(i*0.01), i);
+		PlotDensity plot;
+		int sizes[] = {n, n, 1};
+		b.run("PlotDensity::onMap", {{"width", double(n)}, {"height", double(n)}}, [&]{
+			Indexer ind(sizes); gd.reset(); plot.onMap(gd, d, ind);
+		});
+	}
+
+	// scrolling spectrogram with one new column per frame
+	struct Spectrogram : public PlotDensity{
+		void map(GraphicsData& gd, const Data& d){
+			int* u = mUpdateRegion;
+			int ends[] = { u[0]+u[2] + (u[2]<0 ? d.size(1)+1 : 0), u[1]+u[3] + (u[3]<0 ? d.size(2)+1 : 0), d.size(3) };
+			int starts[] = { u[0], u[1], 0 };
+			Indexer ind(ends, starts);
+			gd.reset(); onMap(gd, d, ind);
+		}
+	};
+	{
+		const int w = 2048, h = 512;
+		Data d(Data::FLOAT, 1, w, h);
+		for(int i=0; i<d.size(); ++i) d.assign(sin(i*0.01), i);
+		for(int hint=0; hint<2; ++hint){
+			Spectrogram plot;
+			int x = 0;
+			b.run("PlotDensity::onMap/spectrogram", {{"width", double(w)}, {"height", double(h)}, {"hint", double(hint)}}, [&]{
+				for(int j=0; j<h; ++j) d.assign(cos(x*0.1 + j), 0, x, j);
+				if(hint) plot.updateRegion(x, 0, 1, h);
+				plot.map(gd, d);
+				x = (x+1) % w;
+			});
+		}
+	}
+
+	// overview of many traces, mapped serially and in parallel
+	{
+		const int traces = 64, n = 1<<14;
+		GLV top(1000, 800);
+		Plot * plot = new Plot(Rect(1000, 800));
+		top << plot;
+		std::vector<PlotFunction1D> fs(traces);
+		for(int k=0; k<traces; ++k){
+			fs[k].data().resize(Data::FLOAT, 1, n);
+			for(int i=0; i<n; ++i) fs[k].data().assign(sin(i*0.01 + k), 0, i);
+			plot->add(fs[k]);
+		}
+		int threads = Plot::mapThreads();
+		for(int parallel=0; parallel<2; ++parallel){
+			plot->parallelMap(parallel);
+			b.run("Plot::onDraw/traces", {{"traces", double(traces)}, {"points", double(n)}, {"threads", double(parallel ? threads+1 : 1)}}, [&]{
+				top.drawGLV(1000, 800, 0);
+			});
+		}
+	}
+}
+
+
+void benchNotifier(Bench& b){
+	for(int n=1; n<=1000; n*=10){
+		Notifier notifier;
+		std::vector<int> counts(n);
+		for(auto& c : counts){
+			notifier.attach([](const Notification& no){ ++*(int *)no.receiver(); }, Update::Value, &c);
+		}
+		b.run("Notifier::notify", {{"observers", double(n)}}, [&]{
+			notifier.notify(Update::Value);
+		});
+	}
+}
+
+
+void benchTable(Bench& b){
+	for(int n=10; n<=10000; n*=10){
+		Table table("< < < < < < < <");
+		for(int i=0; i<n; ++i) table << new View(Rect(10 + i%7, 10 + i%5));
+		b.run("Table::arrange", {{"children", double(n)}}, [&]{ table.arrange(); });
+	}
+}
+
+
+int main(int argc, char ** argv){
+	const char * out = 0;
+	const char * filter = 0;
+	double sampleSec = 0.02;
+
+	for(int i=1; i<argc; ++i){
+		if(0 == strcmp(argv[i], "-o") && i+1 < argc) out = argv[++i];
+		else if(0 == strcmp(argv[i], "-t") && i+1 < argc) sampleSec = atof(argv[++i]);
+		else if('-' == argv[i][0]){
+			fprintf(stderr, "usage: %s [-o file] [-t seconds] [filter]\n", argv[0]);
+			return 1;
+		}
+		else filter = argv[i];
+	}
+
+	NullBackend backend;
+	draw::Backend::current() = &backend;
+
+	Bench b(sampleSec, filter);
+	benchViews(b);
+	benchInput(b);
+	benchFrame(b);
+	benchData(b);
+	benchSnapshots(b);
+	benchFont(b);
+	benchPaint(b);
+	benchPlots(b);
+	benchNotifier(b);
+	benchTable(b);
+
+	FILE * fp = out ? fopen(out, "w") : stdout;
+	if(!fp){
+		fprintf(stderr, "could not open %s\n", out);
+		return 1;
+	}
+	b.writeJSON(fp);
+	if(out) fclose(fp);
+}
@@ -6,6 +6,11 @@
 using namespace glv;
 
 struct EventView : public View{
+	EventView(){
+		Event::t es[] = {Event::WindowResize, Event::WindowCreate, Event::WindowDestroy, Event::Quit};
+		for(Event::t e : es) listen(e, true);
+	}
+
 	bool onEvent(Event::t e, GLV& g){
 		
 		const Keyboard& k = g.keyboard();
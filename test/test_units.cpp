@@ -4,6 +4,7 @@
 #undef NDEBUG
 #include "glv.h"
 #include <assert.h>
+#include <thread>
 
 using namespace glv;
 
@@ -137,21 +138,36 @@ int main(){
 		// reference counting
 		{
 			Data d1(Data::INT, 4,4);
-			assert(Data::references(d1.elems<int>()) == 1);
+			assert(d1.references() == 1);
 
 			{
 				Data d2 = d1;
 				assert(d1.elems<int>() == d2.elems<int>());
+				assert(d1.references() == 2);
+				assert(d2.references() == 2);
 				assert(Data::references(d1.elems<int>()) == 2);
 			}
-			assert(Data::references(d1.elems<int>()) == 1);
+			assert(d1.references() == 1);
 
 			{
 				Data d2 = d1.slice(1);
 				Data d3 = d2.slice(1);
-				assert(Data::references(d1.elems<int>()) == 3);
+				assert(d1.references() == 3);
+			}
+			assert(d1.references() == 1);
+
+			// external data is not counted
+			int ext[4];
+			Data d4(ext, 4);
+			assert(d4.references() == 0);
+
+			// strings are constructed and destroyed with the elements
+			{
+				Data s1(Data::STRING, 3);
+				s1.assign(std::string("a long string that does not fit in place"), 1);
+				Data s2 = s1;
+				assert(s2.at<std::string>(1) == "a long string that does not fit in place");
 			}
-			assert(Data::references(d1.elems<int>()) == 1);
 		}
 		
 	
@@ -253,6 +269,85 @@ int main(){
 			assert(e.indexOf(std::string("invalid")) == Data::npos);
 		}
 		
+		// typed views
+		{
+			Data d(Data::FLOAT, 3, 2);
+			for(int i=0; i<d.size(); ++i) d.assign(float(i), i);
+
+			assert(!d.view<int>().valid());
+			DataView<float> v = d.view<float>();
+			assert(v.valid());
+			assert(v.elems() == d.elems<float>());
+			assert(v.size() == 6 && v.size(0) == 3 && v.size(1) == 2);
+			assert(v[4] == 4 && v(1,1) == 4);
+			v(2,1) = 10;
+			assert(d.at<float>(5) == 10);
+
+			// strided slice
+			const Data sl = d.slice(1,3,2);
+			DataView<const float> s = sl.view<float>();
+			assert(s.stride() == 2 && s.size() == 3);
+			assert(s[0] == 1 && s[1] == 3 && s[2] == 10);
+
+			double sum = 0;
+			assert(d.visit([&](auto v){ for(int i=0; i<v.size(); ++i) sum += v[i]; }));
+			assert(sum == 0+1+2+3+4+10);
+
+			Data e(Data::STRING, 2);
+			assert(!e.visit([](auto v){}));
+		}
+
+		// vector kernels should match the generic code for strided arrays exactly
+		{
+			const Data::SIMD best = Data::simd();
+			const int N = 37; // not a multiple of any vector width
+
+			for(int s=Data::SIMD_NONE; s<=best; ++s){
+				assert(Data::simd(Data::SIMD(s)) == s);
+
+				for(int t=Data::FLOAT; t<=Data::DOUBLE; ++t){
+					Data src[4], str[4];
+					const Data * D[4];
+					const Data * S[4];
+					for(int k=0; k<4; ++k){
+						src[k] = Data(Data::Type(t), N);
+						str[k] = Data(Data::Type(t), N*2);
+						for(int i=0; i<N; ++i){
+							double v = (i%5==0) ? 0.25 : 1./(i+k+1) - k;
+							src[k].assign(v, i);
+							str[k].assign(v, i*2);
+						}
+						str[k] = str[k].slice(0, N, 2);
+						D[k] = &src[k]; S[k] = &str[k];
+					}
+					double c[] = {0.1, 0.2, 0.3, 0.4};
+
+					Data a(Data::Type(t), N), bs(Data::Type(t), N);
+					a.mix<2>(D, c);	bs.mix<2>(S, c);
+					for(int i=0; i<N; ++i) assert(a.at<double>(i) == bs.at<double>(i));
+					assert(a.at<double>(0) == 0.25); // equal values are copied
+					assert(a == bs);
+					a.mix<4>(D, c);	bs.mix<4>(S, c);
+					for(int i=0; i<N; ++i) assert(a.at<double>(i) == bs.at<double>(i));
+					assert(a == bs);
+
+					a += src[1];	bs += str[1];
+					for(int i=0; i<N; ++i) assert(a.at<double>(i) == bs.at<double>(i));
+					a.assign(src[2]);
+					assert(a == src[2]);
+					a.assign(1e9, N-1);
+					assert(a != src[2]);
+				}
+
+				Data ia(Data::INT, N), ib(Data::INT, N);
+				for(int i=0; i<N; ++i){ ia.assign(i, i); ib.assign(2*i, i); }
+				ia += ib;
+				for(int i=0; i<N; ++i) assert(ia.at<int>(i) == 3*i);
+				assert(ia != ib);
+			}
+			Data::simd(best);
+		}
+
 		// multiple element assignment
 		{
 			#define ASSERT_EQUALS(a,b,c,d,e)\
@@ -389,6 +484,1459 @@ int main(){
 	}
 
 
+	// Spatial index of children for finding targets
+	{
+		View top(Rect(1000, 1000));
+		top.disable(HitTest);
+
+		// grid of overlapping children plus a background and some hidden ones
+		std::vector<View *> kids;
+		View * back = new View(Rect(-10,-10, 2000,2000));
+		top << back;
+		for(int j=0; j<30; ++j){
+		for(int i=0; i<30; ++i){
+			View * v = new View(Rect(i*30 + (j%3)*4, j*30, 35, 33));
+			if((i+j)%17 == 0) v->disable(Visible);
+			top << v;
+			kids.push_back(v);
+		}}
+		kids[5]->add(new View(Rect(2,2,5,5)));
+
+		// compare with linear search at points on a lattice, including edges
+		auto check = [&](){
+			for(space_t y=-20; y<1000; y+=7.5){
+			for(space_t x=-20; x<1000; x+=5){
+				space_t xi=x, yi=y, xl=x, yl=y;
+				top.spatialIndex(true);
+				View * vi = top.findTarget(xi,yi);
+				int n=0; for(View * c = top.child; c; c = c->sibling) ++n;
+				assert(top.spatialIndex()->size() == n);
+				top.spatialIndex(false);
+				View * vl = top.findTarget(xl,yl);
+				assert(vi == vl && xi == xl && yi == yl);
+			}}
+		};
+		check();
+
+		// index is kept up to date incrementally
+		top.spatialIndex(true);
+		View * v = kids[100];
+		space_t x = v->l + 1, y = v->t + 1;
+		assert(top.findTarget(x,y) == v);
+		v->bringToFront();
+		v->pos(500.5, 500.5);
+		x = 501; y = 501;
+		assert(top.findTarget(x,y) == v);
+		v->extent(200, 200);
+		x = 690; y = 690;
+		assert(top.findTarget(x,y) == v);
+
+		// moves clamped to the parent's edge
+		v->move(top.w, 0);
+		assert(v->l == top.w - 20);
+		x = top.w - 10; y = v->t + 10;
+		assert(top.findTarget(x,y) == v);
+
+		kids[200]->bringToFront();
+		x = kids[200]->l + 1; y = kids[200]->t + 1;
+		assert(top.findTarget(x,y) == kids[200]);
+
+		kids[200]->remove();
+		x = kids[200]->l + 1; y = kids[200]->t + 1;
+		assert(top.findTarget(x,y) != kids[200]);
+		top << kids[200];
+		for(int i=0; i<50; ++i) top << new View(Rect(i*7, 900, 5, 5));
+		x = 7*3 + 1; y = 901;
+		assert(top.findTarget(x,y)->l == 7*3);
+
+		top.fit();
+		check();
+	}
+
+
+	// Retained draw list
+	{
+		GLV top(100, 100);
+		View v0(Rect(10,10, 50,50)), v00(Rect(5,5, 20,20)), v1(Rect(70,0, 10,10));
+		top << v0 << v1;
+		v0 << v00;
+		
+		assert(top.updateDrawList(100,100));
+		assert(top.drawList().size() == 3);
+		assert(top.drawList()[0].view == &v0);
+		assert(top.drawList()[1].view == &v00);
+		assert(top.drawList()[2].view == &v1);
+		assert(top.drawList()[1].depth == 2);
+		assert(top.drawList()[1].abs == Rect(15,15, 20,20));
+
+		// unchanged tree is not rebuilt
+		assert(!top.updateDrawList(100,100));
+
+		// geometry, structure, visibility, and context size cause a rebuild
+		v00.pos(30,30);
+		assert(top.updateDrawList(100,100));
+		assert(top.drawList()[1].abs == Rect(40,40, 20,20));
+
+		v0.enable(CropChildren);
+		assert(top.updateDrawList(100,100));
+		assert(top.drawList()[1].crop == Rect(40,40, 19,19));
+
+		v1.remove();
+		assert(top.updateDrawList(100,100));
+		assert(top.drawList().size() == 2);
+
+		v0.disable(Visible);
+		assert(top.updateDrawList(100,100));
+		assert(top.drawList().size() == 1);
+
+		assert(top.updateDrawList(200,100));
+		assert(!top.updateDrawList(200,100));
+
+		// Views are synced once per update, even when the list goes stale
+		// part way through
+		struct Synced : View{
+			Synced(): View(Rect(10)), syncs(0), step(0){}
+			void onDataModelSync() override { ++syncs; if(step) pos(l+step, t); }
+			int syncs, step;
+		} s0, s1, s2;
+		top << s0 << s1 << s2;
+		top.updateDrawList(200,100);
+		s1.step = 1;
+		s0.syncs = s1.syncs = s2.syncs = 0;
+		assert(top.updateDrawList(200,100));
+		assert(s0.syncs == 1 && s1.syncs == 1 && s2.syncs == 1);
+		assert(top.drawList().back().abs.l == s2.l);
+		s1.step = 0;
+		s0.remove(); s1.remove(); s2.remove();
+
+		// changes to the tree of another GLV do not invalidate the draw list
+		GLV other(100, 100);
+		View w0, w1;
+		other << w0;
+		top.updateDrawList(200,100);
+		other << w1;
+		w1.remove();
+		assert(!top.updateDrawList(200,100));
+	}
+
+	// Damage tracking
+	{
+		Button w;
+		assert(w.damaged());
+
+		w.damage(false);
+		w.setValue(true);			assert(w.damaged());
+
+		w.damage(false);
+		w.extent(w.w+10, w.h);		assert(w.damaged());
+
+		w.damage(false);
+		w.style(&Style::standard());assert(w.damaged());
+
+		// notifications sent through the Notifier also damage
+		w.damage(false);
+		static_cast<Notifier&>(w).notify(Update::Value);
+		assert(w.damaged());
+	}
+
+	// Partial redraw repaints damaged Views
+	{
+		struct Counter : View{
+			Counter(): View(Rect(60,60, 20,20)), draws(0){}
+			void onDraw(GLV& g) override { ++draws; }
+			int draws;
+		};
+
+		draw::Rasterizer ras(100,100);
+		ras.begin();
+		GLV top(100,100);
+		top.partialRedraw(true);
+		Button b(Rect(10,10, 20,20));
+		TextView tv(Rect(10,40, 40,16));
+		Counter c;
+		b.name("b");
+		top << b << tv << c;
+		top.setFocus(&tv);
+		top.refreshModels();
+		b.setValue(true);	top.modelManager().saveSnapshot("on");
+		b.setValue(false);	top.modelManager().saveSnapshot("off");
+
+		// sum of pixels within a rect
+		auto sum = [&](const Rect& r){
+			unsigned s = 0;
+			for(int y=r.t; y<r.bottom(); ++y)
+				for(int x=r.l; x<r.right(); ++x)
+					for(int k=0; k<3; ++k) s += ras.pixel(x,y)[k];
+			return s;
+		};
+
+		top.drawGLV(100,100, 0);
+		top.drawGLV(100,100, 0);
+		assert(c.draws == 1);	// nothing damaged after the first frame
+		const unsigned off = sum(b), cursor = sum(tv);
+
+		// changed through assignData
+		b.setValue(true);
+		top.drawGLV(100,100, 0);
+		const unsigned on = sum(b);
+		assert(on != off && c.draws == 1);
+
+		// changed by a model
+		top.modelManager().loadSnapshot("off");
+		top.drawGLV(100,100, 0);
+		assert(sum(b) == off && c.draws == 1);
+		top.modelManager().loadSnapshot("on");
+		top.drawGLV(100,100, 0);
+		assert(sum(b) == on && c.draws == 1);
+
+		// animated
+		top.drawGLV(100,100, 0.7);	// cursor blinks off
+		assert(sum(tv) != cursor && c.draws == 1);
+		top.drawGLV(100,100, 0.7);	// and back on
+		assert(sum(tv) == cursor && c.draws == 1);
+		ras.end();
+	}
+
+
+	// Batching of 2D paints into buckets
+	{
+		using namespace draw;
+		const float I[16] = {1,0,0,0, 0,1,0,0, 0,0,1,0, 0,0,0,1};
+		float T[16] = {1,0,0,0, 0,1,0,0, 0,0,1,0, 0,0,0,1};
+		const Color red(1,0,0), blue(0,0,1);
+		Batch::Key tris(Triangles), lines(LineStrip), blended(Triangles);
+		lines.size = 1;
+		blended.blend = 1;
+		Batch b;
+
+		// each View paints in its own model space
+		Point2 tri[] = { Point2(0,0), Point2(10,0), Point2(0,10) };
+		Point2 strip[] = { Point2(0,0), Point2(10,0), Point2(10,10) };
+		Point2 quad[] = { Point2(0,0), Point2(10,0), Point2(10,20), Point2(0,20) };
+
+		assert(b.add(tris, I, red, tri, 0, 0, 3));
+		T[12] = 20;
+		assert(b.add(lines, T, red, strip, 0, 0, 3));
+		assert(b.size() == 2);
+		assert(b.key(1).prim == Lines && b.vertices(1).size() == 4);
+		assert(b.vertices(1)[0].x == 20 && b.vertices(1)[3].y == 10);
+
+		// not overlapping the lines, so joins the first bucket
+		T[12] = 40;
+		assert(b.add(tris, T, blue, tri, 0, 0, 3));
+		assert(b.size() == 2 && b.vertices(0).size() == 6);
+		assert(b.colors(0)[0].r == 1 && b.colors(0)[3].b == 1);
+		assert(b.vertices(0)[3].x == 40);
+
+		// overlapping the lines, so must be drawn after them
+		T[12] = 25; T[13] = -5;
+		assert(b.add(Batch::Key(TriangleFan), T, blue, quad, 0, 0, 4));
+		assert(b.size() == 3);
+		assert(b.key(2).prim == Triangles && b.vertices(2).size() == 6);
+		assert(b.vertices(0).size() == 6);
+
+		// lines clear of the later triangles join the earlier lines
+		T[12] = 100; T[13] = 100;
+		assert(b.add(lines, T, red, strip, 0, 0, 3));
+		assert(b.size() == 3 && b.vertices(1).size() == 8);
+
+		// lines overlapping the later triangles start a new bucket
+		T[12] = 25; T[13] = 0;
+		assert(b.add(lines, T, red, strip, 0, 0, 3));
+		assert(b.size() == 4 && b.key(3).prim == Lines);
+
+		// different state never shares a bucket
+		T[12] = 200; T[13] = 200;
+		assert(b.add(blended, T, red, tri, 0, 0, 3));
+		assert(b.size() == 5 && b.key(4).blend);
+
+		// paints within the search depth only
+		b.searchDepth(1);
+		T[12] = 300; T[13] = 300;
+		assert(b.add(tris, T, red, tri, 0, 0, 3));
+		assert(b.size() == 6);
+
+		// paints take the render state tracked since begin
+		Rasterizer seed(100,100);
+		seed.viewport(0,0,100,100);
+		seed.color(red);
+		Batch b2;
+		b2.begin(seed);
+		b2.state().translate(20,0,0);
+		b2.state().lineWidth(3);
+		assert(b2.add(LineStrip, strip, 0, 0, 3));
+		assert(b2.key(0).size == 3 && b2.vertices(0)[0].x == 20 && b2.colors(0)[0].r == 1);
+		b2.state().color(blue);
+		b2.state().enable(Blend, true);
+		assert(b2.add(Triangles, tri, 0, 0, 3));
+		assert(b2.size() == 2 && b2.key(1).blend && b2.colors(1)[0].b == 1);
+		b2.state().enable(DepthTest, true);
+		assert(!b2.add(Triangles, tri, 0, 0, 3));
+		b2.state().enable(DepthTest, false);
+		b2.state().matrixMode(Projection);
+		b2.state().scale(2,2,1);
+		assert(!b2.add(Triangles, tri, 0, 0, 3));
+		Batch::current() = 0;	// ending would draw the buckets with GL
+	}
+
+
+	// Software rasterizer
+	{
+		draw::Rasterizer ras(8,8);
+		assert(!draw::Backend::current());
+		ras.begin();
+		assert(draw::Backend::current() == &ras);
+
+		draw::enter2D(8,8);
+		draw::disable(draw::Blend);
+		draw::clearColor(0,0,0,1);
+		draw::clear(GL_COLOR_BUFFER_BIT);
+		assert(ras.pixel(0,0)[0] == 0 && ras.pixel(0,0)[3] == 255);
+
+		// fill covers pixel centers inside [l,r) x [t,b)
+		draw::color(1,0,0);
+		draw::rectangle(2,2,6,6);
+		assert(ras.pixel(2,2)[0] == 255 && ras.pixel(5,5)[0] == 255);
+		assert(ras.pixel(1,1)[0] == 0 && ras.pixel(6,6)[0] == 0 && ras.pixel(2,6)[0] == 0);
+
+		// additive blending
+		draw::enable(draw::Blend);
+		draw::blendFunc(GL_ONE, GL_ONE);
+		draw::color(0,0.5,0);
+		draw::rectangle(0,0,4,4);
+		assert(ras.pixel(3,3)[0] == 255 && ras.pixel(3,3)[1] == 128);
+		assert(ras.pixel(1,1)[0] == 0 && ras.pixel(1,1)[1] == 128);
+
+		// scissor is in window coordinates, origin at bottom-left
+		draw::enable(draw::ScissorTest);
+		draw::scissor(0,0,8,2);
+		draw::clearColor(1,1,1,1);
+		draw::clear(GL_COLOR_BUFFER_BIT);
+		assert(ras.pixel(0,7)[2] == 255 && ras.pixel(0,5)[2] == 0);
+		draw::disable(draw::ScissorTest);
+
+		// aliased lines exclude their last endpoint
+		draw::disable(draw::Blend);
+		draw::color(0,0,1);
+		draw::shape(draw::Lines, 0,0.5, 4,0.5);
+		assert(ras.pixel(0,0)[2] == 255 && ras.pixel(3,0)[2] == 255 && ras.pixel(4,0)[2] == 0);
+
+		ras.end();
+		assert(!draw::Backend::current());
+
+		// render a GLV without an OpenGL context
+		Style st1, st2;
+		st1.color.back.set(0,0,1);
+		st2.color.fore.set(1,0,0);
+		GLV top(32,32);
+		top.style(&st1);
+		Button * b = new Button(Rect(8,8,16,16));
+		b->setValue(true);
+		b->style(&st2);
+		top << b;
+
+		ras.resize(32,32).begin();
+		top.drawGLV(32,32, 0);
+		ras.end();
+		assert(ras.pixel(2,2)[2] == 255 && ras.pixel(2,2)[0] == 0);
+		assert(ras.pixel(16,16)[0] == 255 && ras.pixel(16,16)[2] == 0);
+		assert(top.drawStats().calls > 0);
+	}
+
+
+	// Font glyph and text caches
+	{
+		draw::Rasterizer ras(64,64);
+		ras.begin();
+
+		const char * str = "A$.\tx\ny!";
+		Font f(12), fu(12);
+		fu.cacheText(false);
+		GraphicsData g1, g2;
+
+		auto same = [](const GraphicsData& a, const GraphicsData& b){
+			if(a.vertices2().size() != b.vertices2().size()) return false;
+			for(int i=0; i<a.vertices2().size(); ++i){
+				if(a.vertices2()[i].x != b.vertices2()[i].x || a.vertices2()[i].y != b.vertices2()[i].y) return false;
+			}
+			return true;
+		};
+
+		fu.render(g1, str, 3.2, 5);
+		assert(g1.vertices2().size() > 0);
+		assert(fu.cachedTexts() == 0);
+
+		f.render(g2, str, 3.2, 5);		assert(same(g1,g2));
+		assert(f.cachedTexts() == 1);
+		f.render(g2, str, 3.2, 5);		assert(same(g1,g2));
+		assert(f.cachedTexts() == 1);
+
+		// position and font are part of key
+		f.render(g2, str, 4.2, 5);		assert(!same(g1,g2));
+		assert(f.cachedTexts() == 2);
+		f.letterSpacing(0.5);
+		assert(f.cachedTexts() == 0);
+		fu.letterSpacing(0.5);
+		fu.render(g1, str, 3.2, 5);
+		f.render(g2, str, 3.2, 5);		assert(same(g1,g2));
+
+		// old strings are dropped when cache is full
+		char buf[16];
+		for(int i=0; i<1000; ++i){
+			snprintf(buf, sizeof(buf), "%d", i);
+			f.render(g2, buf);
+		}
+		assert(f.cachedTexts() <= 512);
+		f.render(g2, "999");
+		fu.render(g1, "999");			assert(same(g1,g2));
+
+		// atlas fonts are stroked by software backends
+		AtlasFont af(12);
+		af.render(g2, str, 3.2, 5);
+		fu.letterSpacing(0);
+		fu.render(g1, str, 3.2, 5);		assert(same(g1,g2));
+		assert(g2.texCoords2().size() == 0);
+
+		ras.end();
+
+		// without a backend, atlas fonts draw a quad per character textured
+		// from its cell in the atlas
+		{
+			GraphicsData q;
+			assert(!af.mesh(q, 0));
+			assert(af.mesh(q, "AB\nA", 10, 20));
+			assert(q.vertices2().size() == 18 && q.texCoords2().size() == 18);
+
+			struct Quad{
+				float l,t,r,b, tl,tt,tr,tb;
+				Quad(const GraphicsData& g, int i){
+					const Point2 * v = &g.vertices2()[i*6];
+					const Point2 * c = &g.texCoords2()[i*6];
+					l=v[0].x; t=v[0].y; r=v[4].x; b=v[4].y;
+					tl=c[0].x; tt=c[0].y; tr=c[4].x; tb=c[4].y;
+
+					// two triangles covering the rect and its cell
+					const float vx[] = {l,r,l, r,r,l}, vy[] = {t,t,b, t,b,b};
+					const float cx[] = {tl,tr,tl, tr,tr,tl}, cy[] = {tt,tt,tb, tt,tb,tb};
+					for(int k=0; k<6; ++k){
+						assert(v[k].x == vx[k] && v[k].y == vy[k]);
+						assert(c[k].x == cx[k] && c[k].y == cy[k]);
+					}
+				}
+			};
+			Quad a(q,0), b(q,1), a2(q,2);
+
+			// quads are the same size and contain the pen position
+			assert(a.l < 10 && a.r > 10 && a.t < 20 && a.b > 20);
+			assert(b.r-b.l == a.r-a.l && b.b-b.t == a.b-a.t);
+			assert(b.l - a.l == af.advance('A') && b.t == a.t);
+			assert(a2.l == a.l && a2.t > a.t);
+
+			// one texel per unit in a power-of-two texture
+			float texW = (a.r-a.l) / (a.tr-a.tl), texH = (a.b-a.t) / (a.tb-a.tt);
+			assert(std::fabs(texW - std::round(texW)) < 1e-3 && std::fabs(texH - std::round(texH)) < 1e-3);
+			int iw = std::round(texW), ih = std::round(texH);
+			assert(iw > 0 && !(iw & (iw-1)) && ih > 0 && !(ih & (ih-1)));
+			assert(a.tl >= 0 && a.tr <= 1 && a.tt >= 0 && a.tb <= 1);
+
+			// cells are laid out in rows of 16 from '!', so 'A' and 'B' are
+			// neighbors and the same character has the same cell
+			assert(b.tl == a.tr && b.tt == a.tt && b.tb == a.tb);
+			assert(a.tl == 0 && a.tt == 2*(a.tb-a.tt));
+			assert(a2.tl == a.tl && a2.tt == a.tt);
+		}
+
+		// Views switch font kind with their style, keeping its settings
+		Style st;
+		View v;
+		v.font().size(20);
+		assert(!dynamic_cast<AtlasFont *>(&v.font()));
+		st.atlasFont = true;
+		v.style(&st);
+		assert(dynamic_cast<AtlasFont *>(&v.font()));
+		assert(v.font().size() == 20);
+		st.atlasFont = false;
+		assert(!dynamic_cast<AtlasFont *>(&v.font()));
+		assert(v.font().size() == 20);
+	}
+
+
+	// Single-producer, single-consumer ring buffer
+	{
+		RingBuffer<int> rb(5);
+		assert(rb.capacity() == 8);
+		assert(rb.readable() == 0 && rb.writable() == 8);
+
+		int src[] = {1,2,3,4,5,6};
+		int dst[8];
+		assert(rb.write(src, 6) == 6);
+		assert(rb.read(dst, 4) == 4);
+		assert(dst[0] == 1 && dst[3] == 4);
+
+		// wraps around end of storage and truncates when full
+		assert(rb.write(src, 6) == 6);
+		assert(rb.write(src, 1) == 0);
+		assert(rb.readable() == 8);
+		assert(rb.skip(2) == 2);
+		assert(rb.read(dst, 8) == 6);
+		assert(dst[0] == 1 && dst[5] == 6);
+	}
+
+	// Audio queue of TimeScope
+	{
+		TimeScope ts(Rect(100), 4, 2);
+		ts.sync(false);
+
+		float blk[] = {1,-1, 2,-2, 3,-3};	// interleaved
+		ts.update(blk, 3, 2, true);
+		ts.onAnimate(0);
+		assert(ts.data().at<float>(0,0) == 0);	// not enough frames yet
+
+		float blk2[] = {4,5,6, -4,-5,-6};	// non-interleaved
+		ts.update(blk2, 3, 2, false);
+		ts.damage(false);
+		ts.onAnimate(0);
+		assert(ts.damaged());
+		assert(ts.data().at<float>(0,0) == 1 && ts.data().at<float>(3,0) == 4);
+		assert(ts.data().at<float>(0,1) ==-1 && ts.data().at<float>(3,1) ==-4);
+
+		// blocks that do not fit are dropped whole
+		ts.historyDepth(1);
+		float big[16] = {0};
+		ts.update(big, 4, 2, true);
+		assert(ts.droppedBlocks() == 0);
+		ts.update(big, 4, 2, true);
+		assert(ts.droppedBlocks() == 1);
+
+		// blocks larger than the queue keep their newest frames
+		TimeScope mono(Rect(100), 4, 1);
+		mono.sync(false).historyDepth(1);
+		float longBlk[] = {1,2,3,4,5,6};
+		mono.update(longBlk, 6, 1, false);
+		assert(mono.droppedBlocks() == 0);
+		mono.onAnimate(0);
+		assert(mono.data().at<float>(0) == 3 && mono.data().at<float>(3) == 6);
+	}
+
+	// Decimation of PlotFunction1D
+	{
+		struct Decimated : public PlotFunction1D{
+			Decimated(){ decimate(true); }
+			void view(double min, double max, float pixels){
+				mVisible[0].endpoints(min, max); mVisiblePixels[0] = pixels;
+			}
+		} p;
+
+		const int N = 10000;
+		Data d(Data::FLOAT, 1, N);
+		unsigned s = 1;
+		for(int i=0; i<N; ++i){ s = s*1664525 + 1013904223; d.assign(float(s>>8)/(1<<24), 0, i); }
+
+		GraphicsData g;
+		int sizes[] = {N,1,1};
+		auto map = [&](){ g.reset(); Indexer ind(sizes); p.onMap(g, d, ind); };
+
+		// columns have exact extrema of their samples
+		auto check = [&](double min, double max, int pixels){
+			double dx = (max-min)/pixels;
+			assert(g.vertices2().size() == 2*pixels);
+			for(int c=0; c<pixels; ++c){
+				int j0 = int(std::ceil(min + c*dx)), j1 = int(std::ceil(min + (c+1)*dx));
+				float lo = d.at<float>(0,j0), hi = lo;
+				for(int j=j0; j<j1; ++j){ lo = glv::min(lo, d.at<float>(0,j)); hi = glv::max(hi, d.at<float>(0,j)); }
+				assert(g.vertices2()[2*c].y == lo && g.vertices2()[2*c+1].y == hi);
+			}
+		};
+
+		p.view(1000.5, 9000.5, 100);	map(); check(1000.5, 9000.5, 100);
+		p.view(0, N-1, 7);				map(); check(0, N-1, 7);
+
+		// in place changes are seen once their region is hinted
+		d.assign(5.f, 0, 4321);
+		map();							assert(g.vertices2()[7].y < 5);
+		p.updateRegion(4321,0,1,1);
+		map();							check(0, N-1, 7);
+		assert(g.vertices2()[7].y == 5);
+
+		// reallocated data is rescanned
+		Data e(Data::FLOAT, 1, N);
+		e.assign(-3.f, 0, 17);
+		d = e;
+		map();							check(0, N-1, 7);
+		assert(g.vertices2()[0].y == -3);
+
+		// only visible samples are mapped when there are few per pixel
+		p.view(10.5, 20.5, 100);		map();
+		assert(g.vertices2().size() == 12);
+		assert(g.vertices2()[0].x == 10 && g.vertices2()[11].x == 21);
+	}
+
+	// Incremental texture updates of PlotDensity
+	{
+		struct Density : public PlotDensity{
+			Density(): PlotDensity(Color(0.8,0.3,0.1), 0.25){}
+			// map hinted region as Plottable::doPlot does
+			void map(GraphicsData& g, const Data& d){
+				int* u = mUpdateRegion;
+				int ends[] = { u[0]+u[2] + (u[2]<0 ? d.size(1)+1 : 0), u[1]+u[3] + (u[3]<0 ? d.size(2)+1 : 0), d.size(3) };
+				int starts[] = { u[0], u[1], 0 };
+				Indexer ind(ends, starts);
+				g.reset(); g.colors()[0] = color();
+				onMap(g, d, ind);
+			}
+			const Color8& texel(int x, int y) const { return mTexels[y*mTexSize[0] + x]; }
+			bool uploads(int x0, int y0, int x1, int y1) const {
+				return mUpload[0]==x0 && mUpload[1]==y0 && mUpload[2]==x1 && mUpload[3]==y1;
+			}
+			bool uploading() const { return mUpload[0] < mUpload[2]; }
+			void uploaded(){ mUpload[0] = mUpload[2] = 0; }
+			bool fromColors(const GraphicsData& g, const Data& d){ return texelsFromColors(g, d); }
+		} p;
+
+		auto near = [](const Color8& t, const Color& c){
+			auto ok = [](int b, float v){ v = v<0?0:(v>1?1:v); return std::abs(b - v*255) <= 1.5f; };
+			return ok(t.r,c.r) && ok(t.g,c.g) && ok(t.b,c.b) && ok(t.a,c.a);
+		};
+
+		const int W = 16, H = 8;
+		Data d(Data::FLOAT, 1, W, H);
+		for(int j=0; j<H; ++j) for(int i=0; i<W; ++i) d.assign((i+j*W)/float(W*H/2) - 1.f, 0, i, j);
+		GraphicsData g;
+
+		// single components are colored by the hue spread colormap
+		p.map(g, d);
+		assert(p.uploads(0,0,W,H));
+		HSV hsv = p.color();
+		Color col1 = HSV(hsv).rotateHue( 0.25), col2 = HSV(hsv).rotateHue(-0.25);
+		for(int j=0; j<H; ++j) for(int i=0; i<W; ++i){
+			float w0 = d.at<float>(0,i,j);
+			assert(near(p.texel(i,j), Color((w0 > 0 ? col1*w0 : col2*-w0), p.color().a)));
+		}
+		p.uploaded();
+
+		// only texels of hinted regions are colored and uploaded
+		for(int j=0; j<H; ++j) for(int i=0; i<W; ++i) d.assign(1.f, 0, i, j);
+		p.updateRegion(2,1,3,2).updateRegion(6,4,1,1);
+		p.map(g, d);
+		assert(p.uploads(2,1,7,5));
+		for(int j=0; j<H; ++j) for(int i=0; i<W; ++i){
+			bool in = i>=2 && i<7 && j>=1 && j<5;
+			assert(near(p.texel(i,j), col1) == in);
+		}
+		p.uploaded();
+
+		// hints are consumed by a frame
+		p.map(g, d);
+		assert(!p.uploading());
+
+		// a negative size returns to full updates
+		p.updateRegion(0,0,-1,-1);
+		p.map(g, d);
+		assert(p.uploads(0,0,W,H) && near(p.texel(0,0), col1));
+		p.uploaded();
+
+		// value and saturation pairs
+		Data e(Data::FLOAT, 2, W, H);
+		for(int j=0; j<H; ++j) for(int i=0; i<W; ++i){ e.assign(i/float(W), 0, i, j); e.assign(j/float(H), 1, i, j); }
+		p.map(g, e);
+		for(int j=0; j<H; ++j) for(int i=0; i<W; ++i){
+			assert(near(p.texel(i,j), HSV(hsv.h, hsv.s*e.at<float>(1,i,j), hsv.v*e.at<float>(0,i,j))));
+		}
+		p.uploaded();
+
+		// colors added by other maps replace the texels
+		struct Green : GraphicsMap{
+			void onMap(GraphicsData& g, const Data& d, const Indexer& i) override {
+				while(i()) g.addColor(0, i[0]/float(d.size(1)), 0);
+			}
+		} green;
+		p.map(g, e);
+		assert(!p.fromColors(g, e));	// mapped by the plot itself only
+		p.add(green);
+		g.reset(); g.colors()[0] = p.color();
+		p.doMap(g, e);
+		assert(p.fromColors(g, e));
+		assert(p.uploads(0,0,W,H));
+		for(int j=0; j<H; ++j) for(int i=0; i<W; ++i){
+			assert(near(p.texel(i,j), Color(0, i/float(W), 0)));
+		}
+		p.uploaded();
+
+		// without them, the plot colors all texels again
+		p.remove(green);
+		p.updateRegion(0,0,1,1);
+		p.map(g, e);
+		assert(p.uploads(0,0,W,H));
+		assert(near(p.texel(3,3), HSV(hsv.h, hsv.s*e.at<float>(1,3,3), hsv.v*e.at<float>(0,3,3))));
+	}
+
+	// Parallel mapping of Plottables
+	{
+		struct Recorder : public Plottable{
+			std::thread::id mapper;
+			void onMap(GraphicsData& g, const Data& d, const Indexer& i) override {
+				mapper = std::this_thread::get_id();
+				while(i()) g.addVertex(i[0]*0.1 - 0.5, d.at<float>(0,i[0]));
+			}
+		};
+
+		draw::Rasterizer ras(64,64);
+		GLV top(64,64);
+		Plot * plot = new Plot(Rect(64,64));
+		top << plot;
+
+		PlotFunction1D fs[8];
+		for(int k=0; k<8; ++k){
+			fs[k].color(HSV(k/8., 1, 1));
+			fs[k].data().resize(Data::FLOAT, 1, 64);
+			for(int i=0; i<64; ++i) fs[k].data().assign(sin(i*0.2 + k), 0, i);
+			plot->add(fs[k]);
+		}
+		fs[3].drawUnderGrid(true);
+		Recorder rec;
+		rec.prim(draw::LineStrip).concurrentMap(false);
+		rec.data().resize(Data::FLOAT, 1, 10);
+		for(int i=0; i<10; ++i) rec.data().assign(i*0.1f, 0, i);
+		plot->add(rec);
+
+		auto render = [&](){
+			ras.begin(); top.drawGLV(64,64, 0); ras.end();
+			return std::vector<unsigned char>(ras.pixels(), ras.pixels() + 64*64*4);
+		};
+
+		auto serial = render();
+		int threads = Plot::mapThreads();
+		Plot::mapThreads(3);
+		plot->parallelMap(true);
+		assert(render() == serial);
+		assert(rec.mapper == std::this_thread::get_id());
+
+		// inactive and data-less Plottables are skipped
+		fs[5].active(false);
+		fs[6].data().resize(Data::FLOAT, 1, 0);
+		auto parallel = render();
+		plot->parallelMap(false);
+		assert(render() == parallel);
+
+		Plot::mapThreads(threads);
+		assert(Plot::mapThreads() == threads);
+	}
+
+	// Graphics data produced on another thread
+	{
+		GraphicsFrames frames;
+		assert(!frames.swap() && !frames.stale());
+		assert(frames.front().vertices2().size() == 0);
+
+		// fill buffer with its generation so torn frames are detected
+		auto produce = [&](unsigned gen){
+			auto& gd = frames.back();
+			gd.reset();
+			for(unsigned i=0; i<gen%64; ++i) gd.addVertex(gen, i);
+			frames.publish(gen);
+		};
+
+		auto consistent = [&](){
+			auto& v = frames.front().vertices2();
+			if(v.size() != int(frames.generation()%64)) return false;
+			for(int i=0; i<v.size(); ++i) if(v[i].x != frames.generation() || v[i].y != i) return false;
+			return true;
+		};
+
+		frames.request();
+		assert(frames.stale());
+		produce(frames.requested());
+		assert(frames.stale());
+		assert(frames.swap() && !frames.swap());
+		assert(!frames.stale() && frames.generation() == 1 && consistent());
+
+		// only the latest of several published buffers is drawn
+		produce(2); produce(3);
+		assert(frames.swap() && frames.generation() == 3 && consistent());
+
+		const unsigned N = 20000;
+		std::thread producer([&]{
+			for(unsigned g=4; g<=N; ++g) produce(g);
+		});
+		unsigned last = frames.generation();
+		while(last != N){
+			if(frames.swap()){
+				assert(frames.generation() > last && consistent());
+				last = frames.generation();
+			}
+			else std::this_thread::yield();
+		}
+		producer.join();
+		assert(!frames.swap());
+	}
+
+	// Cached graphics data
+	{
+		draw::Rasterizer ras(8,8);
+		ras.begin();
+		draw::enter2D(8,8);
+		draw::disable(draw::Blend);
+		draw::clearColor(0,0,0,1);
+		draw::color(1,1,1);
+
+		GraphicsData gd;
+		gd.cache(true);
+		gd.addVertex(0.5, 0.5);
+		auto sent = [&](const GraphicsData& g){
+			draw::stats().reset();
+			draw::clear(GL_COLOR_BUFFER_BIT);
+			draw::paint(draw::Points, g);
+			return draw::stats().bytes;
+		};
+		auto lit = [&](int x){ return ras.pixel(x,0)[0] == 255; };
+
+		// unchanged data is sent once
+		assert(sent(gd) == sizeof(Point2) && lit(0));
+		assert(sent(gd) == 0 && lit(0));
+
+		// changes are found by hashing
+		gd.vertices2()[0].x = 2.5;
+		assert(sent(gd) == sizeof(Point2) && lit(2) && !lit(0));
+		gd.addVertex(4.5, 0.5);
+		assert(sent(gd) == 2*sizeof(Point2) && lit(2) && lit(4));
+
+		// or by version stamp, without looking at the data
+		gd.stamp(1);
+		assert(sent(gd) > 0);
+		gd.vertices2()[1].x = 6.5;
+		assert(sent(gd) == 0 && lit(4) && !lit(6));
+		gd.stamp(2);
+		assert(sent(gd) > 0 && lit(6) && !lit(4));
+
+		// copies cache their own data
+		GraphicsData cp = gd;
+		assert(cp.cache() && cp.cached() != gd.cached());
+		assert(sent(cp) > 0 && sent(cp) == 0);
+		cp.cache(false);
+		assert(!cp.cached() && sent(cp) == 0 && lit(6));
+
+		// unchanged text and plots are not sent again
+		Font f(8);
+		f.render(gd, "cached", 0, 0);
+		draw::stats().reset();
+		f.render(gd, "cached", 0, 0);
+		assert(draw::stats().bytes == 0 && draw::stats().calls == 1);
+
+		GLV top(8,8);
+		Plot * plot = new Plot(Rect(8,8));
+		top << plot;
+		PlotFunction1D fn;
+		fn.data().resize(Data::FLOAT, 1, 16);
+		plot->add(fn);
+		top.drawGLV(8,8, 0);
+		top.drawGLV(8,8, 0);
+		auto bytes = top.drawStats().bytes;
+		fn.data().assign(1.f, 0, 3);
+		top.drawGLV(8,8, 0);
+		assert(top.drawStats().bytes == bytes + 16*sizeof(Point2));
+		top.drawGLV(8,8, 0);
+		assert(top.drawStats().bytes == bytes);
+
+		ras.end();
+	}
+
+	// GL objects belong to the graphics context that created them
+	{
+		using draw::ContextObjects;
+		GLV a, b;
+		const int ca = a.graphicsContext(), cb = b.graphicsContext();
+		assert(ca != cb);
+
+		// names are kept while used in their context
+		draw::context(ca);
+		ContextObjects bufs(ContextObjects::Buffers, 2);
+		assert(!bufs.claim());
+		bufs.names()[0] = 5; bufs.names()[1] = 6;	// as if generated
+		assert(bufs.claim() && bufs.name(1) == 6);
+
+		// and released to their context when used in another
+		draw::context(cb);
+		assert(!bufs.claim() && bufs.name() == 0);
+		assert(draw::releasedObjects(ca) == 2 && draw::releasedObjects(cb) == 0);
+		bufs.names()[0] = 7; bufs.names()[1] = 8;
+
+		// losing another context does not affect them
+		a.broadcastEvent(Event::WindowDestroy);
+		assert(draw::releasedObjects(ca) == 0);	// deleted along with context
+		assert(bufs.claim() && bufs.name() == 7);
+
+		// names of a lost context are forgotten
+		b.broadcastEvent(Event::WindowDestroy);
+		b.broadcastEvent(Event::WindowCreate);
+		assert(!bufs.claim() && bufs.name() == 0);
+		assert(draw::releasedObjects(cb) == 0);
+
+		// destroyed names are released to their context
+		{	ContextObjects tex(ContextObjects::Textures);
+			assert(!tex.claim());
+			tex.names()[0] = 9;
+		}
+		assert(draw::releasedObjects(cb) == 1);
+		b.broadcastEvent(Event::WindowDestroy);
+		draw::context(-1);
+	}
+
+	// Packed colors and interleaved vertices
+	{
+		Color cs[] = { Color(0,0.5,1,0.25), Color(-1,2,0.999,0.001), Color(NAN,1,0,1) };
+		Color8 c8s[3];
+		toColor8(c8s, cs, 3);
+		for(int i=0; i<3; ++i){
+			Color8 c(cs[i]);
+			assert(c.r == c8s[i].r && c.g == c8s[i].g && c.b == c8s[i].b && c.a == c8s[i].a);
+		}
+		assert(c8s[0].g == 128 && c8s[0].b == 255 && c8s[0].a == 64);
+		assert(c8s[1].r == 0 && c8s[1].g == 255 && c8s[1].b == 255 && c8s[1].a == 0);
+		assert(c8s[2].r == 0);
+
+		Color back[3];
+		toColor(back, c8s, 3);
+		assert(back[0].b == 1 && std::abs(back[0].g - 0.5) < 1./255);
+
+		// all color formats draw the same
+		draw::Rasterizer ras(4,1);
+		auto render = [&](const GraphicsData& gd){
+			ras.begin();
+			draw::enter2D(4,1);
+			draw::disable(draw::Blend);
+			draw::clearColor(0,0,0,1);
+			draw::clear(GL_COLOR_BUFFER_BIT);
+			draw::paint(draw::Points, gd);
+			ras.end();
+			return std::vector<unsigned char>(ras.pixels(), ras.pixels() + 4*4);
+		};
+
+		GraphicsData gf, g8, gi;
+		for(int i=0; i<4; ++i){
+			Color8 c(i*60, 255-i*60, i*20, 255);
+			gf.addVertex(i+0.5, 0.5); gf.addColor(c.toColor());
+			g8.addVertex(i+0.5, 0.5); g8.addColor8(c);
+			gi.addColorVertex2(i+0.5, 0.5, c);
+		}
+		auto ref = render(gf);
+		assert(ref[4*3] == 180 && ref[4*3+1] == 75);
+		assert(render(g8) == ref);
+		assert(render(gi) == ref);
+		gi.cache(true);
+		assert(render(gi) == ref);
+		gi.colorVertices2()[3].color.r = 0;
+		assert(render(gi) != ref);
+	}
+
+	// Frame arena
+	{
+		FrameArena a(256);
+		char * p1 = (char *)a.allocate(3, 1);
+		double * p2 = (double *)a.allocate(sizeof(double), alignof(double));
+		assert(size_t(p2) % alignof(double) == 0 && (char *)p2 >= p1+3);
+		assert(a.used() >= 3+sizeof(double) && a.blocks() == 1 && a.allocations() == 1);
+
+		// demand beyond a block spills into new blocks that are coalesced on reset
+		auto frame = [&](){ for(int i=0; i<10; ++i) a.allocate(100); };
+		frame();
+		assert(a.blocks() > 1 && a.highWater() >= 1000);
+		a.reset();
+		assert(a.used() == 0 && a.blocks() == 1 && a.capacity() >= 1000);
+		unsigned allocs = a.allocations();
+		for(int i=0; i<4; ++i){ frame(); a.reset(); }
+		assert(a.allocations() == allocs && a.blocks() == 1);
+
+		// buffers drawing from an arena
+		Buffer<Point2> b;
+		b.arena(&a);
+		for(int i=0; i<100; ++i) b.append(Point2(i, -i));
+		assert(b.size() == 100 && b.capacity() >= 100 && b.arena() == &a);
+		assert(b[99].x == 99 && b[99].y == -99 && a.used() >= 100*sizeof(Point2));
+		Buffer<Point2> cp = b;
+		assert(cp.arena() == 0 && cp.size() == 100 && cp[50].x == 50);
+		b.release();
+		assert(b.size() == 0 && b.capacity() == 0 && b.arena() == &a);
+		a.reset();
+		b.reserve(64);
+		int cap = b.capacity();
+		for(int i=0; i<64; ++i) b.append(Point2(i, i));
+		assert(cap == 64 && b.capacity() == cap);
+		b.size(32);
+		assert(b.size() == 32 && b.capacity() == 64);
+
+		// after the first frame, Views of different sizes sharing the GLV's
+		// graphics data find enough capacity reserved
+		struct Verts : View{
+			Verts(int n_): View(Rect(8,8)), n(n_), grew(0){}
+			void onDraw(GLV& g) override {
+				GraphicsData& gd = g.graphicsData();
+				int cap = gd.vertices2().capacity();
+				for(int i=0; i<n; ++i) gd.addVertex(i%8+0.5, i/8%8+0.5);
+				if(gd.vertices2().capacity() != cap) ++grew;
+				draw::paint(draw::Points, gd);
+			}
+			int n, grew;
+		};
+		draw::Rasterizer ras(8,8);
+		ras.begin();
+		GLV top(8,8);
+		Verts v1(10), v2(1000), v3(100);
+		top << v1 << v2 << v3;
+		top.drawGLV(8,8, 0);
+		assert(v2.grew > 0 && top.frameArena().used() == 0);
+		unsigned topAllocs = top.frameArena().allocations();
+		v1.grew = v2.grew = v3.grew = 0;
+		for(int i=0; i<3; ++i) top.drawGLV(8,8, 0);
+		assert(v1.grew == 0 && v2.grew == 0 && v3.grew == 0);
+		assert(top.frameArena().allocations() == topAllocs);
+		assert(top.frameArena().highWater() >= 1000*sizeof(Point2));
+		ras.end();
+	}
+
+
+	// Event handler dispatch
+	{
+		struct Count : EventHandler{
+			Count(bool b=true): n(0), bubble(b){}
+			bool onEvent(View& v, GLV& g) override { ++n; return bubble; }
+			int n; bool bubble;
+		};
+		struct Listener : View{
+			Listener(): View(Rect(1,1)), n(0){
+				listen(Event::WindowCreate, true).listen(Event::WindowDestroy, true);
+			}
+			bool onEvent(Event::t e, GLV& g) override { ++n; return true; }
+			int n;
+		};
+
+		Count h1, h2, h3(false), h4;
+		Listener v;
+		v.addHandler(Event::MouseDown, h1).addHandler(Event::MouseDown, h1);
+		v.addHandler(Event::MouseDown, h2).addHandler(Event::KeyDown, h3);
+		v.addHandler(Event::KeyDown, h4);
+		assert(v.numEventHandlers(Event::MouseDown) == 2);
+		assert(v.hasEventHandler(Event::KeyDown, h3) && !v.hasEventHandler(Event::KeyDown, h1));
+		assert(!v.hasEventHandlers(Event::MouseUp) && v.numEventHandlers(Event::MouseUp) == 0);
+
+		GLV top;
+		top << v;
+		top.broadcastEvent(Event::MouseDown);
+		assert(h1.n == 1 && h2.n == 1 && v.n == 1);
+
+		// a handler not bubbling cancels subsequent handlers and onEvent()
+		top.broadcastEvent(Event::KeyDown);
+		assert(h3.n == 1 && h4.n == 0 && v.n == 1);
+
+		v.removeHandler(Event::KeyDown, h3);
+		assert(!v.hasEventHandler(Event::KeyDown, h3) && v.numEventHandlers(Event::KeyDown) == 1);
+		top.broadcastEvent(Event::KeyDown);
+		assert(h3.n == 1 && h4.n == 1 && v.n == 2);
+		v.removeHandler(Event::KeyDown, h4);
+		assert(!v.hasEventHandlers(Event::KeyDown));
+
+		// runtime event types share a bit, but are dispatched by type
+		Event::t e1 = Event::t(Event::Unused + 40), e2 = Event::t(Event::Unused + 41);
+		Count h5;
+		v.addHandler(e1, h5);
+		assert(v.hasEventHandlers(e1) && !v.hasEventHandlers(e2));
+		top.broadcastEvent(e2);
+		assert(h5.n == 0);
+		top.broadcastEvent(e1);
+		assert(h5.n == 1);
+		v.remove();
+
+		// broadcasts skip subtrees without handlers or listeners
+		GLV root;
+		Listener a, b, c, d;
+		root << (a << b) << (c << d);
+		View * vs[] = { &root, &a, &b, &c, &d };
+		for(View * w : vs) w->listen(Event::WindowCreate, false);
+		assert(!a.listening(Event::WindowCreate) && a.listening(Event::WindowDestroy));
+		Count h6;
+		d.addHandler(Event::WindowCreate, h6);
+		root.broadcastEvent(Event::WindowCreate);
+		assert(h6.n == 1 && a.n == 0 && b.n == 0 && c.n == 0 && d.n == 0);
+		root.broadcastEvent(Event::WindowDestroy);
+		assert(a.n == 1 && b.n == 1 && c.n == 1 && d.n == 1);
+
+		b.listen(Event::WindowCreate, true);
+		d.removeHandler(Event::WindowCreate, h6);
+		root.broadcastEvent(Event::WindowCreate);
+		assert(h6.n == 1 && b.n == 2 && a.n == 1 && d.n == 1);
+
+		// moved Views bring their handlers along
+		d.addHandler(Event::WindowCreate, h6);
+		b << d;
+		root.broadcastEvent(Event::WindowCreate);
+		assert(h6.n == 2 && b.n == 3 && d.n == 1 && c.n == 1);
+	}
+
+	// Subscriptions to broadcasts
+	{
+		struct Count : EventHandler{
+			Count(): n(0){}
+			bool onEvent(View& v, GLV& g) override { ++n; return true; }
+			int n;
+		};
+		struct Quiet : View{
+			Quiet(): View(Rect(1,1)){ listen(Event::WindowResize, false); }
+		};
+
+		GLV root;
+		root.listen(Event::WindowResize, false);
+		Quiet a, b, c, d;
+		root << (a << b) << (c << d);
+		Count h;
+		d.addHandler(Event::WindowResize, h);
+		b.listen(Event::WindowResize, true);
+		typedef std::vector<View *> Views;
+		assert(root.subscribers(Event::WindowResize) == Views({&b, &d}));
+		assert(root.subscribers(Event::WindowShow).empty());
+
+		// the lists follow changes to the tree and to handlers
+		a << d;
+		assert(root.subscribers(Event::WindowResize) == Views({&b, &d}));
+		a.addHandler(Event::WindowResize, h);
+		assert(root.subscribers(Event::WindowResize) == Views({&a, &b, &d}));
+		b.remove();
+		assert(root.subscribers(Event::WindowResize) == Views({&a, &d}));
+		c << b;
+		assert(root.subscribers(Event::WindowResize) == Views({&a, &d, &b}));
+		root.broadcastEvent(Event::WindowResize);
+		assert(h.n == 2);
+
+		// Views deleted by a callback are not visited and added ones are
+		struct Deleter : EventHandler{
+			View * del, * add, * to;
+			bool onEvent(View& v, GLV& g) override {
+				delete del; del = 0;
+				*to << add;
+				return true;
+			}
+		} deleter;
+		Count h2;
+		Quiet * doomed = new Quiet, * added = new Quiet;
+		c << doomed;
+		doomed->addHandler(Event::WindowResize, h2);
+		added->addHandler(Event::WindowResize, h2);
+		deleter.del = doomed; deleter.add = added; deleter.to = &c;
+		a.addHandler(Event::WindowResize, deleter);
+		root.broadcastEvent(Event::WindowResize);
+		assert(h2.n == 1 && h.n == 4);
+		assert(root.subscribers(Event::WindowResize) == Views({&a, &d, &b, added}));
+		a.removeHandler(Event::WindowResize, deleter);
+		added->remove();
+		delete added;
+
+		// callbacks can subscribe Views and broadcast again
+		struct Nested : EventHandler{
+			Count * h;
+			View * v[2];
+			bool onEvent(View& vw, GLV& g) override {
+				if(!h) return true;
+				Count * c = h; h = 0;
+				for(View * w : v) w->addHandler(Event::WindowResize, *c);
+				g.broadcastEvent(Event::WindowResize);
+				return true;
+			}
+		} nested;
+		Count h3;
+		nested.h = &h3; nested.v[0] = &root; nested.v[1] = &c;
+		a.addHandler(Event::WindowResize, nested);
+		h.n = 0;
+		root.broadcastEvent(Event::WindowResize);
+		assert(h.n == 4 && h3.n == 2);
+		assert(root.subscribers(Event::WindowResize).size() == 5);
+		a.removeHandler(Event::WindowResize, nested);
+		root.removeHandler(Event::WindowResize, h3);
+		c.removeHandler(Event::WindowResize, h3);
+	}
+
+	// Stock widgets only subscribe to window events they handle
+	{
+		struct CountSlider : Slider{
+			CountSlider(): n(0){}
+			bool onEvent(Event::t e, GLV& g) override { n += e == Event::WindowCreate; return Slider::onEvent(e,g); }
+			int n;
+		};
+		GLV root;
+		CountSlider s;
+		Button b; Label l("label"); TextView tv; Sliders ss(Rect(40,20), 2,2);
+		Plot p;
+		root << s << b << l << tv << ss << p;
+
+		typedef std::vector<View *> Views;
+		assert(root.subscribers(Event::WindowCreate) == Views({&p}));
+		assert(root.subscribers(Event::WindowResize).empty());
+		root.broadcastEvent(Event::WindowCreate);
+		assert(s.n == 0);
+
+		s.listen(Event::WindowCreate, true);
+		root.broadcastEvent(Event::WindowCreate);
+		assert(s.n == 1);
+		assert(root.subscribers(Event::WindowCreate) == Views({&s, &p}));
+
+		// changes to another GLV leave the lists of this one intact
+		GLV other;
+		View extra;
+		other << extra;
+		extra.listen(Event::WindowCreate, true).remove();
+		assert(root.subscribers(Event::WindowCreate) == Views({&s, &p}));
+		root.broadcastEvent(Event::WindowCreate);
+		assert(s.n == 2);
+	}
+
+	// Queued input with coalescing of motion and wheel events
+	{
+		struct Target : View{
+			Target(): View(Rect(10,10, 50,50)), drags(0), moves(0), wheels(0), dragsAtAnimate(-1){
+				enable(Animate);
+			}
+			bool onEvent(Event::t e, GLV& g) override {
+				switch(e){
+				case Event::MouseDrag: ++drags; x = g.mouse().x(); xRel = g.mouse().xRel(); break;
+				case Event::MouseMove: ++moves; break;
+				case Event::MouseWheel: ++wheels; break;
+				case Event::KeyDown: shifts.push_back(g.keyboard().shift()); break;
+				default:;
+				}
+				return false;
+			}
+			void onAnimate(double dt) override { dragsAtAnimate = drags; }
+			int drags, moves, wheels, dragsAtAnimate;
+			space_t x, xRel;
+			std::vector<bool> shifts;
+		};
+
+		GLV top(100,100);
+		Target v;
+		top << v;
+		top.queueInput(true);
+		assert(top.queueInput());
+
+		auto post = [&](Event::t type, int x, int y){
+			InputEvent e(type);
+			e.x = x; e.y = y; e.wheel = 1;
+			top.postInput(e);
+		};
+		post(Event::MouseDown, 20, 20);
+		for(int i=0; i<100; ++i) post(Event::MouseDrag, 20+i/4, 20);
+		for(int i=0; i<3; ++i) post(Event::MouseWheel, 0, 0);
+		post(Event::MouseDrag, 30, 30);
+		post(Event::MouseUp, 30, 30);
+		assert(v.drags == 0 && top.focusedView() == &top);
+
+		top.dispatchInput();
+		assert(top.focusedView() == &v);
+		assert(v.drags == 2 && v.wheels == 1 && top.mouse().w() == 3);
+		assert(v.x == 30 && v.xRel == 20);
+		assert(top.inputStats().received == 106 && top.inputStats().dispatched == 5);
+
+		// moves separated by another event are not coalesced
+		post(Event::MouseMove, 20, 20);
+		post(Event::KeyDown, 0, 0);
+		post(Event::MouseMove, 21, 20);
+		post(Event::MouseMove, 22, 20);
+		top.dispatchInput();
+		assert(v.moves == 2);
+		assert(top.inputStats().received == 4 && top.inputStats().dispatched == 3);
+
+		// other events of the same type keep their own modifiers
+		v.shifts.clear();
+		for(int i=0; i<2; ++i){
+			InputEvent e(Event::KeyDown);
+			e.key = 'a';
+			e.modifiers[0] = 0 == i;
+			e.hasModifiers = true;
+			top.postInput(e);
+		}
+		top.dispatchInput();
+		assert(v.shifts.size() == 2 && v.shifts[0] && !v.shifts[1]);
+
+		// queued input is dispatched by drawing, before animation
+		draw::Rasterizer ras(100,100);
+		ras.begin();
+		post(Event::MouseDown, 20, 20);
+		post(Event::MouseDrag, 25, 20);
+		top.drawGLV(100,100, 0);
+		assert(v.dragsAtAnimate == 3);
+		ras.end();
+
+		// without queueing, events are dispatched as they are posted
+		post(Event::MouseDrag, 20, 20);
+		assert(v.drags == 3);
+		top.queueInput(false);
+		assert(v.drags == 4);
+		post(Event::MouseDrag, 21, 20);
+		post(Event::MouseDrag, 22, 20);
+		assert(v.drags == 6);
+	}
+
+	// Input record and replay
+	{
+		struct Scene{
+			Scene(): top(200,200), s(Rect(10,10, 100,20)){
+				s.name("slider");
+				top << s;
+			}
+			GLV top;
+			Slider s;
+		};
+
+		Scene a;
+		InputRecorder rec;
+		rec.attach(a.top);
+		assert(rec.recording() && a.top.inputObserver() == &rec);
+
+		auto post = [&](Event::t type, int x, int y){
+			InputEvent e(type);
+			e.x = x; e.y = y;
+			if(type == Event::MouseDown) e.clicks = 1;
+			a.top.postInput(e);
+		};
+		post(Event::MouseMove, 40, 15);
+		post(Event::MouseDown, 40, 15);
+		for(int i=0; i<50; ++i) post(Event::MouseDrag, 40+i, 15);
+		post(Event::MouseUp, 89, 15);
+		{	InputEvent e(Event::KeyDown);
+			e.key = 'a'; e.hasModifiers = true; e.modifiers[0] = true;
+			a.top.postInput(e);
+		}
+		rec.detach();
+		post(Event::MouseMove, 0, 0);	// not recorded
+		assert(!rec.recording() && a.top.inputObserver() == 0);
+		assert(rec.size() == 54);
+		assert(rec.log().size() < 54*6);
+
+		InputReplay replay(rec.log());
+		std::vector<InputEvent> evs;
+		assert(replay.events(evs));
+		assert(evs.size() == 54);
+		assert(evs[1].type == Event::MouseDown && evs[1].x == 40 && evs[1].clicks == 1);
+		assert(evs[52].type == Event::MouseUp && evs[52].x == 89 && evs[52].y == 15);
+		assert(evs[53].key == 'a' && evs[53].hasModifiers && evs[53].modifiers[0] && !evs[53].modifiers[1]);
+
+		Scene b;
+		ModelManager mm;
+		b.top.addModels(mm);
+		unsigned long long initial = mm.stateHash();
+
+		assert(replay.run(b.top) == 54);
+		assert(b.s.getValue() == a.s.getValue() && b.s.getValue() != 0);
+		assert(replay.stateHash() != initial);
+		assert(replay.latency().count() == 54);
+		assert(replay.latency().min() <= replay.latency().percentile(0.5));
+		assert(replay.latency().percentile(1) >= replay.latency().max());
+
+		// replaying into an equivalent tree gives the same state
+		unsigned long long h = replay.stateHash();
+		Scene c;
+		replay.run(c.top);
+		assert(replay.stateHash() == h && c.s.getValue() == a.s.getValue());
+
+		// file round trip
+		const char * path = "test_units_input.bin";
+		assert(rec.writeFile(path));
+		InputReplay fromFile;
+		assert(fromFile.readFile(path));
+		remove(path);
+		Scene d;
+		assert(fromFile.run(d.top) == 54);
+		assert(fromFile.stateHash() == h);
+
+		// invalid logs are rejected
+		assert(!InputReplay("GLVX").events(evs) && evs.empty());
+		std::string cut = rec.log();
+		cut.resize(cut.size() - 1);
+		InputReplay truncated(cut);
+		Scene e;
+		assert(truncated.run(e.top) == -1 && e.s.getValue() == 0);
+		assert(truncated.latency().count() == 0 && truncated.stateHash() == 0);
+	}
+
+	// Frame profiler
+	{
+		struct Spinner : View{
+			Spinner(): View(Rect(120,10, 20,20)), angle(0){ name("spinner"); }
+			void onAnimate(double dt) override { angle += dt; }
+			double angle;
+		};
+		struct Handler : DrawHandler{
+			Handler(): calls(0){}
+			bool onDraw(View& v, GLV& g) override { ++calls; return true; }
+			int calls;
+		};
+
+		GLV top(200,200);
+		Slider s(Rect(10,10, 100,20)), s2(Rect(10,35, 100,10));
+		s.name("slider");
+		Spinner sp;
+		Handler hd;
+		sp.addHandler(hd);
+		FrameProfiler prof(3);
+		ProfilerView pv(prof, Rect(0,50, 200,120));
+		top << s << s2 << sp << pv;
+
+		draw::Rasterizer ras(200,200);
+		ras.begin();
+
+		top.drawGLV(200,200, 0.01);	// not profiled
+		assert(prof.frames() == 0 && !prof.profiling());
+
+		prof.attach(top);
+		assert(prof.profiling() && top.profiler() == &prof);
+		for(int i=0; i<5; ++i) top.drawGLV(200,200, 0.01);
+		assert(prof.capacity() == 3 && prof.frames() == 3);
+		assert(prof.frame(0).number == 4 && prof.frame(2).number == 2);
+		assert(prof.frame(0).start > prof.frame(1).start);
+		assert(prof.frame(0).duration > 0);
+
+		FrameProfiler::ViewTiming t = prof.query("slider", 1);
+		assert(t.view == &s && t.className == std::string("Slider") && t.name == "slider");
+		assert(t.seconds[FrameProfiler::Draw] > 0 && t.vertices > 0);
+		assert(t.seconds[FrameProfiler::DataModelSync] > 0 && t.seconds[FrameProfiler::Geometry] > 0);
+		assert(prof.query("slider").vertices == 3*t.vertices);
+
+		// Views matching by class name are summed
+		FrameProfiler::ViewTiming ts = prof.query("Slider", 1);
+		assert(ts.view == 0 && ts.vertices > t.vertices);
+		assert(ts.seconds[FrameProfiler::Draw] > t.seconds[FrameProfiler::Draw]);
+
+		t = prof.query("spinner");
+		assert(t.seconds[FrameProfiler::Animate] > 0);
+		assert(t.seconds[FrameProfiler::DrawHandlers] > 0 && hd.calls == 6);
+		assert(t.seconds[FrameProfiler::Draw] >= t.seconds[FrameProfiler::DrawHandlers]);
+		assert(t.total() > 0);
+
+		assert(prof.query("View").view == &sp);
+		assert(prof.query("nothing").view == 0 && prof.query("nothing").total() == 0);
+
+		std::string trace = prof.chromeTrace();
+		assert(trace.find("\"traceEvents\"") != std::string::npos);
+		assert(trace.find("\"Slider slider\"") != std::string::npos);
+		assert(trace.find("\"Frame 4\"") != std::string::npos);
+		assert(trace.find("\"Frame 1\"") == std::string::npos);
+		assert(trace.find("\"cat\":\"DrawHandlers\"") != std::string::npos);
+
+		const char * path = "test_units_trace.json";
+		assert(prof.writeChromeTrace(path));
+		FILE * fp = fopen(path, "r");
+		assert(fp);
+		fseek(fp, 0, SEEK_END);
+		assert(ftell(fp) == long(trace.size()));
+		fclose(fp);
+		remove(path);
+
+		prof.detach();
+		assert(!prof.profiling() && top.profiler() == 0);
+		top.drawGLV(200,200, 0.01);
+		assert(prof.frames() == 3 && prof.frame(0).number == 4);
+
+		prof.clear();
+		assert(prof.frames() == 0 && prof.query("slider").vertices == 0);
+
+		ras.end();
+	}
 
 	// Notifications	
 	{
@@ -851,6 +2399,92 @@ int main(){
 		
 		mm.snapshotsFromString("{" + snapshotString1 + ",\r\n" + snapshotString2 + "}");
 
+		// binary snapshot files
+		{
+			Data wave(Data::FLOAT, 4096);
+			for(int i=0; i<wave.size(); ++i) wave.assign(float(i)/wave.size(), i);
+			mm.snapshots()["test 2"]["wave"] = wave;
+
+			const char * path = "test_units_snapshots.glvs";
+			assert(mm.snapshotsToBinaryFile(path) > 4096*4);
+
+			ModelManager mb;
+			assert(mb.snapshotsFromBinaryFile(path, false));
+			assert(mb.snapshots().size() == mm.snapshots().size());
+			for(const auto& ss : mm.snapshots()){
+				const auto& sb = mb.snapshots()[ss.first];
+				assert(sb.size() == ss.second.size());
+				for(const auto& e : ss.second){
+					const Data& d = sb[e.first];
+					assert(d.type() == e.second.type());
+					assert(d.size() == e.second.size());
+					assert(d == e.second);
+				}
+			}
+
+			// numerical arrays reference the file; clones are copies
+			Data w = mb.snapshots()["test 2"]["wave"];
+			assert(w.references() > 1);
+			assert(w.at<float>(4095) == 4095.f/4096);
+			Data c = w;
+			c.clone();
+			assert(c.references() == 1 && c.elems<float>() != w.elems<float>());
+			c.assign(-1.f, 0);
+			assert(w.at<float>(0) == 0);
+
+			// arrays outlive the manager
+			mb.clearSnapshots();
+			assert(w.at<float>(4095) == 4095.f/4096);
+
+			// text loader detects binary files
+			ModelManager mt;
+			assert(mt.snapshotsFromFile(path));
+			assert(mt.snapshots()["test 1"]["l"].at<std::string>(0) == "Label 1");
+			assert(mt.snapshots()["test 2"]["bs"].at<bool>(3));
+
+			// truncated files are rejected
+			{
+				FILE * fp = fopen(path, "rb+");
+				assert(fp);
+				char buf[64];
+				assert(fread(buf, 1, sizeof(buf), fp) == sizeof(buf));
+				fclose(fp);
+				fp = fopen(path, "wb");
+				fwrite(buf, 1, sizeof(buf), fp);
+				fclose(fp);
+				ModelManager me;
+				assert(!me.snapshotsFromBinaryFile(path));
+				assert(me.snapshots().empty());
+			}
+
+			// string counts beyond the end of the file are rejected
+			for(int count : {0x7fffffff, 3}){
+				ModelManager ms;
+				Data str(Data::STRING);
+				str.assign(std::string("x"));
+				ms.snapshots()["a"]["s"] = str;
+				assert(ms.snapshotsToBinaryFile(path));
+				FILE * fp = fopen(path, "rb");
+				assert(fp);
+				std::string s;
+				char buf[256];
+				size_t n;
+				while((n = fread(buf, 1, sizeof(buf), fp)) > 0) s.append(buf, n);
+				fclose(fp);
+				size_t i = s.find(std::string("\1\0\0\0s", 5));
+				assert(i != std::string::npos);
+				i += 5 + 4;	// name and type
+				for(int k=0; k<4; ++k) s[i+k] = char(count >> (8*k));
+				fp = fopen(path, "wb");
+				fwrite(s.data(), 1, s.size(), fp);
+				fclose(fp);
+				assert(!ms.snapshotsFromBinaryFile(path));
+				assert(ms.snapshots()["a"]["s"].at<std::string>(0) == "x");
+			}
+			remove(path);
+			mm.snapshots()["test 2"].erase("wave");
+		}
+
 //		mm.snapshots()["test 1"]["l"].print();
 //		mm.snapshots()["test 1"]["b"].print();
 //		mm.snapshots()["test 1"]["bs"].print();
@@ -12,6 +12,8 @@ struct MyView3D : public View3D{
 	MyView3D(): count(0){
 		stretch(1,1);
 		disable(DrawBorder);
+		Event::t es[] = {Event::WindowResize, Event::WindowCreate, Event::WindowDestroy, Event::Quit};
+		for(Event::t e : es) listen(e, true);
 	}
 
 	virtual void onDraw3D(GLV& g){